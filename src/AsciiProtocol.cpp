@@ -378,6 +378,16 @@ const char *AsciiProtocol::CompactFileInfo(apfileinfo proto, int &n) {
 	join_kv(output, "subpath",  proto->subpath);
 	join_kv(output, "filename", proto->filename);
 	join_kv(output, "filesize", proto->filesize);
+	if (!proto->codec.empty()) join_kv(output, "codec", proto->codec);
+	if (!proto->checksum.empty()) join_kv(output, "checksum", proto->checksum);
+	for (std::map<string, string>::iterator it = proto->keywords.begin(); it != proto->keywords.end(); ++it) {
+		string keyword = "fits." + it->first;
+		string value = it->second;
+		replace_if(value.begin(), value.end(), is_any_of(",=\r\n"), ' ');
+		trim(value);
+		if (value.empty() || output.size() + keyword.size() + value.size() + 2 > 1000) continue;
+		join_kv(output, keyword, value);
+	}
 	return output_compacted(output, n);
 }
 
@@ -388,6 +398,22 @@ const char *AsciiProtocol::CompactFileStat(apfilestat proto, int &n) {
 	compact_base(to_apbase(proto), output);
 
 	join_kv(output, "status", proto->status);
+	if (!proto->codec.empty()) join_kv(output, "codec", proto->codec);
+	return output_compacted(output, n);
+}
+
+const char *AsciiProtocol::CompactFileData(apfileget proto, int &n) {
+	if (!proto.use_count()) return NULL;
+
+	string output;
+	proto->type = APTYPE_FILEDATA;
+	compact_base(to_apbase(proto), output);
+
+	join_kv(output, "subpath",  proto->subpath);
+	join_kv(output, "filename", proto->filename);
+	join_kv(output, "filesize", proto->filesize);
+	join_kv(output, "offset",   proto->offset);
+	join_kv(output, "length",   proto->length);
 	return output_compacted(output, n);
 }
 //////////////////////////////////////////////////////////////////////////////
@@ -414,6 +440,7 @@ apbase AsciiProtocol::Resolve(const char *rcvd) {
 	else if (ch == 'f') {
 		if      (iequals(type, APTYPE_FILEINFO)) proto = resolve_fileinfo(kvs);
 		else if (iequals(type, APTYPE_FILESTAT)) proto = resolve_filestat(kvs);
+		else if (iequals(type, APTYPE_FILEGET))  proto = resolve_fileget(kvs);
 		else if (iequals(type, APTYPE_FWHM))     proto = resolve_fwhm(kvs);
 		else if (iequals(type, APTYPE_FOCUS))    proto = resolve_focus(kvs);
 	}
@@ -430,6 +457,7 @@ apbase AsciiProtocol::Resolve(const char *rcvd) {
 		else if (iequals(type, APTYPE_START))    proto = resolve_start(kvs);
 		else if (iequals(type, APTYPE_STOP))     proto = resolve_stop(kvs);
 		else if (iequals(type, APTYPE_SLIT))     proto = resolve_slit(kvs);
+		else if (iequals(type, APTYPE_SUBSCRIBE)) proto = resolve_subscribe(kvs);
 	}
 	else if (ch == 't') {
 		if (iequals(type, APTYPE_TAKIMG))        proto = resolve_takeimg(kvs);
@@ -697,7 +725,10 @@ apbase AsciiProtocol::resolve_fileinfo(likv &kvs) {
 		if (iequals(keyword, "tmobs"))         proto->tmobs    = (*it).value;
 		else if (iequals(keyword, "subpath"))  proto->subpath  = (*it).value;
 		else if (iequals(keyword, "filename")) proto->filename = (*it).value;
-		else if (iequals(keyword, "filesize")) proto->filesize = stoi((*it).value);
+		else if (iequals(keyword, "filesize")) proto->filesize = stoll((*it).value);
+		else if (iequals(keyword, "codec"))    proto->codec    = (*it).value;
+		else if (iequals(keyword, "checksum")) proto->checksum = (*it).value;
+		else if (istarts_with(keyword, "fits.")) proto->keywords[keyword.substr(5)] = (*it).value;
 	}
 
 	return to_apbase(proto);
@@ -710,7 +741,37 @@ apbase AsciiProtocol::resolve_filestat(likv &kvs) {
 	for (likv::iterator it = kvs.begin(); it != kvs.end(); ++it) {// 遍历键值对
 		keyword = (*it).keyword;
 		// 识别关键字
-		if (iequals(keyword, "status")) proto->status = stoi((*it).value);
+		if (iequals(keyword, "status"))     proto->status = stoi((*it).value);
+		else if (iequals(keyword, "codec")) proto->codec  = (*it).value;
+	}
+
+	return to_apbase(proto);
+}
+
+apbase AsciiProtocol::resolve_subscribe(likv &kvs) {
+	apsubscribe proto = boost::make_shared<ascii_proto_subscribe>();
+	string keyword;
+
+	for (likv::iterator it = kvs.begin(); it != kvs.end(); ++it) {// 遍历键值对
+		keyword = (*it).keyword;
+		// 识别关键字
+		if (iequals(keyword, "imgtype")) proto->imgtype = (*it).value;
+	}
+
+	return to_apbase(proto);
+}
+
+apbase AsciiProtocol::resolve_fileget(likv &kvs) {
+	apfileget proto = boost::make_shared<ascii_proto_fileget>();
+	string keyword;
+
+	for (likv::iterator it = kvs.begin(); it != kvs.end(); ++it) {// 遍历键值对
+		keyword = (*it).keyword;
+		// 识别关键字
+		if (iequals(keyword, "subpath"))       proto->subpath  = (*it).value;
+		else if (iequals(keyword, "filename")) proto->filename = (*it).value;
+		else if (iequals(keyword, "offset"))   proto->offset   = stoll((*it).value);
+		else if (iequals(keyword, "length"))   proto->length   = stoll((*it).value);
 	}
 
 	return to_apbase(proto);
@@ -9,6 +9,7 @@
 
 #include <boost/thread.hpp>
 #include <list>
+#include <map>
 #include "AsciiProtocolBase.h"
 #include "AstroDeviceDef.h"
 
@@ -41,6 +42,9 @@ using std::list;
 
 #define APTYPE_FILEINFO	"fileinfo"
 #define APTYPE_FILESTAT	"filestat"
+#define APTYPE_SUBSCRIBE	"subscribe"
+#define APTYPE_FILEGET	"fileget"
+#define APTYPE_FILEDATA	"filedata"
 
 /* 通信协议 */
 struct ascii_proto_reg : public ascii_proto_base {// 注册设备/用户
@@ -293,16 +297,27 @@ struct ascii_proto_fileinfo : public ascii_proto_base {// 文件描述信息, 
 	string tmobs;		//< 观测时间
 	string subpath;		//< 子目录名称
 	string filename;	//< 文件名称
-	int filesize;		//< 文件大小, 量纲: 字节
+	int64_t filesize;	//< 文件大小, 量纲: 字节. 压缩传输时为压缩后的大小
+	/*!
+	 * @member codec 传输压缩算法. 为空时不压缩
+	 * - rice: 按行分块、RICE_1算法压缩的16位图像, 即fpack默认格式
+	 * 服务器在状态1的filestat中回显已接受的算法; 不支持时以状态3拒绝, 客户端改为不压缩重发
+	 */
+	string codec;
+	string checksum;	//< 传输数据的校验和, 格式: crc32c:xxxxxxxx. 为空时不校验. 不符时服务器以状态3拒绝
+	/*!
+	 * @member keywords 写盘时提取的FITS关键字, 服务器=>数据处理
+	 * 以fits.<关键字>=<值>发送. 值中的逗号、等号替换为空格; 超出单条协议长度的关键字不发送
+	 */
+	std::map<string, string> keywords;
 
 public:
 	ascii_proto_fileinfo() {
 		type = APTYPE_FILEINFO;
-		filesize = INT_MIN;
+		filesize = INT64_MIN;
 	}
 };
 typedef boost::shared_ptr<ascii_proto_fileinfo> apfileinfo;
-
 struct ascii_proto_filestat : public  ascii_proto_base {// 文件传输结果, 服务器=>客户端
 	/*!
 	 * @member status 文件传输结果
@@ -311,6 +326,7 @@ struct ascii_proto_filestat : public  ascii_proto_base {// 文件传输结果, 
 	 * - 3: 文件接收错误
 	 */
 	int status;	//< 文件传输结果
+	string codec;	//< 服务器已接受的传输压缩算法
 
 public:
 	ascii_proto_filestat() {
@@ -320,6 +336,43 @@ public:
 };
 typedef boost::shared_ptr<ascii_proto_filestat> apfilestat;
 
+struct ascii_proto_subscribe : public ascii_proto_base {// 订阅新文件通知, 数据处理=>服务器
+	/*!
+	 * @note
+	 * gid/uid/cid与imgtype为过滤条件, 为空时代表通配符
+	 */
+	string imgtype;	//< 图像类型, 即FITS关键字IMAGETYP
+
+public:
+	ascii_proto_subscribe() {
+		type = APTYPE_SUBSCRIBE;
+	}
+};
+typedef boost::shared_ptr<ascii_proto_subscribe> apsubscribe;
+
+/*!
+ * @note
+ * 数据处理读取文件:
+ * - fileget : 请求, 数据处理=>服务器. 关键字subpath/filename, 可选offset/length读取部分数据
+ * - filedata: 应答, 服务器=>数据处理. 其后紧跟length字节文件数据. filesize<0时文件不可用
+ */
+struct ascii_proto_fileget : public ascii_proto_base {// 读取文件
+	string subpath;		//< 文件目录
+	string filename;	//< 文件名称
+	int64_t filesize;	//< 文件大小, 量纲: 字节. 仅用于应答
+	int64_t offset;		//< 起始位置, 量纲: 字节
+	int64_t length;		//< 数据长度, 量纲: 字节. 请求中<0时读取至文件末尾
+
+public:
+	ascii_proto_fileget() {
+		type = APTYPE_FILEGET;
+		filesize = INT64_MIN;
+		offset   = 0;
+		length   = -1;
+	}
+};
+typedef boost::shared_ptr<ascii_proto_fileget> apfileget;
+
 ///////////////////////////////////////////////////////////////////////////////
 class AsciiProtocol {
 public:
@@ -481,6 +534,10 @@ public:
 	 * @brief 封装文件传输结果
 	 */
 	const char *CompactFileStat(apfilestat proto, int &n);
+	/*!
+	 * @brief 封装文件读取应答
+	 */
+	const char *CompactFileData(apfileget proto, int &n);
 	/*---------------- 解析通信协议 ----------------*/
 	/*!
 	 * @brief 解析字符串生成结构化通信协议
@@ -587,6 +644,14 @@ protected:
 	 * @brief FITS文件传输结果
 	 */
 	apbase resolve_filestat(likv &kvs);
+	/**
+	 * @brief 订阅新文件通知
+	 */
+	apbase resolve_subscribe(likv &kvs);
+	/**
+	 * @brief 读取文件
+	 */
+	apbase resolve_fileget(likv &kvs);
 };
 
 typedef boost::shared_ptr<AsciiProtocol> AscProtoPtr;
@@ -0,0 +1,132 @@
+/*!
+ * @file BufferPool.cpp 帧缓冲区池定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <boost/make_shared.hpp>
+#include "BufferPool.h"
+#include "GLog.h"
+
+#define HUGEPAGE_SIZE	(2UL << 20)	//< 大页容量, 量纲: 字节
+
+BufPoolPtr make_bufpool(size_t capacity, bool hugepage) {
+	return boost::make_shared<BufferPool>(capacity, hugepage);
+}
+
+BufferPool::BufferPool(size_t capacity, bool hugepage) {
+	capacity_  = capacity;
+	hugepage_  = hugepage;
+	mapped_    = 0;
+	idle_      = 0;
+	nheap_     = 0;
+	heapbytes_ = 0;
+}
+
+BufferPool::~BufferPool() {
+	for (bufmap::iterator it = bufs_.begin(); it != bufs_.end(); ++it) {
+		for (bufvec::iterator x = it->second.begin(); x != it->second.end(); ++x)
+			unmap_buffer(*x, it->first);
+	}
+	bufs_.clear();
+}
+
+BufferPool::charray BufferPool::Alloc(size_t size) {
+	size_t cls = size_class(size);
+	char *buf(NULL);
+	int64_t nheap(0);
+	size_t heapbytes(0);
+
+	mutex_lock lck(mtx_);
+	bufmap::iterator it = bufs_.find(cls);
+	if (it != bufs_.end() && !it->second.empty()) {
+		buf = it->second.back();
+		it->second.pop_back();
+		idle_ -= cls;
+	}
+	else {
+		trim(cls);
+		if (mapped_ + cls <= capacity_ && (buf = map_buffer(cls)) != NULL) mapped_ += cls;
+	}
+	if (!buf) {// 耗尽期间累计堆分配
+		nheap = ++nheap_;
+		heapbytes_ += size;
+	}
+	else if (nheap_) {// 耗尽结束
+		nheap      = nheap_;
+		heapbytes  = heapbytes_;
+		nheap_     = 0;
+		heapbytes_ = 0;
+	}
+	lck.unlock();
+
+	if (!buf) {// 超出缓冲区池容量, 从堆中分配
+		if (nheap == 1)
+			_gLog.Write(LOG_WARN, "BufferPool::Alloc", "pool exhausted, allocates %lu bytes from heap", size);
+		return charray(new char[size]);
+	}
+	if (nheap) {
+		_gLog.Write("buffer pool recovered, %lld allocations (%lu bytes) went to heap while exhausted",
+				nheap, heapbytes);
+	}
+	return charray(buf, releaser(shared_from_this(), cls));
+}
+
+size_t BufferPool::Mapped() {
+	mutex_lock lck(mtx_);
+	return mapped_;
+}
+
+size_t BufferPool::Idle() {
+	mutex_lock lck(mtx_);
+	return idle_;
+}
+
+size_t BufferPool::size_class(size_t size) {
+	size_t page = hugepage_ ? HUGEPAGE_SIZE : sysconf(_SC_PAGESIZE);
+	size_t p2(page), step;
+
+	while ((p2 << 1) <= size) p2 <<= 1;
+	step = p2 > page * 4 ? p2 / 4 : page;
+	return (size + step - 1) / step * step;
+}
+
+char *BufferPool::map_buffer(size_t size) {
+	void *ptr = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if (hugepage_) ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if (ptr == MAP_FAILED) {// 未预留大页时, 使用透明大页
+		ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+		if (ptr != MAP_FAILED && hugepage_) madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	}
+	return ptr == MAP_FAILED ? NULL : (char*) ptr;
+}
+
+void BufferPool::unmap_buffer(char *buf, size_t size) {
+	munmap(buf, size);
+}
+
+void BufferPool::trim(size_t size) {
+	bufmap::reverse_iterator it = bufs_.rbegin();
+	while (mapped_ + size > capacity_ && it != bufs_.rend()) {
+		if (it->second.empty()) ++it;
+		else {
+			unmap_buffer(it->second.back(), it->first);
+			it->second.pop_back();
+			mapped_ -= it->first;
+			idle_   -= it->first;
+		}
+	}
+}
+
+void BufferPool::release(char *buf, size_t size) {
+	mutex_lock lck(mtx_);
+	bufs_[size].push_back(buf);
+	idle_ += size;
+}
@@ -0,0 +1,130 @@
+/*!
+ * @file BufferPool.h 帧缓冲区池声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 按容量分级缓存页对齐缓冲区, 重复用于接收FITS文件
+ * - 可选使用大页内存
+ * - 限制缓冲区占用的总内存. 超出限制时, 从堆中临时分配
+ * - 每次耗尽仅在开始与恢复时各记录一条日志, 恢复时给出期间的堆分配统计
+ */
+
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include <map>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+class BufferPool : public boost::enable_shared_from_this<BufferPool> {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param capacity 缓冲区池总容量, 量纲: 字节
+	 * @param hugepage 使用大页内存
+	 */
+	BufferPool(size_t capacity, bool hugepage = false);
+	virtual ~BufferPool();
+
+public:
+	// 数据类型
+	typedef boost::shared_array<char> charray;
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+
+protected:
+	typedef std::vector<char*> bufvec;		//< 同一容量等级的空闲缓冲区
+	typedef std::map<size_t, bufvec> bufmap;	//< 容量等级-空闲缓冲区
+
+	/*!
+	 * @struct releaser 缓冲区释放器, 作为shared_array的删除器, 将缓冲区归还缓冲区池
+	 */
+	struct releaser {
+		boost::shared_ptr<BufferPool> pool;	//< 缓冲区池
+		size_t size;	//< 缓冲区容量
+
+	public:
+		releaser(boost::shared_ptr<BufferPool> _pool, size_t _size) {
+			pool = _pool;
+			size = _size;
+		}
+
+		void operator()(char *buf) {
+			pool->release(buf, size);
+		}
+	};
+
+protected:
+	// 成员变量
+	boost::mutex mtx_;	//< 互斥锁
+	size_t capacity_;	//< 总容量, 量纲: 字节
+	size_t mapped_;		//< 已映射内存, 量纲: 字节
+	size_t idle_;		//< 空闲缓冲区内存, 量纲: 字节
+	bool hugepage_;		//< 使用大页内存
+	bufmap bufs_;		//< 空闲缓冲区
+	int64_t nheap_;		//< 本次耗尽期间从堆中分配的次数
+	size_t heapbytes_;	//< 本次耗尽期间从堆中分配的字节数
+
+public:
+	// 接口
+	/*!
+	 * @brief 申请缓冲区
+	 * @param size 需求容量, 量纲: 字节
+	 * @return
+	 * 缓冲区. 当最后一个引用释放时, 缓冲区自动归还缓冲区池
+	 */
+	charray Alloc(size_t size);
+	/*!
+	 * @brief 查看已映射内存
+	 * @return
+	 * 已映射内存, 量纲: 字节
+	 */
+	size_t Mapped();
+	/*!
+	 * @brief 查看空闲缓冲区内存
+	 * @return
+	 * 空闲缓冲区内存, 量纲: 字节
+	 */
+	size_t Idle();
+
+protected:
+	// 功能
+	/*!
+	 * @brief 计算容量等级
+	 * @param size 需求容量, 量纲: 字节
+	 * @return
+	 * 容量等级, 即实际分配容量. 每个2的幂区间划分为4个等级
+	 */
+	size_t size_class(size_t size);
+	/*!
+	 * @brief 映射页对齐内存
+	 * @param size 容量, 量纲: 字节
+	 * @return
+	 * 内存地址. 失败时返回NULL
+	 */
+	char *map_buffer(size_t size);
+	/*!
+	 * @brief 解除内存映射
+	 */
+	void unmap_buffer(char *buf, size_t size);
+	/*!
+	 * @brief 释放空闲缓冲区, 直至总内存可容纳size字节
+	 * @param size 待分配容量, 量纲: 字节
+	 */
+	void trim(size_t size);
+	/*!
+	 * @brief 归还缓冲区
+	 */
+	void release(char *buf, size_t size);
+};
+typedef boost::shared_ptr<BufferPool> BufPoolPtr;
+/*!
+ * @brief 工厂函数, 创建缓冲区池
+ * @param capacity 缓冲区池总容量, 量纲: 字节
+ * @param hugepage 使用大页内存
+ * @return
+ * 缓冲区池指针
+ */
+extern BufPoolPtr make_bufpool(size_t capacity, bool hugepage);
+
+#endif /* BUFFERPOOL_H_ */
@@ -0,0 +1,136 @@
+/*!
+ * @file CapacityForecast.cpp 存储容量预测定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/statvfs.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "CapacityForecast.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+
+#define FORECAST_MINSPAN	60	// 计算速率的最短时间跨度, 量纲: 秒
+
+CapacityForecast::CapacityForecast(FileIndexPtr index, int window, int64_t low) {
+	index_   = index;
+	window_  = window > FORECAST_MINSPAN ? window : FORECAST_MINSPAN;
+	low_     = low;
+	tmstart_ = time(NULL);
+}
+
+CapacityForecast::~CapacityForecast() {
+}
+
+void CapacityForecast::Written(const string &root, const string &cid, int64_t bytes) {
+	time_t minute = time(NULL) / 60 * 60;
+	mutex_lock lck(mtx_);
+
+	add(roots_[root], minute, bytes);
+	add(cams_[cid], minute, bytes);
+}
+
+void CapacityForecast::Forecast(const std::vector<string> &roots, rootVec &vec) {
+	time_t now = time(NULL);
+	double total(0.0);
+	int night = FileIndex::night_of_time(to_iso_extended_string(second_clock::universal_time()));
+	int64_t tonight = index_->NightBytes(night);
+	int64_t lastnight = index_->NightBytes(night - 1);
+
+	vec.clear();
+	mutex_lock lck(mtx_);
+	for (bucketMap::iterator it = roots_.begin(); it != roots_.end(); ++it) total += rate(it->second, now);
+	for (std::vector<string>::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+		bucketMap::iterator itr = roots_.find(*it);
+		rootstat x;
+		x.root  = *it;
+		x.avail = Available(*it);
+		x.rate  = itr == roots_.end() ? 0.0 : rate(itr->second, now);
+		vec.push_back(x);
+	}
+	lck.unlock();
+
+	// 本观测夜剩余写盘量: 上一观测夜的数据量扣除已写盘量, 且不低于按当前速率外推的数据量
+	int64_t expect = lastnight > tonight ? lastnight - tonight : 0;
+	int64_t extrap = int64_t(total * remain_night());
+	if (extrap > expect) expect = extrap;
+	for (rootVec::iterator it = vec.begin(); it != vec.end(); ++it) {
+		it->expect = expect;
+		if (it->avail >= 0 && it->avail <= low_) it->eta = 0.0;
+		else if (it->avail < 0 || total <= 0.0) it->eta = -1.0;
+		else it->eta = (it->avail - low_) / total;
+	}
+}
+
+void CapacityForecast::Cameras(camVec &vec) {
+	time_t now = time(NULL);
+	int night = FileIndex::night_of_time(to_iso_extended_string(second_clock::universal_time()));
+
+	vec.clear();
+	mutex_lock lck(mtx_);
+	for (bucketMap::iterator it = cams_.begin(); it != cams_.end(); ++it) {
+		camstat x;
+		x.cid  = it->first;
+		x.rate = rate(it->second, now);
+		vec.push_back(x);
+	}
+	lck.unlock();
+	for (camVec::iterator it = vec.begin(); it != vec.end(); ++it) it->tonight = index_->Bytes(it->cid, night);
+}
+
+void CapacityForecast::Save(const string &filepath, const string &active, const rootVec &roots, const camVec &cams) {
+	string pathtmp = filepath + ".tmp";
+	FILE *fp;
+
+	if (!(fp = fopen(pathtmp.c_str(), "w"))) {
+		_gLog.Write(LOG_WARN, "CapacityForecast", "failed to create <%s>. %s", pathtmp.c_str(), strerror(errno));
+		return;
+	}
+	fprintf(fp, "# %s\n", to_iso_extended_string(second_clock::local_time()).c_str());
+	fprintf(fp, "# root\tactive\tfree_GB\trate_MB/s\tfull_in_h\tnight_expect_GB\n");
+	for (rootVec::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+		fprintf(fp, "R\t%s\t%d\t%.1f\t%.2f\t%.1f\t%.1f\n", it->root.c_str(), it->root == active,
+				it->avail / 1073741824.0, it->rate / 1048576.0, it->eta < 0.0 ? -1.0 : it->eta / 3600.0,
+				it->expect / 1073741824.0);
+	}
+	fprintf(fp, "# cid\trate_MB/s\ttonight_GB\n");
+	for (camVec::const_iterator it = cams.begin(); it != cams.end(); ++it) {
+		fprintf(fp, "C\t%s\t%.2f\t%.2f\n", it->cid.c_str(), it->rate / 1048576.0, it->tonight / 1073741824.0);
+	}
+	if (fclose(fp) == 0) rename(pathtmp.c_str(), filepath.c_str());
+}
+
+int64_t CapacityForecast::Available(const string &root) {
+	struct statvfs st;
+	if (statvfs(root.c_str(), &st)) return -1;
+	return int64_t(st.f_bavail) * st.f_frsize;
+}
+
+void CapacityForecast::add(bucketQueue &q, time_t minute, int64_t bytes) {
+	if (q.empty() || q.back().first != minute) q.push_back(bucket(minute, 0));
+	q.back().second += bytes;
+	while (q.front().first <= minute - window_) q.pop_front();
+}
+
+double CapacityForecast::rate(bucketQueue &q, time_t now) {
+	int64_t bytes(0);
+	time_t span = now - tmstart_;
+
+	while (q.size() && q.front().first <= now - window_) q.pop_front();
+	for (bucketQueue::iterator it = q.begin(); it != q.end(); ++it) bytes += it->second;
+	if (span > window_) span = window_;
+	if (span < FORECAST_MINSPAN) span = FORECAST_MINSPAN;
+	return double(bytes) / span;
+}
+
+int CapacityForecast::remain_night() {
+	ptime now = second_clock::local_time();
+	ptime noon(now.date(), hours(12));
+
+	if (now >= noon) noon += hours(24);
+	return int((noon - now).total_seconds());
+}
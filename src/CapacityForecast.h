@@ -0,0 +1,126 @@
+/*!
+ * @file CapacityForecast.h 存储容量预测声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 按分钟累计各盘区与各相机的写盘字节数, 以滑动窗口计算写盘速率
+ * - 以上一观测夜的数据量与当前速率估计本观测夜剩余的写盘量
+ * - 预测各盘区可用空间降至低水位的时间, 供回收与更换盘区决策
+ * - 预测结果写入状态文件, 供运行人员在观测开始前处理
+ */
+
+#ifndef CAPACITYFORECAST_H_
+#define CAPACITYFORECAST_H_
+
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/container/deque.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include "FileIndex.h"
+
+using std::string;
+
+class CapacityForecast {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param index  已存储文件索引
+	 * @param window 滑动窗口, 量纲: 秒
+	 * @param low    低水位, 量纲: 字节
+	 */
+	CapacityForecast(FileIndexPtr index, int window, int64_t low);
+	virtual ~CapacityForecast();
+
+public:
+	// 数据类型
+	struct rootstat {// 盘区预测
+		string root;		//< 存储盘区
+		int64_t avail;		//< 可用空间, 量纲: 字节. <0: 无法访问
+		double rate;		//< 该盘区的写盘速率, 量纲: 字节/秒
+		double eta;			//< 承接全部写盘时, 可用空间降至低水位的时间, 量纲: 秒. <0: 无写盘
+		int64_t expect;		//< 本观测夜剩余的预期写盘量, 量纲: 字节
+	};
+	typedef std::vector<rootstat> rootVec;
+
+	struct camstat {// 相机统计
+		string cid;			//< 相机标志
+		double rate;		//< 写盘速率, 量纲: 字节/秒
+		int64_t tonight;	//< 本观测夜的写盘量, 量纲: 字节
+	};
+	typedef std::vector<camstat> camVec;
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef std::pair<time_t, int64_t> bucket;	//< 分钟+字节数
+	typedef boost::container::deque<bucket> bucketQueue;
+	typedef std::map<string, bucketQueue> bucketMap;	//< 盘区或相机-分钟累计
+
+protected:
+	// 成员变量
+	FileIndexPtr index_;	//< 已存储文件索引
+	int window_;			//< 滑动窗口, 量纲: 秒
+	int64_t low_;			//< 低水位, 量纲: 字节
+	boost::mutex mtx_;		//< 互斥锁
+	bucketMap roots_;		//< 各盘区写盘量
+	bucketMap cams_;		//< 各相机写盘量
+	time_t tmstart_;		//< 开始统计时间
+
+public:
+	// 接口
+	/*!
+	 * @brief 累计写盘字节数
+	 * @param root  存储盘区
+	 * @param cid   相机标志
+	 * @param bytes 文件大小, 量纲: 字节
+	 */
+	void Written(const string &root, const string &cid, int64_t bytes);
+	/*!
+	 * @brief 预测各盘区的容量
+	 * @param roots 存储盘区
+	 * @param vec   预测结果
+	 * @note
+	 * 按全部盘区的写盘速率预测, 即假设该盘区承接全部写盘
+	 */
+	void Forecast(const std::vector<string> &roots, rootVec &vec);
+	/*!
+	 * @brief 统计各相机的写盘速率与本观测夜写盘量
+	 */
+	void Cameras(camVec &vec);
+	/*!
+	 * @brief 将预测结果写入状态文件
+	 * @param filepath 文件路径
+	 * @param active   当前写盘盘区
+	 * @param roots    盘区预测
+	 * @param cams     相机统计
+	 */
+	void Save(const string &filepath, const string &active, const rootVec &roots, const camVec &cams);
+	/*!
+	 * @brief 查看可用空间
+	 * @return
+	 * 可用空间, 量纲: 字节. 失败时返回-1
+	 */
+	static int64_t Available(const string &root);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 累计到当前分钟并清除窗口外的数据
+	 */
+	void add(bucketQueue &q, time_t minute, int64_t bytes);
+	/*!
+	 * @brief 计算窗口内的写盘速率
+	 * @return
+	 * 写盘速率, 量纲: 字节/秒
+	 */
+	double rate(bucketQueue &q, time_t now);
+	/*!
+	 * @brief 本观测夜剩余时间, 量纲: 秒
+	 */
+	int remain_night();
+};
+typedef boost::shared_ptr<CapacityForecast> ForecastPtr;
+
+#endif /* CAPACITYFORECAST_H_ */
@@ -0,0 +1,110 @@
+/*!
+ * @file Checksum.cpp 文件校验和定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <boost/thread/once.hpp>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+#include "Checksum.h"
+
+#define CRC32C_POLY	0x82F63B78	//< 反射形式的Castagnoli多项式
+
+static uint32_t crc_table[8][256];	//< 分片查找表
+static boost::once_flag crc_once = BOOST_ONCE_INIT;
+static bool crc_hw = false;			//< CPU支持SSE4.2
+
+#if defined(__x86_64__)
+/*!
+ * @brief 以SSE4.2 crc32指令计算, 每条指令处理8字节
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t n) {
+	uint64_t crc64;
+	uint64_t v;
+
+	for (; n && (uintptr_t(p) & 7); --n) crc = _mm_crc32_u8(crc, *p++);
+	crc64 = crc;
+	for (; n >= 32; n -= 32, p += 32) {
+		memcpy(&v, p, 8);      crc64 = _mm_crc32_u64(crc64, v);
+		memcpy(&v, p + 8, 8);  crc64 = _mm_crc32_u64(crc64, v);
+		memcpy(&v, p + 16, 8); crc64 = _mm_crc32_u64(crc64, v);
+		memcpy(&v, p + 24, 8); crc64 = _mm_crc32_u64(crc64, v);
+	}
+	for (; n >= 8; n -= 8, p += 8) {
+		memcpy(&v, p, 8);
+		crc64 = _mm_crc32_u64(crc64, v);
+	}
+	crc = uint32_t(crc64);
+	for (; n; --n) crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+#endif
+
+/*!
+ * @brief 生成查找表
+ */
+static void crc32c_init() {
+	uint32_t crc;
+
+	for (int i = 0; i < 256; ++i) {
+		crc = i;
+		for (int j = 0; j < 8; ++j) crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+		crc_table[0][i] = crc;
+	}
+	for (int i = 0; i < 256; ++i) {
+		crc = crc_table[0][i];
+		for (int k = 1; k < 8; ++k) {
+			crc = crc_table[0][crc & 0xFF] ^ (crc >> 8);
+			crc_table[k][i] = crc;
+		}
+	}
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	crc_hw = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t n) {
+	const unsigned char *p = (const unsigned char *) data;
+	uint32_t lo, hi;
+
+	boost::call_once(crc_once, &crc32c_init);
+#if defined(__x86_64__)
+	if (crc_hw) return ~crc32c_sse42(~crc, p, n);
+#endif
+	crc = ~crc;
+	for (; n && (uintptr_t(p) & 7); --n) crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	for (; n >= 8; n -= 8, p += 8) {
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF]
+			^ crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24]
+			^ crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF]
+			^ crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+	}
+	for (; n; --n) crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+std::string crc32c_string(uint32_t crc) {
+	char text[20];
+	snprintf(text, sizeof(text), "crc32c:%08x", crc);
+	return std::string(text);
+}
+
+bool crc32c_parse(const std::string &text, uint32_t &crc) {
+	if (text.size() != 15 || strncasecmp(text.c_str(), "crc32c:", 7)
+			|| text.find_first_not_of("0123456789abcdefABCDEF", 7) != std::string::npos)
+		return false;
+	crc = uint32_t(strtoul(text.c_str() + 7, NULL, 16));
+	return true;
+}
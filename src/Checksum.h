@@ -0,0 +1,39 @@
+/*!
+ * @file Checksum.h 文件校验和声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - CRC32C(Castagnoli多项式), 可分段增量计算
+ * - CPU支持SSE4.2时使用crc32指令, 否则查表法, 每次处理8字节
+ */
+
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/*!
+ * @brief 增量计算CRC32C
+ * @param crc  前段数据的校验和. 首段为0
+ * @param data 数据
+ * @param n    数据长度, 量纲: 字节
+ * @return
+ * 累计至本段数据的校验和
+ */
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t n);
+/*!
+ * @brief 将校验和格式化为文本, 格式: crc32c:xxxxxxxx
+ */
+std::string crc32c_string(uint32_t crc);
+/*!
+ * @brief 解析文本格式的校验和
+ * @param text 校验和文本, 格式: crc32c:xxxxxxxx
+ * @param crc  校验和
+ * @return
+ * 格式正确
+ */
+bool crc32c_parse(const std::string &text, uint32_t &crc);
+
+#endif /* CHECKSUM_H_ */
@@ -0,0 +1,93 @@
+/*!
+ * @file ChunkPipe.cpp 有界数据块管道定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <string.h>
+#include "ChunkPipe.h"
+
+ChunkPipe::ChunkPipe(int chunksize, int depth, BufPoolPtr pool, int stall) {
+	chunksize_ = chunksize;
+	depth_     = depth < 1 ? 1 : depth;
+	pool_      = pool;
+	stall_     = stall;
+	closed_    = false;
+	aborted_   = false;
+	filling_.size = 0;
+}
+
+ChunkPipe::~ChunkPipe() {
+	chunks_.clear();
+}
+
+bool ChunkPipe::Push(const char *data, int n) {
+	mutex_lock lck(mtx_);
+	int len;
+
+	while (n > 0 && !aborted_) {
+		if (!filling_.data) {
+			filling_.data = pool_.use_count() ? pool_->Alloc(chunksize_) : charray(new char[chunksize_]);
+			filling_.size = 0;
+		}
+		if ((len = chunksize_ - filling_.size) > n) len = n;
+		memcpy(filling_.data.get() + filling_.size, data, len);
+		filling_.size += len;
+		data += len;
+		n    -= len;
+		if (filling_.size == chunksize_ && !commit(lck)) break;
+	}
+	return !aborted_;
+}
+
+void ChunkPipe::Close() {
+	mutex_lock lck(mtx_);
+	if (filling_.size) commit(lck);
+	closed_ = true;
+	cvpop_.notify_all();
+}
+
+bool ChunkPipe::Pop(chunk &x) {
+	mutex_lock lck(mtx_);
+	boost::system_time deadline = boost::get_system_time() + boost::posix_time::seconds(stall_);
+	while (chunks_.empty() && !closed_ && !aborted_) wait(lck, cvpop_, deadline);
+	if (aborted_ || chunks_.empty()) return false;
+	x = chunks_.front();
+	chunks_.pop_front();
+	cvpush_.notify_one();
+	return true;
+}
+
+void ChunkPipe::Abort() {
+	mutex_lock lck(mtx_);
+	abort(lck);
+}
+
+void ChunkPipe::abort(mutex_lock &lck) {
+	aborted_ = true;
+	chunks_.clear();
+	filling_.data.reset();
+	cvpush_.notify_all();
+	cvpop_.notify_all();
+}
+
+bool ChunkPipe::IsAborted() {
+	mutex_lock lck(mtx_);
+	return aborted_;
+}
+
+bool ChunkPipe::commit(mutex_lock &lck) {
+	boost::system_time deadline = boost::get_system_time() + boost::posix_time::seconds(stall_);
+	while (int(chunks_.size()) >= depth_ && !aborted_) wait(lck, cvpush_, deadline);
+	if (aborted_) return false;
+	chunks_.push_back(filling_);
+	filling_.data.reset();
+	filling_.size = 0;
+	cvpop_.notify_one();
+	return true;
+}
+
+void ChunkPipe::wait(mutex_lock &lck, boost::condition_variable &cv, const boost::system_time &deadline) {
+	if (stall_ <= 0) cv.wait(lck);
+	else if (!cv.timed_wait(lck, deadline)) abort(lck);	// 对端停滞
+}
@@ -0,0 +1,112 @@
+/*!
+ * @file ChunkPipe.h 有界数据块管道声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 在网络接收与写盘之间以固定长度数据块流式传递大文件
+ * - 管道深度有限. 管道满时, 写入端阻塞, 从而限制常驻内存
+ * - 任一端可中止管道
+ * - 任一端等待对端超过停滞超时时, 中止管道, 避免另一端永久阻塞
+ */
+
+#ifndef CHUNKPIPE_H_
+#define CHUNKPIPE_H_
+
+#include <boost/container/deque.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include "BufferPool.h"
+
+class ChunkPipe {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param chunksize 数据块长度, 量纲: 字节
+	 * @param depth     管道深度, 即最多缓存的数据块数量
+	 * @param pool      缓冲区池. 为空时从堆中分配数据块
+	 * @param stall     停滞超时, 量纲: 秒. 不大于0时无限等待
+	 */
+	ChunkPipe(int chunksize, int depth, BufPoolPtr pool = BufPoolPtr(), int stall = 60);
+	virtual ~ChunkPipe();
+
+public:
+	// 数据类型
+	typedef boost::shared_array<char> charray;
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+
+	struct chunk {// 数据块
+		charray data;	//< 数据
+		int size;		//< 有效数据长度, 量纲: 字节
+	};
+
+protected:
+	typedef boost::container::deque<chunk> chunkQueue;
+
+protected:
+	// 成员变量
+	int chunksize_;		//< 数据块长度, 量纲: 字节
+	int depth_;			//< 管道深度
+	BufPoolPtr pool_;	//< 缓冲区池
+	int stall_;			//< 停滞超时, 量纲: 秒
+	chunk filling_;		//< 正在填充的数据块
+	chunkQueue chunks_;	//< 待写盘数据块
+	boost::mutex mtx_;	//< 互斥锁
+	boost::condition_variable cvpush_;	//< 条件变量: 管道有空闲位置
+	boost::condition_variable cvpop_;	//< 条件变量: 管道有待写盘数据块
+	bool closed_;		//< 写入端完成
+	bool aborted_;		//< 管道已中止
+
+public:
+	// 接口
+	/*!
+	 * @brief 写入数据. 数据块填满后进入管道; 管道满时阻塞
+	 * @param data 数据
+	 * @param n    数据长度, 量纲: 字节
+	 * @return
+	 * 管道有效性. 管道中止或读取端停滞超时后返回false
+	 */
+	bool Push(const char *data, int n);
+	/*!
+	 * @brief 写入端完成, 将最后一个数据块送入管道
+	 */
+	void Close();
+	/*!
+	 * @brief 读取数据块. 管道空时阻塞
+	 * @param x 数据块
+	 * @return
+	 * 管道关闭/中止且无剩余数据时返回false. 写入端停滞超时时中止管道
+	 */
+	bool Pop(chunk &x);
+	/*!
+	 * @brief 中止管道, 丢弃未写盘数据
+	 */
+	void Abort();
+	/*!
+	 * @brief 检查管道是否已中止
+	 */
+	bool IsAborted();
+
+protected:
+	/*!
+	 * @brief 将正在填充的数据块送入管道
+	 * @param lck 已锁定的互斥锁
+	 * @return
+	 * 管道有效性
+	 */
+	bool commit(mutex_lock &lck);
+	/*!
+	 * @brief 等待条件变量, 超出停滞超时时中止管道
+	 * @param lck      已锁定的互斥锁
+	 * @param cv       条件变量
+	 * @param deadline 停滞期限
+	 */
+	void wait(mutex_lock &lck, boost::condition_variable &cv, const boost::system_time &deadline);
+	/*!
+	 * @brief 中止管道
+	 * @param lck 已锁定的互斥锁
+	 */
+	void abort(mutex_lock &lck);
+};
+typedef boost::shared_ptr<ChunkPipe> ChunkPipePtr;
+
+#endif /* CHUNKPIPE_H_ */
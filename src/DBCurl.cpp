@@ -5,41 +5,155 @@
  */
 
 #include <utility>
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/bind/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/future.hpp>
 #include "DBCurl.h"
+#include "GLog.h"
+
+#define BREAKER_CLOSED	0	//< 熔断状态: 正常
+#define BREAKER_OPEN	1	//< 熔断状态: 熔断, 拒绝请求
+#define BREAKER_HALF	2	//< 熔断状态: 半开, 以单个请求探测
+#define COOLDOWN_MIN	5	//< 熔断冷却时间下限, 量纲: 秒
+#define COOLDOWN_MAX	300	//< 熔断冷却时间上限, 量纲: 秒
 
 using namespace std;
+using namespace boost::placeholders;
+using namespace boost::posix_time;
 
 typedef pair<string, string> pairstr;
 
-int DBCurl::cnt_used_ = 0;
+/*!
+ * @brief 丢弃数据库应答内容
+ */
+static size_t discard_response(char *ptr, size_t size, size_t nmemb, void *userdata) {
+	return size * nmemb;
+}
+
+/*!
+ * @brief 读回调: 将文件数据复制到curl发送缓冲区
+ */
+static size_t mime_read(char *buffer, size_t size, size_t nitems, void *arg) {
+	DBCurl::mime_source *src = (DBCurl::mime_source *) arg;
+	int64_t n = int64_t(size * nitems), left = src->size - src->offset;
+
+	if (n > left) n = left;
+	memcpy(buffer, src->data + src->offset, n);
+	src->offset  += n;
+	*src->copied += n;
+	return size_t(n);
+}
+
+/*!
+ * @brief 定位回调: 重发时回到数据起始位置
+ */
+static int mime_seek(void *arg, curl_off_t offset, int origin) {
+	DBCurl::mime_source *src = (DBCurl::mime_source *) arg;
+
+	if (origin != SEEK_SET || offset < 0 || offset > src->size) return CURL_SEEKFUNC_CANTSEEK;
+	src->offset = offset;
+	return CURL_SEEKFUNC_OK;
+}
+
+/*!
+ * @brief 释放回调: 解除文件映射或释放内存缓冲区引用
+ */
+static void mime_free(void *arg) {
+	DBCurl::mime_source *src = (DBCurl::mime_source *) arg;
+
+	if (src->mapped) munmap(src->mapped, src->size);
+	delete src;
+}
+
+/*!
+ * @brief 将异步请求结果转交同步调用者
+ */
+static void set_result(boost::shared_ptr<boost::promise<curl_result> > prom, const curl_result &rslt) {
+	prom->set_value(rslt);
+}
+
+boost::once_flag DBCurl::once_ = BOOST_ONCE_INIT;
 CURLcode DBCurl::curlcode_ = CURLE_OK;
 
-DBCurl::DBCurl(const string &urlRoot) {
+DBCurl::DBCurl(const string &urlRoot, int maxconn) {
 	urlRoot_ = urlRoot;
+	maxconn_ = maxconn < 1 ? 1 : maxconn;
 #ifdef WINDOWS
 	if (urlRoot.back() != '\\') urlRoot_ += "\\";
 #else
 	if (urlRoot.back() != '/') urlRoot_ += "/";
 #endif
-	init();
+	GlobalInit();
 	init_urls();
+	batchsize_   = 1;
+	batchwindow_ = 1000;
+	batchok_     = true;
+	tmconnect_   = 3000;
+	tmtotal_     = 30000;
+	failmax_     = 5;
+	nfail_       = 0;
+	breaker_     = BREAKER_CLOSED;
+	cooldown_    = COOLDOWN_MIN;
+	probing_     = false;
+	limit_       = maxconn_;
+	minrtt_      = -1.0;
+	rttexpire_   = microsec_clock::universal_time();
+	lastcut_     = rttexpire_;
+
+	hmulti_ = curl_multi_init();
+	curl_multi_setopt(hmulti_, CURLMOPT_MAX_HOST_CONNECTIONS, long(maxconn_));
+	curl_multi_setopt(hmulti_, CURLMOPT_MAXCONNECTS, long(maxconn_));
+	thrdmulti_.reset(new boost::thread(boost::bind(&DBCurl::thread_multi, this)));
 }
 
 DBCurl::~DBCurl() {
-	cleanup();
+	if (thrdmulti_.unique()) {
+		thrdmulti_->interrupt();
+		curl_multi_wakeup(hmulti_);
+		thrdmulti_->join();
+	}
+
+	curl_result rslt;
+	rslt.code   = CURLE_ABORTED_BY_CALLBACK;
+	rslt.errmsg = "DBCurl is destroyed";
+	if (batch_.use_count()) {
+		for (batchvec::iterator it = batch_->begin(); it != batch_->end(); ++it) {
+			if (it->slot) it->slot(rslt);
+		}
+		batch_.reset();
+	}
+	for (std::map<CURL*, reqptr>::iterator it = running_.begin(); it != running_.end(); ++it) {
+		curl_multi_remove_handle(hmulti_, it->first);
+		pending_.push_back(it->second);
+	}
+	running_.clear();
+	for (std::deque<reqptr>::iterator it = pending_.begin(); it != pending_.end(); ++it) {
+		curl_mime_free((*it)->mime);
+		curl_easy_cleanup((*it)->hcurl);
+		if ((*it)->slot) (*it)->slot(rslt);
+	}
+	pending_.clear();
+	for (std::vector<CURL*>::iterator it = idle_.begin(); it != idle_.end(); ++it) curl_easy_cleanup(*it);
+	idle_.clear();
+	curl_multi_cleanup(hmulti_);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 /* 成员函数 */
 //////////////////////////////////////////////////////////////////////////////
 void DBCurl::init() {
-	if (++cnt_used_ == 1) curlcode_ = curl_global_init(CURL_GLOBAL_ALL);
+	if ((curlcode_ = curl_global_init(CURL_GLOBAL_ALL)) == CURLE_OK) atexit(&curl_global_cleanup);
 }
 
-void DBCurl::cleanup() {
-	if (--cnt_used_ == 0) curl_global_cleanup();
+void DBCurl::GlobalInit() {
+	boost::call_once(once_, &DBCurl::init);
 }
 
 void DBCurl::init_urls() {
@@ -54,19 +168,68 @@ void DBCurl::init_urls() {
 	urlRainfall_      = urlRoot_ + "uploadRainfall.action";
 	urlRegImage_      = urlRoot_ + "regOrigImg.action";
 	urlUploadFile_    = urlRoot_ + "commonFileUpload.action";
+	urlRegBatch_      = urlRoot_ + "regOrigImgBatch.action";
+	urlRegRef_        = urlRoot_ + "regOrigImgRef.action";
+	urlMoveImage_     = urlRoot_ + "updateOrigImgPath.action";
 }
 
 int DBCurl::curl_upload(const string &url, mmapstr &kvs, mmapstr &file, const string &pathdir) {
+	typedef boost::promise<curl_result> result_promise;
+	boost::shared_ptr<result_promise> prom = boost::make_shared<result_promise>();
+	boost::unique_future<curl_result> fut = prom->get_future();
+
+	curl_upload_async(url, kvs, file, pathdir, boost::bind(&set_result, prom, _1));
+	const curl_result &rslt = fut.get();
+	if (rslt.code) snprintf(errmsg_, sizeof(errmsg_), "%s", rslt.errmsg.c_str());
+
+	return rslt.code;
+}
+
+void DBCurl::curl_upload_async(const string &url, mmapstr &kvs, mmapstr &file, const string &pathdir,
+		const ResultSlot &slot, const charray &data, int64_t size) {
+	curl_result rslt;
+	char errmsg[200];
+
 	if (kvs.empty() && file.empty()) {
-		sprintf(errmsg_, "URL[%s], empty parameters", url.c_str());
-		return -1;
+		sprintf(errmsg, "URL[%s], empty parameters", url.c_str());
+		rslt.code   = DBCURL_EMPTY;
+		rslt.errmsg = errmsg;
+		if (slot) slot(rslt);
+		return;
+	}
+
+	reqptr req = new_request(url, slot);
+	if (req.use_count() && add_form(req, kvs, file, pathdir, data, size)) submit(req);
+}
+
+DBCurl::reqptr DBCurl::new_request(const string &url, const ResultSlot &slot) {
+	reqptr req = boost::make_shared<curl_request>();
+	req->url    = url;
+	req->slot   = slot;
+	req->copied = 0;
+	req->mime   = NULL;
+	if (!(req->hcurl = acquire_handle()) || !(req->mime = curl_mime_init(req->hcurl))) {
+		fail_request(req, DBCURL_INIT, "failed to initialize curl handle");
+		req.reset();
 	}
+	return req;
+}
+
+bool DBCurl::add_form(reqptr req, mmapstr &kvs, mmapstr &file, const string &pathdir,
+		const charray &data, int64_t size) {
+	srcvec srcs;
+	string errmsg;
 
-	CURL *hCurl = curl_easy_init();
-	if (!hCurl) {
-		strcpy(errmsg_, "curl_easy_init() failed");
-		return -2;
+	if (!open_sources(req->url, file, pathdir, data, size, srcs, errmsg)) {
+		fail_request(req, DBCURL_MAP, errmsg);
+		return false;
 	}
+	add_parts(req, kvs, file, srcs, "");
+	return true;
+}
+
+bool DBCurl::open_sources(const string &url, mmapstr &file, const string &pathdir, const charray &data,
+		int64_t size, srcvec &srcs, string &errmsg) {
 	string subpath = pathdir;
 #ifdef WINDOWS
 	if (subpath.back() != '\\') subpath += "\\";
@@ -74,49 +237,370 @@ int DBCurl::curl_upload(const string &url, mmapstr &kvs, mmapstr &file, const st
 	if (subpath.back() != '/') subpath += "/";
 #endif
 
-	struct curl_httppost* post = NULL;
-	struct curl_httppost* last = NULL;
+	/* 待上传文件: 由读回调直接从内存或文件映射中取数据 */
+	for (mmapstr::iterator it = file.begin(); it != file.end(); ++it) {
+		mime_source *src = new mime_source;
+		src->copied = NULL;
+		src->offset = 0;
+		src->mapped = NULL;
+		if (data && file.size() == 1) {
+			src->buffer = data;
+			src->data   = data.get();
+			src->size   = size;
+		}
+		else if (!map_file(subpath + it->second, src)) {
+			char buff[200];
+			snprintf(buff, sizeof(buff), "URL[%s]. failed to map file<%s>. %s", url.c_str(),
+					(subpath + it->second).c_str(), strerror(errno));
+			errmsg = buff;
+			delete src;
+			for (srcvec::iterator x = srcs.begin(); x != srcs.end(); ++x) mime_free(*x);
+			srcs.clear();
+			return false;
+		}
+		srcs.push_back(src);
+	}
+	return true;
+}
+
+void DBCurl::add_parts(reqptr req, mmapstr &kvs, mmapstr &file, srcvec &srcs, const string &prefix) {
+	curl_mimepart *part;
+	srcvec::iterator src = srcs.begin();
 
 	/* 构建键值对 */
 	for (mmapstr::iterator it = kvs.begin(); it != kvs.end(); ++it) {
-		curl_formadd(&post, &last, CURLFORM_COPYNAME, it->first.data(), CURLFORM_COPYCONTENTS, it->second.data(), CURLFORM_END);
+		part = curl_mime_addpart(req->mime);
+		curl_mime_name(part, (prefix + it->first).c_str());
+		curl_mime_data(part, it->second.data(), it->second.size());
 	}
 	/* 构建待上传文件 */
-	for (mmapstr::iterator it = file.begin(); it != file.end(); ++it) {
-		curl_formadd(&post, &last, CURLFORM_COPYNAME, it->first.data(), CURLFORM_FILE, (subpath + it->second.data()).c_str(), CURLFORM_END);
+	for (mmapstr::iterator it = file.begin(); it != file.end() && src != srcs.end(); ++it, ++src) {
+		(*src)->copied = &req->copied;
+		part = curl_mime_addpart(req->mime);
+		curl_mime_name(part, (prefix + it->first).c_str());
+		curl_mime_filename(part, it->second.c_str());
+		curl_mime_type(part, "application/octet-stream");
+		curl_mime_data_cb(part, (*src)->size, &mime_read, &mime_seek, &mime_free, *src);
+	}
+}
+
+bool DBCurl::map_file(const string &filepath, mime_source *src) {
+	struct stat st;
+	int fd;
+
+	if ((fd = open(filepath.c_str(), O_RDONLY)) < 0) return false;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return false;
+	}
+	src->size = st.st_size;
+	src->data = "";
+	if (src->size > 0) {
+		if ((src->mapped = mmap(NULL, src->size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+			src->mapped = NULL;
+			close(fd);
+			return false;
+		}
+		madvise(src->mapped, src->size, MADV_SEQUENTIAL);
+		src->data = (const char *) src->mapped;
 	}
-	/* 执行上传操作 */
-	curl_easy_setopt(hCurl, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(hCurl, CURLOPT_HTTPPOST, post);
+	close(fd);
+	return true;
+}
+
+void DBCurl::submit(reqptr req) {
+	CURL *hCurl = req->hcurl;
+
+	/* 提交上传操作 */
+	curl_easy_setopt(hCurl, CURLOPT_URL, req->url.c_str());
+	curl_easy_setopt(hCurl, CURLOPT_MIMEPOST, req->mime);
+	curl_easy_setopt(hCurl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(hCurl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(hCurl, CURLOPT_WRITEFUNCTION, &discard_response);
+	curl_easy_setopt(hCurl, CURLOPT_CONNECTTIMEOUT_MS, long(tmconnect_));
+	curl_easy_setopt(hCurl, CURLOPT_TIMEOUT_MS, long(tmtotal_));
 
 	// 输出调试信息
 #if defined(NDEBUG) || defined(DEBUG)
 	curl_easy_setopt(hCurl, CURLOPT_VERBOSE, 1L);
 #endif
 
-	curlcode_ = curl_easy_perform(hCurl);
-	if (curlcode_ != CURLE_OK) {// curl错误
-		sprintf(errmsg_, "Error line[%d]. URL[%s]. %s", __LINE__, url.c_str(),
-				curl_easy_strerror(curlcode_));
+	mutex_lock lck(mtx_);
+	pending_.push_back(req);
+	lck.unlock();
+	curl_multi_wakeup(hmulti_);
+}
+
+void DBCurl::fail_request(reqptr req, int code, const string &errmsg) {
+	curl_result rslt;
+
+	rslt.code   = code;
+	rslt.errmsg = errmsg;
+	curl_mime_free(req->mime);
+	req->mime = NULL;
+	if (req->hcurl) release_handle(req->hcurl);
+	req->hcurl = NULL;
+	if (req->slot) req->slot(rslt);
+}
+
+void DBCurl::reg_async(const string &url, mmapstr &kvs, mmapstr &file, const string &pathdir,
+		const ResultSlot &slot, const charray &data, int64_t size) {
+	batchptr batch;
+
+	mutex_lock lck(mtx_);
+	if (!batchok_ && microsec_clock::universal_time() >= batchprobe_) batchok_ = true;
+	// 批量请求仅对应逐条注册URL, 其它请求直接发送
+	if (batchsize_ <= 1 || !batchok_ || url != urlRegImage_) {
+		lck.unlock();
+		curl_upload_async(url, kvs, file, pathdir, slot, data, size);
+		return;
+	}
+
+	if (!batch_.use_count()) {
+		batch_ = boost::make_shared<batchvec>();
+		batchdue_ = microsec_clock::universal_time() + milliseconds(batchwindow_);
 	}
-	else {// curl成功
-		long http_code(0);
-		curlcode_ = curl_easy_getinfo(hCurl, CURLINFO_RESPONSE_CODE, &http_code);
-		if (curlcode_ != CURLE_OK) {
-			sprintf(errmsg_, "Error line[%d]. URL[%s]. %s", __LINE__, url.c_str(),
-					curl_easy_strerror(curlcode_));
+	batch_item item;
+	item.url = url;
+	item.kvs.swap(kvs);
+	item.file.swap(file);
+	item.pathdir = pathdir;
+	item.slot    = slot;
+	item.data    = data;
+	item.size    = size;
+	batch_->push_back(item);
+	lck.unlock();
+
+	batch = take_batch();
+	if (batch.use_count()) send_batch(batch);
+	else curl_multi_wakeup(hmulti_);
+}
+
+DBCurl::batchptr DBCurl::take_batch(bool force) {
+	mutex_lock lck(mtx_);
+	batchptr batch;
+
+	if (batch_.use_count() && (force || int(batch_->size()) >= batchsize_
+			|| microsec_clock::universal_time() >= batchdue_)) {
+		batch.swap(batch_);
+	}
+	return batch;
+}
+
+void DBCurl::send_batch(batchptr batch) {
+	if (!batch.use_count() || batch->empty()) return;
+
+	/* 先行准备各记录的文件: 失败的记录单独报告结果, 不影响其它记录 */
+	std::vector<srcvec> srcs;
+	batchvec kept;
+	for (batchvec::iterator it = batch->begin(); it != batch->end(); ++it) {
+		srcvec x;
+		string errmsg;
+		if (open_sources(it->url, it->file, it->pathdir, it->data, it->size, x, errmsg)) {
+			kept.push_back(*it);
+			srcs.push_back(x);
+		}
+		else if (it->slot) {
+			curl_result rslt;
+			rslt.code   = DBCURL_MAP;
+			rslt.errmsg = errmsg;
+			it->slot(rslt);
 		}
 	}
+	batch->swap(kept);
+	if (batch->empty()) return;
 
-	curl_formfree(post);
-	curl_easy_cleanup(hCurl);
+	reqptr req = new_request(urlRegBatch_, boost::bind(&DBCurl::on_batch_result, this, batch, _1));
+	if (!req.use_count()) {
+		for (std::vector<srcvec>::iterator it = srcs.begin(); it != srcs.end(); ++it) {
+			for (srcvec::iterator x = it->begin(); x != it->end(); ++x) mime_free(*x);
+		}
+		return;
+	}
+	/* 记录数量在前, 各记录的字段名带有序号前缀: records[i].camId */
+	mmapstr count, nofile;
+	srcvec nosrc;
+	count.insert(pairstr("count", to_string(batch->size())));
+	add_parts(req, count, nofile, nosrc, "");
+	for (size_t i = 0; i < batch->size(); ++i) {
+		batch_item &item = (*batch)[i];
+		add_parts(req, item.kvs, item.file, srcs[i], "records[" + to_string(i) + "].");
+	}
+	submit(req);
+}
+
+void DBCurl::on_batch_result(batchptr batch, const curl_result &rslt) {
+	long code = rslt.httpcode;
+	bool rejected = rslt.code == 0 && ((code >= 400 && code < 500 && code != 408 && code != 429) || code == 501);
+
+	if (!rejected) {
+		for (batchvec::iterator it = batch->begin(); it != batch->end(); ++it) {
+			if (it->slot) it->slot(rslt);
+		}
+		return;
+	}
 
-	return curlcode_;
+	/* 数据库不接受批量注册: 逐条重新提交 */
+	mutex_lock lck(mtx_);
+	if (batchok_) {
+		batchok_    = false;
+		batchprobe_ = microsec_clock::universal_time() + hours(1);
+		snprintf(errmsg_, sizeof(errmsg_), "URL[%s] rejected batch registration, HTTP %ld", urlRegBatch_.c_str(), code);
+	}
+	lck.unlock();
+	for (batchvec::iterator it = batch->begin(); it != batch->end(); ++it)
+		curl_upload_async(it->url, it->kvs, it->file, it->pathdir, it->slot, it->data, it->size);
 }
 
-//////////////////////////////////////////////////////////////////////////////
-/* 成员函数 */
-//////////////////////////////////////////////////////////////////////////////
+CURL *DBCurl::acquire_handle() {
+	mutex_lock lck(mtx_);
+	CURL *hCurl;
+
+	if (idle_.empty()) return curl_easy_init();
+	hCurl = idle_.back();
+	idle_.pop_back();
+	curl_easy_reset(hCurl);
+	return hCurl;
+}
+
+void DBCurl::release_handle(CURL *hCurl) {
+	mutex_lock lck(mtx_);
+	if (int(idle_.size()) < maxconn_) idle_.push_back(hCurl);
+	else curl_easy_cleanup(hCurl);
+}
+
+void DBCurl::thread_multi() {
+	CURLMsg *msg;
+	int nrun, nmsg, timeout;
+
+	while(1) {
+		boost::this_thread::interruption_point();
+		send_batch(take_batch());
+
+		mutex_lock lck(mtx_);
+		timeout = 1000;
+		if (batch_.use_count()) {
+			long ms = (batchdue_ - microsec_clock::universal_time()).total_milliseconds();
+			timeout = ms < 0 ? 0 : (ms < timeout ? int(ms) : timeout);
+		}
+		std::vector<reqptr> rejected;
+		int rc;
+		while (!pending_.empty() && running_.size() < size_t(limit_) && (rc = admit()) != 0) {
+			reqptr req = pending_.front();
+			pending_.pop_front();
+			if (rc < 0) rejected.push_back(req);
+			else {
+				running_[req->hcurl] = req;
+				curl_multi_add_handle(hmulti_, req->hcurl);
+			}
+		}
+		if (breaker_ == BREAKER_OPEN) {
+			long ms = (reopen_ - microsec_clock::universal_time()).total_milliseconds();
+			if (ms >= 0 && ms < timeout) timeout = int(ms);
+		}
+		lck.unlock();
+		for (std::vector<reqptr>::iterator it = rejected.begin(); it != rejected.end(); ++it)
+			fail_request(*it, DBCURL_CIRCUIT, "URL[" + (*it)->url + "]. circuit breaker is open");
+
+		curl_multi_perform(hmulti_, &nrun);
+		while ((msg = curl_multi_info_read(hmulti_, &nmsg))) {
+			if (msg->msg == CURLMSG_DONE) finish_request(msg->easy_handle, msg->data.result);
+		}
+		curl_multi_poll(hmulti_, NULL, 0, timeout, NULL);
+	}
+}
+
+void DBCurl::finish_request(CURL *hCurl, CURLcode code) {
+	mutex_lock lck(mtx_);
+	std::map<CURL*, reqptr>::iterator it = running_.find(hCurl);
+	if (it == running_.end()) return;
+	reqptr req = it->second;
+	running_.erase(it);
+	lck.unlock();
+
+	curl_result rslt;
+	char errmsg[200];
+
+	curl_multi_remove_handle(hmulti_, hCurl);
+	if (code != CURLE_OK) {// curl错误
+		snprintf(errmsg, sizeof(errmsg), "Error line[%d]. URL[%s]. %s", __LINE__, req->url.c_str(),
+				curl_easy_strerror(code));
+	}
+	else if ((code = curl_easy_getinfo(hCurl, CURLINFO_RESPONSE_CODE, &rslt.httpcode)) != CURLE_OK) {
+		snprintf(errmsg, sizeof(errmsg), "Error line[%d]. URL[%s]. %s", __LINE__, req->url.c_str(),
+				curl_easy_strerror(code));
+	}
+	rslt.code   = code;
+	rslt.copied = req->copied;
+	if (code != CURLE_OK) rslt.errmsg = errmsg;
+
+	/* 服务延时: 自发送请求至收到应答首字节 */
+	curl_off_t tmpre(0), tmstart(0);
+	curl_easy_getinfo(hCurl, CURLINFO_PRETRANSFER_TIME_T, &tmpre);
+	curl_easy_getinfo(hCurl, CURLINFO_STARTTRANSFER_TIME_T, &tmstart);
+	feedback(code == CURLE_OK && rslt.httpcode < 500, (tmstart - tmpre) * 1E-6);
+
+	curl_mime_free(req->mime);
+	req->mime = NULL;
+	release_handle(hCurl);
+	if (req->slot) req->slot(rslt);
+}
+
+int DBCurl::admit() {
+	if (breaker_ == BREAKER_OPEN && microsec_clock::universal_time() >= reopen_) {
+		breaker_ = BREAKER_HALF;
+		probing_ = false;
+	}
+	if (breaker_ == BREAKER_OPEN) return -1;
+	if (breaker_ == BREAKER_HALF) {
+		if (probing_) return 0;
+		probing_ = true;
+	}
+	return 1;
+}
+
+void DBCurl::feedback(bool success, double rtt) {
+	mutex_lock lck(mtx_);
+	ptime now = microsec_clock::universal_time();
+	bool congested(false);
+
+	if (success) {
+		if (breaker_ != BREAKER_CLOSED) {
+			_gLog.Write("DBCurl: database <%s> recovered", urlRoot_.c_str());
+			breaker_ = BREAKER_CLOSED;
+			cooldown_ = COOLDOWN_MIN;
+		}
+		nfail_ = 0;
+		if (minrtt_ < 0.0 || rtt < minrtt_ || now >= rttexpire_) {// 基准延时每分钟更新一次, 跟踪服务端变化
+			minrtt_ = rtt;
+			rttexpire_ = now + minutes(1);
+		}
+		congested = rtt > 2.0 * minrtt_ + 0.001;
+	}
+	else {
+		++nfail_;
+		if (breaker_ == BREAKER_HALF) {// 探测失败, 延长冷却时间
+			breaker_ = BREAKER_OPEN;
+			cooldown_ = std::min(cooldown_ * 2, COOLDOWN_MAX);
+			reopen_ = now + seconds(cooldown_);
+		}
+		else if (breaker_ == BREAKER_CLOSED && nfail_ >= failmax_) {
+			_gLog.Write(LOG_WARN, "DBCurl", "database <%s> is unavailable after %d failures, requests are held for %d seconds",
+					urlRoot_.c_str(), nfail_, cooldown_);
+			breaker_ = BREAKER_OPEN;
+			reopen_ = now + seconds(cooldown_);
+		}
+	}
+
+	/* AIMD: 每个基准延时周期内至多减半一次 */
+	if (!success || congested) {
+		if ((now - lastcut_).total_microseconds() * 1E-6 > std::max(minrtt_, 0.1)) {
+			limit_ = std::max(1.0, limit_ * 0.5);
+			lastcut_ = now;
+		}
+	}
+	else limit_ = std::min(double(maxconn_), limit_ + 1.0 / limit_);
+}
 
 //////////////////////////////////////////////////////////////////////////////
 /* 接口 */
@@ -125,6 +609,32 @@ const char *DBCurl::GetErrmsg() {
 	return errmsg_;
 }
 
+void DBCurl::SetTimeout(int connect, int total, int failmax) {
+	mutex_lock lck(mtx_);
+	tmconnect_ = connect;
+	tmtotal_   = total;
+	failmax_   = failmax < 1 ? 1 : failmax;
+}
+
+bool DBCurl::Blocked(ptime &until) {
+	mutex_lock lck(mtx_);
+	until = reopen_;
+	return breaker_ == BREAKER_OPEN && microsec_clock::universal_time() < reopen_;
+}
+
+void DBCurl::SetBatch(const string &url, int size, int window) {
+	batchptr batch;
+
+	mutex_lock lck(mtx_);
+	if (!url.empty()) urlRegBatch_ = url;
+	batchsize_   = size;
+	batchwindow_ = window < 0 ? 0 : window;
+	batchok_     = true;
+	if (batchsize_ <= 1) batch.swap(batch_);
+	lck.unlock();
+	send_batch(batch);
+}
+
 int DBCurl::UploadObsPlan(const string &plan_sn, int mode, const string &btime, const string &etime) {
 	mmapstr kvs, file;
 
@@ -241,6 +751,67 @@ int DBCurl::RegImageFile(const string &cid, const string &filename, const string
 	return curl_upload(urlRegImage_, kvs, file, filepath);
 }
 
+void DBCurl::RegImageFileAsync(const string &cid, const string &filename, const string &filepath,
+		const string &tmobs, int microsec, const ResultSlot &slot, const charray &data, int64_t size,
+		const string &checksum, const std::map<string, string> &keywords) {
+	mmapstr kvs, file;
+
+	kvs.insert (pairstr("camId",        cid));
+	kvs.insert (pairstr("imgName",      filename));
+	kvs.insert (pairstr("imgPath",      filepath));
+	kvs.insert (pairstr("genTime",      tmobs));
+	kvs.insert (pairstr("microSecond",  to_string(microsec)));
+	if (!checksum.empty()) kvs.insert(pairstr("checksum", checksum));
+	kvs.insert(keywords.begin(), keywords.end());
+	file.insert(pairstr("fileUpload",   filename));
+
+	reg_async(urlRegImage_, kvs, file, filepath, slot, data, size);
+}
+
+void DBCurl::RegImageRefAsync(const string &cid, const string &filename, const string &filepath,
+		const string &tmobs, int microsec, int64_t filesize, const string &checksum,
+		const std::map<string, string> &keywords, const ResultSlot &slot) {
+	mmapstr kvs, file;
+
+	kvs.insert (pairstr("camId",        cid));
+	kvs.insert (pairstr("imgName",      filename));
+	kvs.insert (pairstr("imgPath",      filepath));
+	kvs.insert (pairstr("genTime",      tmobs));
+	kvs.insert (pairstr("microSecond",  to_string(microsec)));
+	kvs.insert (pairstr("fileSize",     to_string(filesize)));
+	if (!checksum.empty()) kvs.insert(pairstr("checksum", checksum));
+	kvs.insert(keywords.begin(), keywords.end());
+
+	curl_upload_async(urlRegRef_, kvs, file, filepath, slot);
+}
+
+void DBCurl::UploadImageFileAsync(const string &cid, const string &filename, const string &filepath,
+		const string &tmobs, int microsec, const ResultSlot &slot) {
+	mmapstr kvs, file;
+
+	kvs.insert (pairstr("camId",        cid));
+	kvs.insert (pairstr("imgName",      filename));
+	kvs.insert (pairstr("imgPath",      filepath));
+	kvs.insert (pairstr("genTime",      tmobs));
+	kvs.insert (pairstr("microSecond",  to_string(microsec)));
+	file.insert(pairstr("fileUpload",   filename));
+
+	curl_upload_async(urlRegImage_, kvs, file, filepath, slot);
+}
+
+void DBCurl::MoveImageAsync(const string &cid, const string &filename, const string &pathdir,
+		const string &oldpath, const string &container, const ResultSlot &slot) {
+	mmapstr kvs, file;
+
+	kvs.insert (pairstr("camId",        cid));
+	kvs.insert (pairstr("imgName",      filename));
+	kvs.insert (pairstr("imgPath",      pathdir));
+	kvs.insert (pairstr("oldPath",      oldpath));
+	if (!container.empty()) kvs.insert(pairstr("imgContainer", container));
+
+	curl_upload_async(urlMoveImage_, kvs, file, pathdir, slot);
+}
+
 int DBCurl::UploadFrameOT(const string &filepath, const string &filename) {
 	mmapstr kvs, file;
 
@@ -4,6 +4,23 @@
  * @date 2019-11-10
  * @note
  * 上传操作返回值0表示正确; 当非0时, 错误信息记录在errmsg_中
+ * @version 0.2
+ * @date 2026-10-19
+ * @note
+ * - 复用curl easy句柄, 保持与数据库的长连接
+ * - 由curl_multi事件循环线程并发执行请求
+ * - 异步接口通过回调函数返回结果; 同步接口等待回调完成
+ * - 可选批量注册: 按数量或时间窗口累积注册记录, 一次提交. 表单以count字段开始,
+ *   第i条记录的字段名带有前缀records[i]., 如records[0].camId、records[0].fileUpload.
+ *   数据库拒绝批量请求时, 逐条重新提交, 并在一段时间内停用批量注册.
+ *   单条记录的文件无法读取时, 仅该记录失败, 其余记录照常提交
+ * - 按引用注册: 仅发送文件路径、大小、校验和及FITS关键字, 不上传文件内容
+ * - 文件迁移或打包后, 更新已注册的文件路径
+ * - 以curl_mime构建表单, 文件数据由读回调直接取自内存缓冲区或文件映射, 不经临时文件
+ * - libcurl全局初始化在进程内仅执行一次
+ * - 请求设置连接超时和总超时
+ * - 熔断: 连续失败达到阈值后, 在冷却期内直接拒绝请求; 冷却期满后以单个探测请求试探恢复
+ * - 自适应并发(AIMD): 请求成功时并发上限线性增长; 失败或服务延时超过基准2倍时减半
  */
 
 #ifndef DBCURL_H_
@@ -11,19 +28,89 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <deque>
 #include <curl/curl.h>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 using std::string;
 
 typedef std::multimap<string, string> mmapstr;
+typedef boost::shared_array<char> charray;
+
+enum {// DBCurl自定义错误代码, 与curl错误代码区分
+	DBCURL_EMPTY   = -1,	//< 无参数
+	DBCURL_INIT    = -2,	//< 创建curl句柄失败
+	DBCURL_MAP     = -3,	//< 映射文件失败
+	DBCURL_CIRCUIT = -4		//< 熔断中, 未发送请求
+};
+
+struct curl_result {// 请求结果
+	int code;		//< curl错误代码. 0: 成功
+	long httpcode;	//< HTTP状态码
+	string errmsg;	//< 错误描述
+	int64_t copied;	//< 由读回调复制到curl发送缓冲区的文件字节数
+
+public:
+	curl_result() {
+		code = 0;
+		httpcode = 0;
+		copied = 0;
+	}
+};
 
 class DBCurl {
 public:
-	DBCurl(const string &urlRoot);
+	/*!
+	 * @brief 构造函数
+	 * @param urlRoot  URL根地址
+	 * @param maxconn  最大并发连接数量
+	 */
+	DBCurl(const string &urlRoot, int maxconn = 4);
 	virtual ~DBCurl();
 
+public:
+	// 数据类型
+	typedef boost::function<void (const curl_result&)> ResultSlot;	//< 异步请求结果回调函数
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+
+	struct mime_source {// 上传文件的数据源: 内存缓冲区或文件映射
+		charray buffer;		//< 内存缓冲区. 在上传完成前保持引用
+		const char *data;	//< 数据首地址
+		int64_t size;		//< 数据长度, 量纲: 字节
+		int64_t offset;		//< 读出位置
+		void *mapped;		//< 文件映射地址. NULL: 数据来自内存缓冲区
+		int64_t *copied;	//< 累计复制字节数
+	};
+	typedef std::vector<mime_source*> srcvec;
+
+protected:
+	struct curl_request {// 异步请求
+		CURL *hcurl;	//< easy句柄
+		curl_mime *mime;	//< 表单
+		string url;		//< URL地址
+		ResultSlot slot;	//< 结果回调函数
+		int64_t copied;	//< 由读回调复制的文件字节数
+	};
+	typedef boost::shared_ptr<curl_request> reqptr;
+
+	struct batch_item {// 批量注册中的单条记录
+		string url;		//< 逐条注册时的URL地址
+		mmapstr kvs;	//< 键值对
+		mmapstr file;	//< 文件名
+		string pathdir;	//< 文件目录
+		ResultSlot slot;	//< 结果回调函数
+		charray data;	//< 内存中的文件数据. 为空时映射磁盘文件
+		int64_t size;	//< 内存中的文件数据长度, 量纲: 字节
+	};
+	typedef std::vector<batch_item> batchvec;
+	typedef boost::shared_ptr<batchvec> batchptr;
+
 protected:
-	static int cnt_used_;		//< libcurl初始化标志
+	static boost::once_flag once_;	//< libcurl初始化标志
 	static CURLcode curlcode_;	//< 故障字
 	/* 成员变量 */
 	string urlRoot_;			//< URL地址: 根
@@ -38,18 +125,45 @@ protected:
 	string urlRainfall_;		//< URL地址: 雨水传感
 	string urlRegImage_;		//< URL地址: 注册及上传FITS文件
 	string urlUploadFile_;		//< URL地址: 上传文件
+	string urlRegRef_;			//< URL地址: 按引用注册FITS文件
+	string urlMoveImage_;		//< URL地址: 更新FITS文件路径
 	char errmsg_[200];			//< 错误记录
+	/* 连接池与事件循环 */
+	int maxconn_;				//< 最大并发连接数量
+	CURLM *hmulti_;				//< multi句柄, 维护连接缓存
+	std::vector<CURL*> idle_;	//< 空闲easy句柄
+	std::deque<reqptr> pending_;	//< 待执行请求
+	std::map<CURL*, reqptr> running_;	//< 执行中请求
+	boost::mutex mtx_;			//< 互斥锁: 句柄与请求队列
+	boost::shared_ptr<boost::thread> thrdmulti_;	//< 线程: curl_multi事件循环
+	/* 超时、熔断与自适应并发 */
+	int tmconnect_;				//< 连接超时, 量纲: 毫秒
+	int tmtotal_;				//< 总超时, 量纲: 毫秒
+	int failmax_;				//< 熔断阈值: 连续失败次数
+	int nfail_;					//< 连续失败次数
+	int breaker_;				//< 熔断状态
+	int cooldown_;				//< 熔断冷却时间, 量纲: 秒
+	bool probing_;				//< 半开状态下的探测请求执行中
+	boost::posix_time::ptime reopen_;	//< 熔断冷却结束时间
+	double limit_;				//< 自适应并发上限
+	double minrtt_;				//< 基准服务延时, 量纲: 秒
+	boost::posix_time::ptime rttexpire_;	//< 基准服务延时的更新时间
+	boost::posix_time::ptime lastcut_;		//< 上次减小并发上限的时间
+	/* 批量注册 */
+	string urlRegBatch_;		//< URL地址: 批量注册FITS文件
+	int batchsize_;				//< 单次批量注册的最大记录数. 不大于1时逐条注册
+	int batchwindow_;			//< 累积注册记录的最长时间, 量纲: 毫秒
+	bool batchok_;				//< 数据库接受批量注册
+	batchptr batch_;			//< 累积中的注册记录
+	boost::posix_time::ptime batchdue_;		//< 累积记录的发送时间
+	boost::posix_time::ptime batchprobe_;	//< 被拒绝后再次尝试批量注册的时间
 
 protected:
 	/* 成员函数 */
 	/*!
-	 * @brief 在使用libcurl时, 执行一次初始化操作
+	 * @brief 初始化libcurl, 并在进程退出时释放
 	 */
 	static void init();
-	/*!
-	 * @brief
-	 */
-	static void cleanup();
 	/*!
 	 * @brief 初始化可用URL路径
 	 */
@@ -66,15 +180,159 @@ protected:
 	 * 其它: 错误代码
 	 */
 	int curl_upload(const string &url, mmapstr &kvs, mmapstr &file, const string &pathdir);
+	/*!
+	 * @brief 异步发送键值对和文件数据
+	 * @param url       URL地址
+	 * @param kvs       键值对
+	 * @param file      文件名
+	 * @param pathdir   文件目录
+	 * @param slot      结果回调函数, 在事件循环线程中调用
+	 * @param data      内存中的文件数据. 仅有一个文件时有效; 为空时映射磁盘文件
+	 * @param size      内存中的文件数据长度, 量纲: 字节
+	 */
+	void curl_upload_async(const string &url, mmapstr &kvs, mmapstr &file, const string &pathdir,
+			const ResultSlot &slot, const charray &data = charray(), int64_t size = 0);
+	/*!
+	 * @brief 异步注册. 启用批量注册且url为regOrigImg.action时累积记录, 否则立即发送
+	 * @param url       逐条注册时的URL地址
+	 * @param kvs       键值对
+	 * @param file      文件名
+	 * @param pathdir   文件目录
+	 * @param slot      结果回调函数
+	 * @param data      内存中的文件数据
+	 * @param size      内存中的文件数据长度, 量纲: 字节
+	 */
+	void reg_async(const string &url, mmapstr &kvs, mmapstr &file, const string &pathdir,
+			const ResultSlot &slot, const charray &data = charray(), int64_t size = 0);
+	/*!
+	 * @brief 创建请求: 取出easy句柄并创建表单
+	 * @return
+	 * 失败时返回空指针, 并已通过回调函数报告错误
+	 */
+	reqptr new_request(const string &url, const ResultSlot &slot);
+	/*!
+	 * @brief 在表单中添加键值对和文件
+	 * @param req       请求
+	 * @param kvs       键值对
+	 * @param file      文件名
+	 * @param pathdir   文件目录
+	 * @param data      内存中的文件数据
+	 * @param size      内存中的文件数据长度, 量纲: 字节
+	 * @return
+	 * 失败时已释放请求, 并已通过回调函数报告错误
+	 */
+	bool add_form(reqptr req, mmapstr &kvs, mmapstr &file, const string &pathdir,
+			const charray &data = charray(), int64_t size = 0);
+	/*!
+	 * @brief 准备待上传文件的数据源
+	 * @param url       URL地址, 用于错误描述
+	 * @param file      文件名
+	 * @param pathdir   文件目录
+	 * @param data      内存中的文件数据
+	 * @param size      内存中的文件数据长度, 量纲: 字节
+	 * @param srcs      数据源, 与file逐一对应
+	 * @param errmsg    错误描述
+	 * @return
+	 * 映射文件失败时返回false, 并已释放已准备的数据源
+	 */
+	bool open_sources(const string &url, mmapstr &file, const string &pathdir, const charray &data,
+			int64_t size, srcvec &srcs, string &errmsg);
+	/*!
+	 * @brief 在表单中添加键值对和已准备的文件数据源
+	 * @param prefix 字段名前缀
+	 * @note
+	 * 数据源的所有权转交表单
+	 */
+	void add_parts(reqptr req, mmapstr &kvs, mmapstr &file, srcvec &srcs, const string &prefix);
+	/*!
+	 * @brief 以只读方式映射文件
+	 */
+	bool map_file(const string &filepath, mime_source *src);
+	/*!
+	 * @brief 将请求提交给事件循环线程
+	 */
+	void submit(reqptr req);
+	/*!
+	 * @brief 释放未提交的请求, 并通过回调函数报告错误
+	 */
+	void fail_request(reqptr req, int code, const string &errmsg);
+	/*!
+	 * @brief 取出已满或已到期的累积注册记录
+	 * @param force 忽略数量和时间窗口
+	 */
+	batchptr take_batch(bool force = false);
+	/*!
+	 * @brief 发送批量注册请求
+	 */
+	void send_batch(batchptr batch);
+	/*!
+	 * @brief 处理批量注册结果
+	 */
+	void on_batch_result(batchptr batch, const curl_result &rslt);
+	/*!
+	 * @brief 从连接池中取出easy句柄
+	 */
+	CURL *acquire_handle();
+	/*!
+	 * @brief 将easy句柄归还连接池
+	 */
+	void release_handle(CURL *hcurl);
+	/*!
+	 * @brief 线程: curl_multi事件循环
+	 */
+	void thread_multi();
+	/*!
+	 * @brief 处理已完成的请求
+	 */
+	void finish_request(CURL *hcurl, CURLcode code);
+	/*!
+	 * @brief 由熔断状态判定是否发送请求
+	 * @return
+	 * 1: 发送; 0: 暂缓; -1: 拒绝
+	 */
+	int admit();
+	/*!
+	 * @brief 依据请求结果更新熔断状态与并发上限
+	 * @param success 请求成功
+	 * @param rtt     服务延时, 量纲: 秒
+	 */
+	void feedback(bool success, double rtt);
 
 public:
 	/* 接口 */
+	/*!
+	 * @brief 初始化libcurl. 进程内仅执行一次
+	 */
+	static void GlobalInit();
+	/*!
+	 * @brief 设置超时与熔断阈值
+	 * @param connect   连接超时, 量纲: 毫秒
+	 * @param total     总超时, 量纲: 毫秒
+	 * @param failmax   熔断阈值: 连续失败次数
+	 */
+	void SetTimeout(int connect, int total, int failmax);
+	/*!
+	 * @brief 查看是否处于熔断冷却期
+	 * @param until 冷却结束时间
+	 * @return
+	 * 熔断时返回true
+	 */
+	bool Blocked(boost::posix_time::ptime &until);
 	/*!
 	 * @brief 查看故障描述
 	 * @return
 	 * 故障描述首地址
 	 */
 	const char *GetErrmsg();
+	/*!
+	 * @brief 设置批量注册
+	 * @param url     批量注册URL地址. 为空时使用URL根地址下的regOrigImgBatch.action
+	 * @param size    单次批量注册的最大记录数. 不大于1时逐条注册
+	 * @param window  累积注册记录的最长时间, 量纲: 毫秒
+	 * @note
+	 * 批量注册仅作用于RegImageFileAsync(). RegImageRefAsync()等其它请求逐条发送
+	 */
+	void SetBatch(const string &url, int size, int window);
 	/*!
 	 * @brief 上传一条观测计划
 	 * @param plan_sn  计划编号
@@ -181,6 +439,64 @@ public:
 	 * 传输结果
 	 */
 	int RegImageFile(const string &cid, const string &filename, const string &pathdir, const string &tmobs, int microsec);
+	/*!
+	 * @brief 异步注册并上传FITS文件
+	 * @note
+	 * 启用批量注册时, 记录先行累积, 由批量请求一次提交
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param pathdir   文件目录
+	 * @param tmobs     曝光起始时间, 格式: CCYYMMDDThhmmss
+	 * @param microsec  曝光起始时间的微秒位
+	 * @param slot      结果回调函数
+	 * @param data      内存中的文件数据. 为空时映射磁盘文件
+	 * @param size      内存中的文件数据长度, 量纲: 字节
+	 * @param checksum  文件校验和. 为空时不发送
+	 * @param keywords  FITS关键字, 以关键字为字段名发送
+	 */
+	void RegImageFileAsync(const string &cid, const string &filename, const string &pathdir,
+			const string &tmobs, int microsec, const ResultSlot &slot,
+			const charray &data = charray(), int64_t size = 0, const string &checksum = string(),
+			const std::map<string, string> &keywords = std::map<string, string>());
+	/*!
+	 * @brief 异步按引用注册FITS文件, 不上传文件内容
+	 * @note
+	 * 不参与批量注册, 直接发送至regOrigImgRef.action
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param pathdir   文件目录
+	 * @param tmobs     曝光起始时间, 格式: CCYYMMDDThhmmss
+	 * @param microsec  曝光起始时间的微秒位
+	 * @param filesize  文件大小, 量纲: 字节
+	 * @param checksum  文件校验和. 为空时不发送
+	 * @param keywords  FITS关键字, 以关键字为字段名发送
+	 * @param slot      结果回调函数
+	 */
+	void RegImageRefAsync(const string &cid, const string &filename, const string &pathdir,
+			const string &tmobs, int microsec, int64_t filesize, const string &checksum,
+			const std::map<string, string> &keywords, const ResultSlot &slot);
+	/*!
+	 * @brief 异步上传已按引用注册的FITS文件. 不参与批量注册
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param pathdir   文件目录
+	 * @param tmobs     曝光起始时间, 格式: CCYYMMDDThhmmss
+	 * @param microsec  曝光起始时间的微秒位
+	 * @param slot      结果回调函数
+	 */
+	void UploadImageFileAsync(const string &cid, const string &filename, const string &pathdir,
+			const string &tmobs, int microsec, const ResultSlot &slot);
+	/*!
+	 * @brief 异步更新已注册FITS文件的路径. 不参与批量注册
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param pathdir   新的文件目录
+	 * @param oldpath   原文件目录
+	 * @param container 文件已打包至该容器(完整路径). 为空时文件位于新目录
+	 * @param slot      结果回调函数
+	 */
+	void MoveImageAsync(const string &cid, const string &filename, const string &pathdir,
+			const string &oldpath, const string &container, const ResultSlot &slot);
 	/*!
 	 * @brief 上传单帧图像中识别的候选体
 	 * @param filepath  文件路径
@@ -199,4 +515,6 @@ public:
 	int UploadOrbit(const string &pathdir, const string &filename);
 };
 
+typedef boost::shared_ptr<DBCurl> DBCurlPtr;
+
 #endif /* DBCURL_H_ */
@@ -0,0 +1,461 @@
+/*!
+ * @file DBRegister.cpp 数据库异步注册管理器定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/bind/bind.hpp>
+#include "DBRegister.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::placeholders;
+
+#define DBREG_PINNED	(int64_t(256) << 20)	//< 注册信息持有的内存文件数据上限, 量纲: 字节
+#define DBREG_MAPTRIES	3		//< 文件无法读取时的最多尝试次数. 迁移后的路径更新可能稍后到达
+#define DBREG_DEAD		".dead"	//< 死信文件后缀: 数据库拒绝或无法完成的注册信息
+
+DBRegister::DBRegister(const string &url, int nworker, int capacity, const string &outbox,
+		bool upload, int64_t rate) {
+	url_        = url;
+	capacity_   = capacity < 1 ? 1 : capacity;
+	pathOutbox_ = outbox;
+	idnext_     = 1;
+	overflow_   = false;
+	upload_     = upload;
+	uprate_     = rate;
+	upnext_     = microsec_clock::universal_time();
+	nupload_    = 0;
+	copied_     = 0;
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(boost::filesystem::path(outbox).parent_path(), ec);
+	load_outbox(true);
+	if (!(fpOutbox_ = fopen(pathOutbox_.c_str(), "a")))
+		_gLog.Write(LOG_WARN, "DBRegister", "failed to open outbox<%s>. %s", outbox.c_str(), strerror(errno));
+
+	nworker_  = nworker < 1 ? 1 : nworker;
+	maxinflight_ = nworker_;
+	inflight_ = 0;
+	pinned_   = 0;
+	db_ = boost::make_shared<DBCurl>(url, nworker_);
+	thrddispatch_.reset(new boost::thread(boost::bind(&DBRegister::thread_dispatch, this)));
+}
+
+DBRegister::~DBRegister() {
+	thrddispatch_->interrupt();
+	thrddispatch_->join();
+	db_.reset();
+	if (fpOutbox_) fclose(fpOutbox_);
+	if (active_.size() || overflow_)
+		_gLog.Write(LOG_WARN, "DBRegister", "unregistered files are kept in outbox<%s>", pathOutbox_.c_str());
+}
+
+void DBRegister::RegImageFile(const string &cid, const string &filename, const string &pathdir,
+		const string &tmobs, int microsec, const charray &data, int64_t size, const string &checksum,
+		const std::map<string, string> &keywords) {
+	imgregptr reg = boost::make_shared<imgreg>();
+	reg->cid      = cid;
+	reg->filename = filename;
+	reg->pathdir  = pathdir;
+	reg->tmobs    = tmobs;
+	reg->microsec = microsec;
+	reg->tries    = 0;
+	reg->byref    = false;
+	reg->filesize = size;
+	reg->uploading = false;
+	reg->checksum = checksum;
+	for (std::map<string, string>::const_iterator it = keywords.begin(); it != keywords.end(); ++it) {
+		string value = it->second;
+		std::replace_if(value.begin(), value.end(), boost::is_any_of("\t\r\n"), ' ');
+		reg->keywords[it->first] = value;
+	}
+
+	mutex_lock lck(mtx_);
+	reg->id = idnext_++;
+	append_outbox(outbox_line(reg) + "\n");
+	// 仅在可立即分派且未超出上限时持有内存数据, 否则由磁盘文件上传
+	ptime until;
+	if (data && inflight_ < maxinflight_ && !db_->Blocked(until) && pinned_ + size <= DBREG_PINNED) {
+		reg->data = data;
+		pinned_ += size;
+	}
+	if (!push(reg, microsec_clock::universal_time())) {
+		release(reg);
+		overflow_ = true;
+	}
+}
+
+void DBRegister::RegImageRef(const string &cid, const string &filename, const string &pathdir,
+		const string &tmobs, int microsec, int64_t filesize, const string &checksum,
+		const std::map<string, string> &keywords) {
+	imgregptr reg = boost::make_shared<imgreg>();
+	reg->cid      = cid;
+	reg->filename = filename;
+	reg->pathdir  = pathdir;
+	reg->tmobs    = tmobs;
+	reg->microsec = microsec;
+	reg->tries    = 0;
+	reg->byref    = true;
+	reg->filesize = filesize;
+	reg->checksum = checksum;
+	reg->uploading = false;
+	for (std::map<string, string>::const_iterator it = keywords.begin(); it != keywords.end(); ++it) {
+		// 发件箱以制表符和换行符分隔, 从关键字中剔除
+		string value = it->second;
+		std::replace_if(value.begin(), value.end(), boost::is_any_of("\t\r\n"), ' ');
+		reg->keywords[it->first] = value;
+	}
+
+	mutex_lock lck(mtx_);
+	reg->id = idnext_++;
+	append_outbox(outbox_line(reg) + "\n");
+	if (!push(reg, microsec_clock::universal_time())) overflow_ = true;
+}
+
+void DBRegister::RegImageMove(const string &cid, const string &filename, const string &oldpath,
+		const string &pathdir, const string &container) {
+	imgregptr reg = boost::make_shared<imgreg>();
+	reg->cid       = cid;
+	reg->filename  = filename;
+	reg->pathdir   = pathdir;
+	reg->microsec  = 0;
+	reg->tries     = 0;
+	reg->byref     = false;
+	reg->filesize  = 0;
+	reg->uploading = false;
+	reg->oldpath   = oldpath;
+	reg->container = container;
+
+	mutex_lock lck(mtx_);
+	// 尚未完成的注册改由新目录读取文件. 已打包的文件仍由原路径注册, 完成后再更新
+	if (container.empty()) {
+		for (regMap::iterator it = active_.begin(); it != active_.end(); ++it) {
+			imgregptr x = it->second;
+			if (x->oldpath.empty() && x->filename == filename && x->pathdir == oldpath) x->pathdir = pathdir;
+		}
+	}
+	reg->id = idnext_++;
+	append_outbox(outbox_line(reg) + "\n");
+	if (!push(reg, microsec_clock::universal_time())) overflow_ = true;
+}
+
+void DBRegister::SetTimeout(int connect, int total, int failmax) {
+	db_->SetTimeout(connect, total, failmax);
+}
+
+void DBRegister::SetBatch(const string &url, int size, int window) {
+	db_->SetBatch(url, size, window);
+
+	mutex_lock lck(mtx_);
+	maxinflight_ = size > 1 ? nworker_ * size : nworker_;
+	cvreg_.notify_all();
+}
+
+int DBRegister::Pending() {
+	mutex_lock lck(mtx_);
+	return active_.size();
+}
+
+void DBRegister::thread_dispatch() {
+	regQueue::iterator it;
+	imgregptr reg;
+	ptime until;
+
+	while(1) {
+		mutex_lock lck(mtx_);
+		while(1) {
+			if (inflight_ >= maxinflight_) {// 数据库响应慢: 排队的注册不再持有内存数据
+				release_queued();
+				cvreg_.wait(lck);
+			}
+			else if (queue_.empty()) {
+				if (overflow_) load_outbox(false);
+				if (queue_.empty()) cvreg_.wait(lck);
+			}
+			else if (db_->Blocked(until)) {// 数据库熔断: 注册信息滞留在队列和发件箱中
+				release_queued();
+				cvreg_.timed_wait(lck, until);
+			}
+			else if ((it = queue_.begin())->first > microsec_clock::universal_time())
+				cvreg_.timed_wait(lck, it->first);
+			else break;
+		}
+		reg = it->second;
+		queue_.erase(it);
+		if (reg->uploading && !upload_) {// 已停用后台上传
+			complete(reg);
+			continue;
+		}
+		if (reg->oldpath.size() && registering(reg)) {// 该文件完成注册后再更新路径
+			push(reg, microsec_clock::universal_time() + seconds(10));
+			continue;
+		}
+		++inflight_;
+		lck.unlock();
+
+		if (reg->oldpath.size())
+			db_->MoveImageAsync(reg->cid, reg->filename, reg->pathdir, reg->oldpath, reg->container,
+					boost::bind(&DBRegister::on_result, this, reg, _1));
+		else if (reg->uploading)
+			db_->UploadImageFileAsync(reg->cid, reg->filename, reg->pathdir, reg->tmobs, reg->microsec,
+					boost::bind(&DBRegister::on_result, this, reg, _1));
+		else if (reg->byref)
+			db_->RegImageRefAsync(reg->cid, reg->filename, reg->pathdir, reg->tmobs, reg->microsec,
+					reg->filesize, reg->checksum, reg->keywords,
+					boost::bind(&DBRegister::on_result, this, reg, _1));
+		else
+			db_->RegImageFileAsync(reg->cid, reg->filename, reg->pathdir, reg->tmobs, reg->microsec,
+					boost::bind(&DBRegister::on_result, this, reg, _1), reg->data, reg->filesize, reg->checksum,
+					reg->keywords);
+	}
+}
+
+void DBRegister::on_result(imgregptr reg, const curl_result &rslt) {
+	mutex_lock lck(mtx_);
+	long code = rslt.httpcode;
+	bool success = rslt.code == 0 && code >= 200 && code < 300;
+	// 数据库拒绝(408、429以外的非2xx应答)或本地错误无法通过重试恢复
+	bool rejected = rslt.code == 0 && !success && code < 500 && code != 408 && code != 429;
+	bool local = rslt.code == DBCURL_EMPTY || (rslt.code == DBCURL_MAP && reg->tries + 1 >= DBREG_MAPTRIES);
+
+	--inflight_;
+	release(reg);
+	if (rslt.copied) {
+		++nupload_;
+		copied_ += rslt.copied;
+	}
+	if (success && reg->byref && !reg->uploading && upload_) {
+		// 完成按引用注册, 转入后台上传
+		boost::format fmt("U\t%d\n");
+		fmt % reg->id;
+		append_outbox(fmt.str());
+		reg->uploading = true;
+		reg->tries     = 0;
+		active_.erase(reg->id);
+		if (!push(reg, upload_time(reg))) overflow_ = true;
+	}
+	else if (success) {
+		complete(reg);
+	}
+	else if (rejected || local) {
+		dead_letter(reg, rslt.code ? rslt.errmsg : (boost::format("HTTP %d") % code).str());
+		complete(reg);
+	}
+	else if (rslt.code == DBCURL_CIRCUIT) {// 未发送: 不计入尝试次数, 待熔断结束后重新注册
+		active_.erase(reg->id);
+		if (!push(reg, microsec_clock::universal_time())) overflow_ = true;
+	}
+	else {
+		int delay = backoff(++reg->tries);
+		if ((reg->tries & (reg->tries - 1)) == 0) {
+			_gLog.Write(LOG_WARN, "DBRegister", "failed to register <%s> for %d times, retry in %d seconds. %s",
+					reg->filename.c_str(), reg->tries, delay,
+					rslt.code ? rslt.errmsg.c_str() : (boost::format("HTTP %d") % code).str().c_str());
+		}
+		active_.erase(reg->id);
+		if (!push(reg, microsec_clock::universal_time() + seconds(delay))) overflow_ = true;
+	}
+	cvreg_.notify_all();
+}
+
+void DBRegister::release(imgregptr reg) {
+	if (reg->data) {
+		reg->data.reset();
+		pinned_ -= reg->filesize;
+	}
+}
+
+bool DBRegister::registering(imgregptr move) {
+	for (regMap::iterator it = active_.begin(); it != active_.end(); ++it) {
+		imgregptr x = it->second;
+		if (x->oldpath.empty() && x->filename == move->filename
+				&& (x->pathdir == move->oldpath || x->pathdir == move->pathdir))
+			return true;
+	}
+	return false;
+}
+
+void DBRegister::release_queued() {
+	if (!pinned_) return;
+	for (regQueue::iterator it = queue_.begin(); it != queue_.end(); ++it) release(it->second);
+}
+
+void DBRegister::complete(imgregptr reg) {
+	boost::format fmt("D\t%d\n");
+	fmt % reg->id;
+	append_outbox(fmt.str());
+	active_.erase(reg->id);
+	if (active_.empty() && !overflow_ && fpOutbox_) {// 全部完成注册, 清空发件箱
+		fclose(fpOutbox_);
+		fpOutbox_ = fopen(pathOutbox_.c_str(), "w");
+		if (nupload_) {
+			_gLog.Write("DB upload: %d files, %lld bytes copied", nupload_, (long long) copied_);
+			nupload_ = 0;
+			copied_  = 0;
+		}
+	}
+}
+
+void DBRegister::dead_letter(imgregptr reg, const string &reason) {
+	string path = pathOutbox_ + DBREG_DEAD, why = reason;
+	FILE *fp;
+
+	std::replace_if(why.begin(), why.end(), boost::is_any_of("\t\r\n"), ' ');
+	_gLog.Write(LOG_WARN, "DBRegister", "gave up %s <%s/%s>, recorded in <%s>. %s",
+			reg->oldpath.size() ? "path update of" : (reg->uploading ? "uploading" : "registering"),
+			reg->pathdir.c_str(), reg->filename.c_str(), path.c_str(), why.c_str());
+	if ((fp = fopen(path.c_str(), "a"))) {
+		fprintf(fp, "%s\t%s\t%s%s\n", to_iso_extended_string(second_clock::universal_time()).c_str(), why.c_str(),
+				outbox_line(reg).c_str(), reg->uploading ? "\tU" : "");
+		fclose(fp);
+	}
+	else _gLog.Write(LOG_WARN, "DBRegister", "failed to open <%s>. %s", path.c_str(), strerror(errno));
+}
+
+string DBRegister::outbox_line(imgregptr reg) {
+	if (reg->oldpath.size()) {
+		boost::format fmt("M\t%d\t%s\t%s\t%s\t%s\t%s");
+		fmt % reg->id % reg->cid % reg->filename % reg->pathdir % reg->oldpath
+			% (reg->container.empty() ? "-" : reg->container);
+		return fmt.str();
+	}
+
+	string line;
+	if (reg->byref) {
+		boost::format fmt("R\t%d\t%s\t%s\t%s\t%s\t%d\t%d\t%s");
+		fmt % reg->id % reg->cid % reg->filename % reg->pathdir % reg->tmobs % reg->microsec % reg->filesize
+			% (reg->checksum.empty() ? "-" : reg->checksum);
+		line = fmt.str();
+	}
+	else {
+		boost::format fmt("A\t%d\t%s\t%s\t%s\t%s\t%d\t%s");
+		fmt % reg->id % reg->cid % reg->filename % reg->pathdir % reg->tmobs % reg->microsec
+			% (reg->checksum.empty() ? "-" : reg->checksum);
+		line = fmt.str();
+	}
+	for (std::map<string, string>::iterator it = reg->keywords.begin(); it != reg->keywords.end(); ++it)
+		line += "\t" + it->first + "=" + it->second;
+	return line;
+}
+
+DBRegister::ptime DBRegister::upload_time(imgregptr reg) {
+	ptime now = microsec_clock::universal_time();
+	ptime when = upnext_ > now ? upnext_ : now;
+
+	if (uprate_ > 0) upnext_ = when + microseconds(reg->filesize * 1000000 / uprate_);
+	return when;
+}
+
+void DBRegister::load_outbox(bool compact) {
+	typedef std::map<uint64_t, std::vector<string> > regmap;
+	regmap pending;
+	std::set<uint64_t> uploading;
+	std::vector<string> tokens;
+	string s;
+	FILE *fp;
+
+	if (fpOutbox_) fflush(fpOutbox_);
+	std::ifstream in(pathOutbox_.c_str());
+	if (in.is_open()) {
+		while (std::getline(in, s)) {
+			if (in.eof()) break;	// 末行无换行符: 追加时中断的残缺记录
+			boost::trim_right(s);
+			boost::split(tokens, s, boost::is_any_of("\t"));
+			if (tokens.size() < 2 || tokens[1].empty() || tokens[1].find_first_not_of("0123456789") != string::npos)
+				continue;
+			uint64_t id = std::stoull(tokens[1]);
+			if ((tokens[0] == "A" && tokens.size() >= 7)
+					|| (tokens[0] == "R" && tokens.size() >= 9
+						&& tokens[7].find_first_not_of("0123456789") == string::npos)) {
+				pending[id] = tokens;
+				if (id >= idnext_) idnext_ = id + 1;
+			}
+			else if (tokens[0] == "M" && tokens.size() == 7) {
+				// 未完成的注册改由新目录读取文件
+				for (regmap::iterator it = pending.begin(); tokens[6] == "-" && it != pending.end(); ++it) {
+					if (it->second[0] != "M" && it->second[3] == tokens[3] && it->second[4] == tokens[5])
+						it->second[4] = tokens[4];
+				}
+				pending[id] = tokens;
+				if (id >= idnext_) idnext_ = id + 1;
+			}
+			else if (tokens[0] == "U" && pending.count(id)) uploading.insert(id);
+			else if (tokens[0] == "D") {
+				pending.erase(id);
+				uploading.erase(id);
+			}
+		}
+		in.close();
+	}
+
+	overflow_ = false;
+	for (regmap::iterator it = pending.begin(); it != pending.end(); ++it) {
+		bool move = it->second[0] == "M";
+		if (active_.count(it->first) || (!move && it->second[6].find_first_not_of("-0123456789") != string::npos))
+			continue;
+		imgregptr reg = boost::make_shared<imgreg>();
+		reg->id       = it->first;
+		reg->cid      = it->second[2];
+		reg->filename = it->second[3];
+		reg->pathdir  = it->second[4];
+		reg->tmobs    = move ? string() : it->second[5];
+		reg->microsec = move ? 0 : std::stoi(it->second[6]);
+		reg->tries    = 0;
+		reg->byref    = it->second[0] == "R";
+		reg->filesize = reg->byref ? std::stoll(it->second[7]) : 0;
+		reg->uploading = uploading.count(it->first) > 0;
+		if (move) {
+			reg->oldpath = it->second[5];
+			if (it->second[6] != "-") reg->container = it->second[6];
+		}
+		else {
+			size_t first = reg->byref ? 8 : 7;	// 校验和位置, 其后为关键字
+			if (it->second.size() > first && it->second[first] != "-") reg->checksum = it->second[first];
+			for (size_t i = first + 1; i < it->second.size(); ++i) {
+				string::size_type pos = it->second[i].find('=');
+				if (pos != string::npos) reg->keywords[it->second[i].substr(0, pos)] = it->second[i].substr(pos + 1);
+			}
+		}
+		if (!push(reg, reg->uploading ? upload_time(reg) : microsec_clock::universal_time())) {
+			overflow_ = true;
+			break;
+		}
+	}
+	if (pending.size()) _gLog.Write("%d registrations are loaded from outbox", pending.size());
+
+	if (compact && (fp = fopen((pathOutbox_ + ".tmp").c_str(), "w"))) {
+		for (regmap::iterator it = pending.begin(); it != pending.end(); ++it) {
+			fprintf(fp, "%s\n", boost::join(it->second, "\t").c_str());
+			if (uploading.count(it->first)) fprintf(fp, "U\t%lu\n", (unsigned long) it->first);
+		}
+		fclose(fp);
+		rename((pathOutbox_ + ".tmp").c_str(), pathOutbox_.c_str());
+	}
+}
+
+void DBRegister::append_outbox(const string &line) {
+	if (fpOutbox_) {
+		fputs(line.c_str(), fpOutbox_);
+		fflush(fpOutbox_);
+	}
+}
+
+bool DBRegister::push(imgregptr reg, const ptime &when) {
+	if (int(queue_.size()) >= capacity_) return false;
+	queue_.insert(regQueue::value_type(when, reg));
+	active_[reg->id] = reg;
+	cvreg_.notify_one();
+	return true;
+}
+
+int DBRegister::backoff(int tries) {
+	int delay = 1 << std::min(tries, 9);
+	return std::min(delay, 600);
+}
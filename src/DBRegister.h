@@ -0,0 +1,239 @@
+/*!
+ * @file DBRegister.h 数据库异步注册管理器声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 写盘线程仅提交注册信息, 不等待数据库应答
+ * - 经DBCurl异步接口并发注册文件, 并发数量受限
+ * - 仅2xx应答视为成功. 5xx、408、429与网络错误按指数退避延时重试
+ * - 数据库拒绝(其它应答)或文件无法读取的注册信息不再重试, 记录在死信文件<outbox>.dead中
+ * - 启用批量注册时, 并发数量按批量记录数放大, 使DBCurl能够累积完整批次
+ * - 按引用注册时仅发送元数据; 可选在后台按限定速率补传文件内容
+ * - 数据库熔断期间暂停分派, 注册信息滞留在队列与发件箱中
+ * - 注册信息记录在发件箱文件中, 服务重启后继续注册
+ * - 仅可立即分派的注册信息持有内存中的文件数据, 且总量受限; 其余注册从磁盘文件读取
+ * - 文件迁移或打包后更新数据库中的路径. 该文件完成注册后才发送更新
+ * @note
+ * 发件箱文件格式(文本行):
+ * A <id> <cid> <filename> <pathdir> <tmobs> <microsec> [<checksum> [<keyword>=<value>...]]: 新的注册信息
+ * R <id> <cid> <filename> <pathdir> <tmobs> <microsec> <filesize> <checksum> [<keyword>=<value>...]:
+ *   新的按引用注册信息
+ * M <id> <cid> <filename> <pathdir> <oldpath> <container>|-: 文件由oldpath迁移至pathdir, 或打包至容器
+ * U <id>: 完成按引用注册, 等待上传文件
+ * D <id>: 完成注册
+ * @note
+ * 死信文件格式(文本行): <utc> <原因> <发件箱记录> [U]. U: 已按引用注册, 上传文件失败
+ */
+
+#ifndef DBREGISTER_H_
+#define DBREGISTER_H_
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "DBCurl.h"
+
+using std::string;
+
+class DBRegister {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param url      数据库URL地址
+	 * @param nworker  最大并发注册数量
+	 * @param capacity 内存队列容量
+	 * @param outbox   发件箱文件路径
+	 * @param upload   按引用注册后, 在后台上传文件
+	 * @param rate     后台上传速率上限, 量纲: 字节/秒. 不大于0时不限速
+	 */
+	DBRegister(const string &url, int nworker, int capacity, const string &outbox,
+			bool upload = false, int64_t rate = 0);
+	virtual ~DBRegister();
+
+public:
+	// 数据类型
+	struct imgreg {// 文件注册信息
+		uint64_t id;		//< 注册编号
+		string cid;			//< 相机编号
+		string filename;	//< 文件名
+		string pathdir;		//< 文件目录
+		string tmobs;		//< 曝光起始时间, 格式: CCYYMMDDThhmmss
+		int microsec;		//< 曝光起始时间的微秒位
+		int tries;			//< 尝试次数
+		bool byref;			//< 按引用注册
+		int64_t filesize;	//< 文件大小, 量纲: 字节
+		string checksum;	//< 文件校验和
+		std::map<string, string> keywords;	//< FITS关键字
+		bool uploading;		//< 已按引用注册, 等待上传文件
+		charray data;		//< 内存中的文件数据. 仅立即分派的首次尝试使用, 之后映射磁盘文件
+		string oldpath;		//< 路径更新: 原文件目录. 非空时为路径更新记录
+		string container;	//< 路径更新: 文件已打包至该容器
+	};
+	typedef boost::shared_ptr<imgreg> imgregptr;
+
+protected:
+	typedef boost::posix_time::ptime ptime;
+	typedef std::multimap<ptime, imgregptr> regQueue;	//< 按计划执行时间排序的注册队列
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef boost::shared_ptr<boost::thread> threadptr;
+	typedef std::map<uint64_t, imgregptr> regMap;	//< 注册编号-注册信息
+
+protected:
+	// 成员变量
+	string url_;		//< 数据库URL地址
+	int capacity_;		//< 内存队列容量
+	string pathOutbox_;	//< 发件箱文件路径
+	FILE *fpOutbox_;	//< 发件箱文件
+	uint64_t idnext_;	//< 下一个注册编号
+	regQueue queue_;	//< 待注册队列
+	regMap active_;		//< 内存中尚未完成的注册信息
+	bool overflow_;		//< 发件箱中有未进入内存队列的注册信息
+	boost::mutex mtx_;	//< 互斥锁
+	boost::condition_variable cvreg_;	//< 条件变量: 新的注册信息或完成注册
+	DBCurlPtr db_;		//< 数据库访问接口
+	int nworker_;		//< 最大并发注册数量
+	int maxinflight_;	//< 最大执行中注册数量
+	int inflight_;		//< 执行中注册数量
+	int64_t pinned_;	//< 注册信息持有的内存文件数据总量, 量纲: 字节
+	threadptr thrddispatch_;	//< 线程: 分派注册请求
+	bool upload_;		//< 按引用注册后上传文件
+	int64_t uprate_;	//< 上传速率上限, 量纲: 字节/秒. 不大于0时不限速
+	ptime upnext_;		//< 下一个文件的最早上传时间
+	int nupload_;		//< 统计: 上传文件数量
+	int64_t copied_;	//< 统计: 上传时复制的文件字节数
+
+public:
+	// 接口
+	/*!
+	 * @brief 提交注册信息
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param pathdir   文件目录
+	 * @param tmobs     曝光起始时间, 格式: CCYYMMDDThhmmss
+	 * @param microsec  曝光起始时间的微秒位
+	 * @param data      内存中的文件数据. 首次注册时直接从内存上传, 避免回读磁盘
+	 * @param size      内存中的文件数据长度, 量纲: 字节
+	 * @param checksum  文件校验和. 为空时不发送
+	 * @param keywords  FITS关键字. 随注册发送
+	 */
+	void RegImageFile(const string &cid, const string &filename, const string &pathdir,
+			const string &tmobs, int microsec, const charray &data = charray(), int64_t size = 0,
+			const string &checksum = string(), const std::map<string, string> &keywords = std::map<string, string>());
+	/*!
+	 * @brief 提交按引用注册信息
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param pathdir   文件目录
+	 * @param tmobs     曝光起始时间, 格式: CCYYMMDDThhmmss
+	 * @param microsec  曝光起始时间的微秒位
+	 * @param filesize  文件大小, 量纲: 字节
+	 * @param checksum  文件校验和
+	 * @param keywords  FITS关键字
+	 */
+	void RegImageRef(const string &cid, const string &filename, const string &pathdir,
+			const string &tmobs, int microsec, int64_t filesize, const string &checksum,
+			const std::map<string, string> &keywords);
+	/*!
+	 * @brief 提交路径更新: 文件已迁移至其它盘区或打包至容器
+	 * @param cid       相机编号
+	 * @param filename  文件名
+	 * @param oldpath   原文件目录
+	 * @param pathdir   新的文件目录
+	 * @param container 文件已打包至该容器(完整路径). 为空时文件位于新目录
+	 */
+	void RegImageMove(const string &cid, const string &filename, const string &oldpath,
+			const string &pathdir, const string &container = string());
+	/*!
+	 * @brief 设置超时与熔断阈值
+	 * @param connect   连接超时, 量纲: 毫秒
+	 * @param total     总超时, 量纲: 毫秒
+	 * @param failmax   熔断阈值: 连续失败次数
+	 */
+	void SetTimeout(int connect, int total, int failmax);
+	/*!
+	 * @brief 设置批量注册
+	 * @param url     批量注册URL地址. 为空时使用默认地址
+	 * @param size    单次批量注册的最大记录数. 不大于1时逐条注册
+	 * @param window  累积注册记录的最长时间, 量纲: 毫秒
+	 */
+	void SetBatch(const string &url, int size, int window);
+	/*!
+	 * @brief 查看待注册数量
+	 */
+	int Pending();
+
+protected:
+	// 功能
+	/*!
+	 * @brief 线程: 从队列中取出到期的注册信息, 提交异步注册
+	 */
+	void thread_dispatch();
+	/*!
+	 * @brief 处理注册结果
+	 * @param reg  注册信息
+	 * @param rslt 请求结果
+	 */
+	void on_result(imgregptr reg, const curl_result &rslt);
+	/*!
+	 * @brief 完成注册, 并在发件箱中登记
+	 */
+	void complete(imgregptr reg);
+	/*!
+	 * @brief 放弃注册, 记录在死信文件中
+	 * @param reg    注册信息
+	 * @param reason 原因
+	 */
+	void dead_letter(imgregptr reg, const string &reason);
+	/*!
+	 * @brief 生成注册信息的发件箱记录, 不含换行符
+	 */
+	string outbox_line(imgregptr reg);
+	/*!
+	 * @brief 按速率上限为待上传文件分配上传时间
+	 */
+	ptime upload_time(imgregptr reg);
+	/*!
+	 * @brief 加载发件箱中未完成的注册信息
+	 * @param compact 重写发件箱, 仅保留未完成的注册信息
+	 */
+	void load_outbox(bool compact);
+	/*!
+	 * @brief 在发件箱中追加一行
+	 */
+	void append_outbox(const string &line);
+	/*!
+	 * @brief 将注册信息加入队列
+	 * @param reg  注册信息
+	 * @param when 计划执行时间
+	 * @return
+	 * 队列未满时返回true
+	 */
+	bool push(imgregptr reg, const ptime &when);
+	/*!
+	 * @brief 释放注册信息持有的内存文件数据, 之后从磁盘文件读取
+	 */
+	void release(imgregptr reg);
+	/*!
+	 * @brief 释放队列中全部注册信息持有的内存文件数据
+	 */
+	void release_queued();
+	/*!
+	 * @brief 查看路径更新对应的文件是否仍在注册
+	 */
+	bool registering(imgregptr move);
+	/*!
+	 * @brief 计算重试延时
+	 * @param tries 已尝试次数
+	 * @return
+	 * 延时, 量纲: 秒
+	 */
+	int backoff(int tries);
+};
+typedef boost::shared_ptr<DBRegister> DBRegPtr;
+
+#endif /* DBREGISTER_H_ */
@@ -0,0 +1,508 @@
+/*!
+ * @file DataPublisher.cpp 新文件通知发布器定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <boost/make_shared.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/algorithm/string.hpp>
+#include "DataPublisher.h"
+#include "NightPacker.h"
+#include "PackFile.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::placeholders;
+
+#define FETCH_TIMEOUT	10000		//< 发送文件数据超时, 量纲: 毫秒
+#define FETCH_QUANTUM	(1 << 20)	//< 读取线程每次为一个订阅者发送的数据长度, 量纲: 字节
+#define FETCH_DEPTH		64			//< 单个订阅者未完成的读取请求上限
+
+/*!
+ * @brief 等待套接字可写
+ */
+static bool wait_writable(int sock) {
+	struct pollfd pfd;
+	int rc;
+
+	pfd.fd     = sock;
+	pfd.events = POLLOUT;
+	while ((rc = poll(&pfd, 1, FETCH_TIMEOUT)) < 0 && errno == EINTR);
+	return rc > 0 && !(pfd.revents & (POLLERR | POLLHUP));
+}
+
+/*!
+ * @brief 向非阻塞套接字发送完整数据
+ */
+static bool send_all(int sock, const char *data, int64_t n) {
+	ssize_t len;
+	while (n > 0) {
+		if ((len = send(sock, data, n, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN || !wait_writable(sock)) return false;
+			continue;
+		}
+		data += len;
+		n    -= len;
+	}
+	return true;
+}
+
+/*!
+ * @brief 经sendfile()向非阻塞套接字发送文件的一段数据, 数据不经用户空间复制
+ * @param offset 起始位置. 返回时指向已发送数据之后
+ * @param n      数据长度
+ */
+static bool sendfile_all(int sock, int fd, off_t &offset, int64_t n) {
+	off_t end = offset + n;
+	ssize_t len;
+	while (offset < end) {
+		if ((len = sendfile(sock, fd, &offset, end - offset)) < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN || !wait_writable(sock)) return false;
+			continue;
+		}
+		if (len == 0) return false; // 文件被截断
+	}
+	return true;
+}
+
+DataPubPtr make_datapub(int depth, bool disconnect, int maxlag, int nreader) {
+	return boost::make_shared<DataPublisher>(depth, disconnect, maxlag, nreader);
+}
+
+DataPublisher::DataPublisher(int depth, bool disconnect, int maxlag, int nreader) {
+	depth_      = depth > 0 ? depth : 1;
+	disconnect_ = disconnect;
+	maxlag_     = maxlag;
+	nimgtype_   = 0;
+	nfetch_     = 0;
+	ascproto_   = boost::make_shared<AsciiProtocol>();
+	thrdsend_.reset(new boost::thread(boost::bind(&DataPublisher::thread_send, this)));
+	for (int i = 0; i < (nreader > 0 ? nreader : 1); ++i)
+		thrdfetch_.create_thread(boost::bind(&DataPublisher::thread_fetch, this));
+}
+
+DataPublisher::~DataPublisher() {
+	thrdfetch_.interrupt_all();
+	thrdfetch_.join_all();
+	if (thrdsend_.unique()) {
+		thrdsend_->interrupt();
+		thrdsend_->join();
+	}
+	for (subVec::iterator it = subs_.begin(); it != subs_.end(); ++it) (*it)->tcp->Close();
+}
+
+void DataPublisher::Subscribe(const TcpCPtr client) {
+	subptr sub = boost::make_shared<subscriber>();
+	boost::system::error_code ec;
+	const tcp::endpoint &endpoint = client->GetSocket().remote_endpoint(ec);
+	boost::format fmt("%1%:%2%");
+
+	fmt % endpoint.address().to_string() % endpoint.port();
+	sub->tcp    = client;
+	sub->peer   = fmt.str();
+	sub->nsent  = 0;
+	sub->ndrop  = 0;
+	sub->nreport = 0;
+	sub->closed = false;
+	sub->transfer = false;
+	sub->busy   = false;
+	sub->fd     = -1;
+	sub->offset = 0;
+	sub->remain = 0;
+	sub->bufrcv.reset(new char[TCP_PACK_SIZE]);
+
+	const TCPClient::CBSlot &slot1 = boost::bind(&DataPublisher::network_receive, this, sub.get(), _1, _2);
+	const TCPClient::CBSlot &slot2 = boost::bind(&DataPublisher::network_send,    this, _1, _2);
+	client->RegisterRead(slot1);
+	client->RegisterWrite(slot2);
+	client->UseBuffer();
+
+	mutex_lock lck(mtx_);
+	subs_.push_back(sub);
+	_gLog.Write("data-process <%s> connected, %d subscribers", sub->peer.c_str(), subs_.size());
+}
+
+void DataPublisher::Publish(apfileinfo proto, const string &imgtype) {
+	mutex_lock lck(mtx_);
+	if (subs_.empty()) return;
+
+	message msg;
+	int n;
+	const char *s = ascproto_->CompactFileInfo(proto, n);
+	msg.text.assign(s, n);
+	msg.tmqueue = microsec_clock::universal_time();
+
+	for (subVec::iterator it = subs_.begin(); it != subs_.end(); ++it) {
+		subptr sub = *it;
+		if (sub->closed || !match(sub, proto, imgtype)) continue;
+		if (int(sub->queue.size()) >= depth_) {// 队列满
+			if (disconnect_) {
+				drop_subscriber(sub, "queue is full");
+				continue;
+			}
+			sub->queue.pop_front();
+			++sub->ndrop;
+		}
+		sub->queue.push_back(msg);
+	}
+	cvsend_.notify_one();
+}
+
+void DataPublisher::SetFrameSource(FrameCachePtr cache, const std::vector<string> &roots, FileIndexPtr index) {
+	mutex_lock lck(mtx_);
+	cache_ = cache;
+	roots_ = roots;
+	index_ = index;
+}
+
+bool DataPublisher::WantImageType() {
+	mutex_lock lck(mtx_);
+	return nimgtype_ > 0;
+}
+
+int DataPublisher::Count() {
+	mutex_lock lck(mtx_);
+	int n(0);
+	for (subVec::iterator it = subs_.begin(); it != subs_.end(); ++it) {
+		if (!(*it)->closed) ++n;
+	}
+	return n;
+}
+
+void DataPublisher::network_receive(subscriber *sub, const long client, const long ec) {
+	if (ec) {
+		mutex_lock lck(mtx_);
+		if (!sub->closed) {
+			_gLog.Write("data-process <%s> disconnected", sub->peer.c_str());
+			sub->closed = true;
+			cvsend_.notify_one();
+		}
+		return;
+	}
+
+	TCPClient *tcpc = (TCPClient*) client;
+	char *buff = sub->bufrcv.get();
+	int pos, n;
+	apbase base;
+
+	while ((pos = tcpc->Lookup("\n", 1, 0)) >= 0) {
+		if (pos >= TCP_PACK_SIZE) {// 过长的信息, 丢弃
+			for (n = pos + 1; n > 0; n -= TCP_PACK_SIZE) tcpc->Read(buff, n < TCP_PACK_SIZE ? n : TCP_PACK_SIZE, 0);
+			continue;
+		}
+		tcpc->Read(buff, pos + 1, 0);
+		buff[pos] = 0;
+
+		mutex_lock lck(mtx_);
+		try {
+			base = ascproto_->Resolve(buff);
+		}
+		catch(std::exception &ex) {// 非法数值
+			base.reset();
+		}
+		if (base.unique() && base->type == APTYPE_SUBSCRIBE) {
+			apsubscribe proto = from_apbase<ascii_proto_subscribe>(base);
+			if (!sub->imgtype.empty()) --nimgtype_;
+			sub->gid     = proto->gid;
+			sub->uid     = proto->uid;
+			sub->cid     = proto->cid;
+			sub->imgtype = boost::trim_copy(proto->imgtype);
+			if (!sub->imgtype.empty()) ++nimgtype_;
+			_gLog.Write("data-process <%s> subscribed gid=%s, uid=%s, cid=%s, imgtype=%s", sub->peer.c_str(),
+					sub->gid.c_str(), sub->uid.c_str(), sub->cid.c_str(), sub->imgtype.c_str());
+		}
+		else if (base.unique() && base->type == APTYPE_FILEGET && !sub->closed) {
+			if (sub->fetches.size() >= FETCH_DEPTH) {
+				for (subVec::iterator it = subs_.begin(); it != subs_.end(); ++it) {
+					if (it->get() == sub) drop_subscriber(*it, "too many file requests");
+				}
+				continue;
+			}
+			sub->fetches.push_back(from_apbase<ascii_proto_fileget>(base));
+			if (!sub->busy) {// 加入读取轮转
+				for (subVec::iterator it = subs_.begin(); it != subs_.end(); ++it) {
+					if (it->get() == sub) {
+						sub->busy = true;
+						ready_.push_back(*it);
+						cvfetch_.notify_one();
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+void DataPublisher::network_send(const long client, const long n) {
+	cvsend_.notify_one();
+}
+
+void DataPublisher::thread_send() {
+	boost::chrono::seconds period(1);
+	ptime now, tmsweep, tmreport;
+	int64_t ms;
+
+	tmsweep = tmreport = microsec_clock::universal_time();
+	while(1) {
+		mutex_lock lck(mtx_);
+		cvsend_.wait_for(lck, period);
+
+		now = microsec_clock::universal_time();
+		if ((now - tmsweep).total_seconds() >= 1) {// 释放上一轮关闭的订阅者
+			closed_.clear();
+			tmsweep = now;
+		}
+		for (subVec::iterator it = subs_.begin(); it != subs_.end(); ) {
+			subptr sub = *it;
+			if (!sub->closed && maxlag_ > 0 && (ms = lag(sub, now)) > maxlag_ * 1000) {
+				if (disconnect_) drop_subscriber(sub, "lag exceeds limit");
+				else {// 丢弃过期通知
+					while (sub->queue.size() && (now - sub->queue.front().tmqueue).total_seconds() > maxlag_) {
+						sub->queue.pop_front();
+						++sub->ndrop;
+					}
+				}
+			}
+			if (sub->closed) {
+				sub->tcp->Close();
+				if (!sub->imgtype.empty()) --nimgtype_;
+				closed_.push_back(sub);
+				it = subs_.erase(it);
+			}
+			else {
+				if (!sub->transfer) flush(sub);
+				++it;
+			}
+		}
+		if ((now - tmreport).total_seconds() >= 60) {// 记录滞后的订阅者
+			for (subVec::iterator it = subs_.begin(); it != subs_.end(); ++it) {
+				subptr sub = *it;
+				if ((ms = lag(sub, now)) >= 1000 || sub->ndrop > sub->nreport) {
+					_gLog.Write(LOG_WARN, "DataPublisher", "data-process <%s>: %lld sent, %lld dropped, %d queued, lag %lld ms",
+							sub->peer.c_str(), sub->nsent, sub->ndrop, sub->queue.size(), ms);
+					sub->nreport = sub->ndrop;
+				}
+			}
+			if (cache_.use_count()) {
+				int nframe;
+				int64_t used, nhit, nmiss;
+				cache_->Stats(nframe, used, nhit, nmiss);
+				if (nhit + nmiss > nfetch_) {
+					_gLog.Write("frame cache: %d frames, %lld MB, %lld hits, %lld misses",
+							nframe, used >> 20, nhit, nmiss);
+					nfetch_ = nhit + nmiss;
+				}
+			}
+			tmreport = now;
+		}
+	}
+}
+
+void DataPublisher::thread_fetch() {
+	subptr sub;
+	bool rslt;
+
+	while(1) {
+		mutex_lock lck(mtx_);
+		while (ready_.empty()) cvfetch_.wait(lck);
+		sub = ready_.front();
+		ready_.pop_front();
+		if (!sub->closed) {
+			sub->transfer = true;
+			lck.unlock();
+			rslt = serve_fetch(sub);
+			lck.lock();
+			if (!rslt && !sub->closed) drop_subscriber(sub, "failed to send file");
+		}
+		if (sub->closed) {// 释放未完成的读取
+			sub->fetches.clear();
+			if (sub->fd >= 0) close(sub->fd);
+			sub->fd = -1;
+			sub->data.reset();
+			sub->remain = 0;
+		}
+		if (sub->remain > 0 || sub->fetches.size()) {// 轮转: 排在其它订阅者之后
+			ready_.push_back(sub);
+			cvfetch_.notify_one();
+		}
+		else sub->busy = false;
+		if (sub->remain <= 0) {
+			sub->transfer = false;
+			cvsend_.notify_one();
+		}
+	}
+}
+
+bool DataPublisher::serve_fetch(subptr sub) {
+	boost::system::error_code ec;
+	tcp::socket &sock = sub->tcp->GetSocket();
+	int64_t n;
+
+	if (sub->remain <= 0) {// 开始新的读取
+		ptime until = microsec_clock::universal_time() + millisec(FETCH_TIMEOUT);
+		FrameCache::charray data;
+		int64_t size(-1), base(0);
+		int fd(-1);
+
+		mutex_lock lck(mtx_);
+		apfileget proto = sub->fetches.front();
+		sub->fetches.pop_front();
+		lck.unlock();
+		// 等待已进入网络发送缓冲区的通知发送完毕, 避免与文件数据交错
+		while (sub->tcp->Writable() < TCP_BUFF_SIZE) {
+			if (sub->closed || microsec_clock::universal_time() > until) return false;
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+		}
+		// 查找文件: 优先使用帧缓存
+		if (cache_.use_count() && cache_->Get(proto->cid, proto->filename, data, size));
+		else if (valid_path(proto)) fd = open_file(proto, base, size);
+		// 应答
+		proto->filesize = size;
+		if (size < 0) proto->offset = proto->length = 0;
+		else {
+			if (proto->offset < 0 || proto->offset > size) proto->offset = size;
+			if (proto->length < 0 || proto->length > size - proto->offset) proto->length = size - proto->offset;
+		}
+		int len;
+		lck.lock();
+		const char *s = ascproto_->CompactFileData(proto, len);
+		string header(s, len);
+		lck.unlock();
+
+		sock.non_blocking(true, ec);
+		if (!send_all(sock.native_handle(), header.data(), header.size())) {
+			if (fd >= 0) close(fd);
+			return false;
+		}
+		sub->data   = data;
+		sub->fd     = fd;
+		sub->offset = base + proto->offset;
+		sub->remain = proto->length;
+		if (sub->remain <= 0 || !(data.get() || fd >= 0)) {
+			if (fd >= 0) close(fd);
+			sub->fd = -1;
+			sub->data.reset();
+			sub->remain = 0;
+			return true;
+		}
+	}
+	// 发送一个份额的数据, 之后让出读取线程
+	n = sub->remain < FETCH_QUANTUM ? sub->remain : FETCH_QUANTUM;
+	if (sub->data.get()) {
+		if (!send_all(sock.native_handle(), sub->data.get() + sub->offset, n)) return false;
+		sub->offset += n;
+	}
+	else {
+		off_t offset = sub->offset;
+		if (!sendfile_all(sock.native_handle(), sub->fd, offset, n)) return false;
+		sub->offset = offset;
+	}
+	if ((sub->remain -= n) <= 0) {
+		if (sub->fd >= 0) close(sub->fd);
+		sub->fd = -1;
+		sub->data.reset();
+	}
+
+	return true;
+}
+
+int DataPublisher::open_file(apfileget proto, int64_t &base, int64_t &size) {
+	const string &subpath = proto->subpath;
+	string from, rel;
+	string::size_type pos;
+	struct stat st;
+	int fd;
+
+	base = 0;
+	if ((fd = open((subpath + "/" + proto->filename).c_str(), O_RDONLY)) < 0 && errno == ENOENT) {
+		for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end() && from.empty(); ++it) {// 所在盘区
+			string root = boost::trim_right_copy_if(*it, boost::is_any_of("/"));
+			if (subpath.compare(0, root.size(), root) == 0 && (subpath.size() == root.size() || subpath[root.size()] == '/')) {
+				from = root;
+				rel  = subpath.substr(root.size()) + "/" + proto->filename;
+			}
+		}
+		for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end() && !from.empty() && fd < 0; ++it) {// 已迁移
+			string root = boost::trim_right_copy_if(*it, boost::is_any_of("/"));
+			if (root != from) fd = open((root + rel).c_str(), O_RDONLY);
+		}
+		if (fd < 0 && !from.empty() && (pos = rel.find('/', 1)) != string::npos) {// 已打包
+			string top = rel.substr(0, pos + 1), name = rel.substr(pos + 1);
+			string packs[] = { NightPacker::ContainerName(proto->cid), NightPacker::ContainerName("") };
+			FileIndex::entry x;
+			int64_t end;
+			for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {
+				string root = boost::trim_right_copy_if(*it, boost::is_any_of("/"));
+				for (int i = 0; i < 2; ++i) {
+					// 打包追加期间文件尾位于数据之后, 以索引记录的长度为准. 未记录的容器尚未完成打包
+					if (index_.use_count() && !index_->Find(root, top.substr(1) + packs[i], x)) continue;
+					if ((fd = open((root + top + packs[i]).c_str(), O_RDONLY)) < 0) continue;
+					end = index_.use_count() ? x.size : lseek(fd, 0, SEEK_END);
+					if (PackFile::Locate(fd, end, name, base, size)) return fd;
+					close(fd);
+				}
+			}
+			return -1;
+		}
+	}
+	if (fd >= 0 && fstat(fd, &st) == 0) size = st.st_size;
+	else if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+bool DataPublisher::valid_path(apfileget proto) {
+	const string &subpath = proto->subpath;
+	const string &filename = proto->filename;
+
+	if (filename.empty() || filename.find('/') != string::npos
+			|| subpath.find("..") != string::npos || filename == "..")
+		return false;
+	for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {
+		const string &root = *it;
+		if (root.empty() || subpath.compare(0, root.size(), root)) continue;
+		if (subpath.size() == root.size() || root.back() == '/' || subpath[root.size()] == '/') return true;
+	}
+	return false;
+}
+
+void DataPublisher::flush(subptr sub) {
+	int n = sub->tcp->Writable(), len;
+
+	while (sub->queue.size() && (len = sub->queue.front().text.size()) <= n) {
+		sub->tcp->Write(sub->queue.front().text.data(), len);
+		sub->queue.pop_front();
+		++sub->nsent;
+		n -= len;
+	}
+}
+
+bool DataPublisher::match(subptr sub, apfileinfo proto, const string &imgtype) {
+	return (sub->gid.empty() || sub->gid == proto->gid)
+			&& (sub->uid.empty() || sub->uid == proto->uid)
+			&& (sub->cid.empty() || sub->cid == proto->cid)
+			&& (sub->imgtype.empty() || boost::iequals(sub->imgtype, imgtype));
+}
+
+void DataPublisher::drop_subscriber(subptr sub, const char *reason) {
+	_gLog.Write(LOG_WARN, "DataPublisher", "disconnect data-process <%s>: %s. %lld sent, %lld dropped, %d queued",
+			sub->peer.c_str(), reason, sub->nsent, sub->ndrop, sub->queue.size());
+	sub->closed = true;
+	sub->queue.clear();
+	cvsend_.notify_one();
+}
+
+int64_t DataPublisher::lag(subptr sub, const ptime &now) {
+	return sub->queue.empty() ? 0 : (now - sub->queue.front().tmqueue).total_milliseconds();
+}
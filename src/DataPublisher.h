@@ -0,0 +1,201 @@
+/*!
+ * @file DataPublisher.h 新文件通知发布器声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 数据处理端口支持多个并发订阅者
+ * - 订阅者可发送subscribe协议设置过滤条件: gid/uid/cid/imgtype. 未订阅时接收全部通知
+ * - 每个订阅者有独立的有界发送队列. 发布仅将通知加入队列, 不等待网络发送
+ * - 发送线程在网络发送缓冲区可容纳完整通知时转发, 避免截断
+ * - 队列满或滞后超限时, 按策略丢弃最早通知或断开订阅者
+ * - 订阅者可发送fileget协议读取文件或其中一段: 优先从帧缓存发送, 未命中时经sendfile()从磁盘发送,
+ *   数据不经用户空间复制. 发送文件数据期间暂停向该订阅者转发通知
+ * - 读取线程池按订阅者轮转服务, 每次发送一个份额, 使并发读取公平共享磁盘与网络带宽
+ */
+
+#ifndef DATAPUBLISHER_H_
+#define DATAPUBLISHER_H_
+
+#include <string>
+#include <vector>
+#include <boost/container/deque.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "tcpasio.h"
+#include "AsciiProtocol.h"
+#include "FrameCache.h"
+#include "FileIndex.h"
+
+using std::string;
+
+class DataPublisher {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param depth      单个订阅者的发送队列容量
+	 * @param disconnect 队列满或滞后超限时断开订阅者. false: 丢弃最早通知
+	 * @param maxlag     最大滞后时间, 量纲: 秒. 不大于0时不检查
+	 * @param nreader    读取线程数量
+	 */
+	DataPublisher(int depth, bool disconnect, int maxlag, int nreader = 2);
+	virtual ~DataPublisher();
+
+protected:
+	// 数据类型
+	typedef boost::posix_time::ptime ptime;
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef boost::shared_ptr<boost::thread> threadptr;
+	typedef boost::shared_array<char> charray;
+
+	struct message {// 待发送通知
+		string text;	//< 编码后的通知
+		ptime tmqueue;	//< 入队时间
+	};
+	typedef boost::container::deque<message> msgQueue;
+	typedef boost::container::deque<apfileget> fetchQueue;	//< 读取请求
+
+	struct subscriber {// 订阅者
+		TcpCPtr tcp;		//< 网络连接
+		string peer;		//< 远程地址
+		string gid, uid, cid;	//< 过滤条件: 组/单元/相机标志. 为空时代表通配符
+		string imgtype;		//< 过滤条件: 图像类型. 为空时代表通配符
+		msgQueue queue;		//< 发送队列
+		int64_t nsent;		//< 统计: 已发送通知数量
+		int64_t ndrop;		//< 统计: 丢弃通知数量
+		int64_t nreport;	//< 上次记录统计时的丢弃数量
+		bool closed;		//< 连接已断开或被断开, 等待回收
+		bool transfer;		//< 正在发送文件数据, 暂停转发通知
+		fetchQueue fetches;	//< 待处理的读取请求
+		bool busy;			//< 已加入读取轮转
+		int fd;				//< 当前读取: 文件描述符. 从帧缓存读取时<0
+		charray data;		//< 当前读取: 帧缓存数据
+		int64_t offset;		//< 当前读取: 下一份额的起始位置
+		int64_t remain;		//< 当前读取: 剩余数据长度
+		charray bufrcv;		//< 接收缓冲区
+	};
+	typedef boost::shared_ptr<subscriber> subptr;
+	typedef std::vector<subptr> subVec;
+	typedef boost::container::deque<subptr> subQueue;
+
+protected:
+	// 成员变量
+	int depth_;			//< 发送队列容量
+	bool disconnect_;	//< 超限时断开订阅者
+	int maxlag_;		//< 最大滞后时间, 量纲: 秒
+	subVec subs_;		//< 订阅者
+	subVec closed_;		//< 已关闭的订阅者. 在下一轮发送后释放, 使网络回调安全退出
+	int nimgtype_;		//< 按图像类型过滤的订阅者数量
+	AscProtoPtr ascproto_;	//< 通信协议封装接口
+	boost::mutex mtx_;	//< 互斥锁
+	boost::condition_variable cvsend_;	//< 条件变量: 新的通知或网络发送完成
+	threadptr thrdsend_;	//< 线程: 发送通知
+	FrameCachePtr cache_;	//< 帧缓存
+	std::vector<string> roots_;	//< 存储盘区. 仅发送这些路径下的文件
+	FileIndexPtr index_;	//< 已存储文件索引. 按其记录的容器长度查找已打包的文件
+	subQueue ready_;	//< 等待读取线程服务的订阅者
+	boost::condition_variable cvfetch_;	//< 条件变量: 新的读取请求
+	boost::thread_group thrdfetch_;	//< 读取线程池
+	int64_t nfetch_;	//< 上次记录统计时的帧数据请求数量
+
+public:
+	// 接口
+	/*!
+	 * @brief 加入订阅者
+	 * @param client 网络连接
+	 */
+	void Subscribe(const TcpCPtr client);
+	/*!
+	 * @brief 发布新文件通知
+	 * @param proto   文件描述信息
+	 * @param imgtype 图像类型. 未知时为空
+	 * @note
+	 * 仅加入匹配订阅者的发送队列, 不阻塞调用者
+	 */
+	void Publish(apfileinfo proto, const string &imgtype);
+	/*!
+	 * @brief 设置帧数据来源
+	 * @param cache 帧缓存. 为空时从磁盘发送
+	 * @param roots 存储盘区. 仅发送这些路径下的文件
+	 * @param index 已存储文件索引. 为空时按容器文件长度查找已打包的文件
+	 */
+	void SetFrameSource(FrameCachePtr cache, const std::vector<string> &roots, FileIndexPtr index = FileIndexPtr());
+	/*!
+	 * @brief 查看是否有订阅者按图像类型过滤
+	 */
+	bool WantImageType();
+	/*!
+	 * @brief 查看订阅者数量
+	 */
+	int Count();
+
+protected:
+	// 功能
+	/*!
+	 * @brief 处理订阅者的网络信息
+	 * @param sub    订阅者. 关闭后延迟释放, 回调中可安全访问
+	 * @param client 网络连接
+	 * @param ec     错误代码. 0: 正确
+	 */
+	void network_receive(subscriber *sub, const long client, const long ec);
+	/*!
+	 * @brief 网络发送完成, 唤醒发送线程
+	 */
+	void network_send(const long client, const long n);
+	/*!
+	 * @brief 线程: 转发队列中的通知, 检查滞后与回收断开的订阅者
+	 */
+	void thread_send();
+	/*!
+	 * @brief 线程: 按订阅者轮转处理读取请求
+	 */
+	void thread_fetch();
+	/*!
+	 * @brief 为订阅者发送一个份额的文件数据. 无进行中的读取时, 先开始下一个请求并发送应答
+	 * @param sub 订阅者
+	 * @return
+	 * 发送结果. 失败时断开订阅者
+	 */
+	bool serve_fetch(subptr sub);
+	/*!
+	 * @brief 检查请求的文件是否位于存储根路径下
+	 */
+	bool valid_path(apfileget proto);
+	/*!
+	 * @brief 打开请求的文件. 文件已由着陆盘区迁移时, 在其它存储盘区的相同相对路径下查找;
+	 * 文件已打包时, 在观测夜容器中查找
+	 * @param proto 请求
+	 * @param base  文件数据在所打开文件中的位置
+	 * @param size  文件长度, 量纲: 字节
+	 * @return
+	 * 文件描述符. 失败时返回-1
+	 */
+	int open_file(apfileget proto, int64_t &base, int64_t &size);
+	/*!
+	 * @brief 在网络发送缓冲区容量内转发通知
+	 */
+	void flush(subptr sub);
+	/*!
+	 * @brief 检查订阅者是否匹配
+	 */
+	bool match(subptr sub, apfileinfo proto, const string &imgtype);
+	/*!
+	 * @brief 断开订阅者
+	 * @param sub    订阅者
+	 * @param reason 原因
+	 */
+	void drop_subscriber(subptr sub, const char *reason);
+	/*!
+	 * @brief 查看订阅者的滞后时间, 即最早未发送通知的等待时间
+	 * @return
+	 * 滞后时间, 量纲: 毫秒
+	 */
+	int64_t lag(subptr sub, const ptime &now);
+};
+typedef boost::shared_ptr<DataPublisher> DataPubPtr;
+/*!
+ * @brief 工厂函数, 创建新文件通知发布器
+ */
+extern DataPubPtr make_datapub(int depth, bool disconnect, int maxlag, int nreader = 2);
+
+#endif /* DATAPUBLISHER_H_ */
@@ -7,6 +7,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <curl/curl.h>
 #include "DataTransfer.h"
 #include "data.h"
@@ -16,6 +17,9 @@
 static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
 static int joinStr(char *s1, char *s2, char **s3);
 static int dateToStr(struct timeval tv, char *dateStr);
+static void initCurlGlobal();
+
+static pthread_once_t curlOnce = PTHREAD_ONCE_INIT;
 
 /**
  * 
@@ -233,34 +237,16 @@ int DataTransfer::uploadDatas(const char url[],
   CURL *curlSession;
   CURLcode curlCode;
 
-  struct curl_httppost *formpost = NULL;
-  struct curl_httppost *lastptr = NULL;
+  curl_mime *formpost = NULL;
+  curl_mimepart *part;
   struct curl_slist *headerlist = NULL;
   static const char buf[] = "Expect:";
 
   tmpChunk->memory = (char*) malloc(1); /* will be grown as needed by realloc above */
   tmpChunk->size = 0; /* no data at this point */
 
-  curl_global_init(CURL_GLOBAL_ALL);
-
-  for (multimap<string, string>::iterator iter = params.begin(); iter != params.end(); iter++) {
-    curl_formadd(&formpost,
-            &lastptr,
-            CURLFORM_COPYNAME, iter->first.data(),
-            CURLFORM_COPYCONTENTS, iter->second.data(),
-            CURLFORM_END);
-  }
-
-  for (multimap<string, string>::iterator iter = files.begin(); iter != files.end(); iter++) {
-    string filePath(path, path + strlen(path));
-    filePath.append(iter->second.data());
-    cout << iter->first.data() << ":" << filePath.data() << endl;
-    curl_formadd(&formpost,
-            &lastptr,
-            CURLFORM_COPYNAME, iter->first.data(),
-            CURLFORM_FILE, filePath.data(),
-            CURLFORM_END);
-  }
+  /* libcurl global init is process wide, do it only once */
+  pthread_once(&curlOnce, initCurlGlobal);
 
 #ifdef DEBUG  
   string conStr = "{";
@@ -288,6 +274,22 @@ int DataTransfer::uploadDatas(const char url[],
   /* initialize custom header list (stating that Expect: 100-continue is not wanted */
   headerlist = curl_slist_append(headerlist, buf);
   if (curlSession) {
+    formpost = curl_mime_init(curlSession);
+    for (multimap<string, string>::iterator iter = params.begin(); iter != params.end(); iter++) {
+      part = curl_mime_addpart(formpost);
+      curl_mime_name(part, iter->first.data());
+      curl_mime_data(part, iter->second.data(), iter->second.size());
+    }
+
+    for (multimap<string, string>::iterator iter = files.begin(); iter != files.end(); iter++) {
+      string filePath(path, path + strlen(path));
+      filePath.append(iter->second.data());
+      cout << iter->first.data() << ":" << filePath.data() << endl;
+      part = curl_mime_addpart(formpost);
+      curl_mime_name(part, iter->first.data());
+      curl_mime_filedata(part, filePath.data());
+    }
+
     char *reqErrorBuf = (char*) malloc(sizeof (char)*CURL_ERROR_BUFFER);
     memset(reqErrorBuf, 0, sizeof (char)*CURL_ERROR_BUFFER);
 
@@ -319,7 +321,7 @@ int DataTransfer::uploadDatas(const char url[],
     if (false) {
       curl_easy_setopt(curlSession, CURLOPT_HTTPHEADER, headerlist);
     }
-    curl_easy_setopt(curlSession, CURLOPT_HTTPPOST, formpost);
+    curl_easy_setopt(curlSession, CURLOPT_MIMEPOST, formpost);
 
     /* Perform the request, curlCode will get the return code */
     curlCode = curl_easy_perform(curlSession);
@@ -355,15 +357,12 @@ int DataTransfer::uploadDatas(const char url[],
     curl_easy_cleanup(curlSession);
 
     /* then cleanup the formpost chain */
-    curl_formfree(formpost);
+    curl_mime_free(formpost);
     /* free slist */
     curl_slist_free_all(headerlist);
 
 
     free(tmpChunk->memory);
-
-    /* we're done with libcurl, so clean it up */
-    curl_global_cleanup();
   } else {
     rstCode = GWAC_SEND_DATA_ERROR;
     sprintf(statusstr, "File %s line %d, Error Code: %d\n"
@@ -374,6 +373,12 @@ int DataTransfer::uploadDatas(const char url[],
   return rstCode;
 }
 
+static void initCurlGlobal() {
+  if (curl_global_init(CURL_GLOBAL_ALL) == CURLE_OK) {
+    atexit(curl_global_cleanup);
+  }
+}
+
 static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
   size_t realsize = size * nmemb;
   struct CurlCache *mem = (struct CurlCache *) userp;
@@ -0,0 +1,329 @@
+/*!
+ * @file DeleteEngine.cpp 并行批量删除引擎定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include "DeleteEngine.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+
+#define IOPRIO_CLASS_SHIFT	13
+#define IOPRIO_CLASS_IDLE	3
+#define IOPRIO_WHO_PROCESS	1
+
+#define DELETE_BATCH		64	// 批次条目数量
+#define DELETE_QUEUE		256	// 待执行批次上限, 同时限制打开的目录描述符数量
+#define DELETE_PROGRESS		10	// 进度输出周期, 量纲: 秒
+
+DeleteEngine::dirhandle::~dirhandle() {
+	close(fd);
+}
+
+DeleteEngine::DeleteEngine(const string &journal, int nworker, int iops) {
+	pathJournal_ = journal;
+	fpJournal_   = NULL;
+	iops_        = iops > 0 ? iops : 0;
+	idnext_      = 1;
+	tmnext_      = microsec_clock::universal_time();
+
+	if (nworker < 1) nworker = 1;
+	for (int i = 0; i < nworker; ++i)
+		thrdwork_.create_thread(boost::bind(&DeleteEngine::thread_work, this));
+	thrdscan_.reset(new boost::thread(boost::bind(&DeleteEngine::thread_scan, this)));
+}
+
+DeleteEngine::~DeleteEngine() {
+	thrdscan_->interrupt();
+	thrdscan_->join();
+	thrdwork_.interrupt_all();
+	thrdwork_.join_all();
+	if (fpJournal_) fclose(fpJournal_);
+	if (active_.size())
+		_gLog.Write(LOG_WARN, "", "%d deletions will be resumed from journal", active_.size());
+}
+
+void DeleteEngine::RegisterDone(const DoneSlot &slot) {
+	cbdone_ = slot;
+}
+
+void DeleteEngine::Resume() {
+	std::map<uint64_t, string> pending;
+	std::vector<string> tokens;
+	string s;
+
+	std::ifstream in(pathJournal_.c_str());
+	if (in.is_open()) {
+		while (std::getline(in, s)) {
+			if (in.eof()) break;	// 末行无换行符: 追加时中断的残缺记录
+			boost::trim_right_if(s, boost::is_any_of("\r\n"));
+			boost::split(tokens, s, boost::is_any_of("\t"));
+			if (tokens.size() < 2 || tokens[1].empty() || tokens[1].find_first_not_of("0123456789") != string::npos)
+				continue;
+			uint64_t id = std::stoull(tokens[1]);
+			if (tokens[0] == "J" && tokens.size() == 3) pending[id] = tokens[2];
+			else if (tokens[0] == "F") pending.erase(id);
+		}
+		in.close();
+	}
+
+	mutex_lock lck(mtx_);
+	if (fpJournal_) fclose(fpJournal_);
+	if (!(fpJournal_ = fopen(pathJournal_.c_str(), "w")))
+		_gLog.Write(LOG_WARN, "DeleteEngine", "failed to open journal<%s>. %s", pathJournal_.c_str(), strerror(errno));
+	lck.unlock();
+
+	if (pending.size()) _gLog.Write("%d deletions are resumed from journal", pending.size());
+	for (std::map<uint64_t, string>::iterator it = pending.begin(); it != pending.end(); ++it) Submit(it->second);
+}
+
+uint64_t DeleteEngine::Submit(const string &path) {
+	jobptr x = boost::make_shared<job>();
+	x->path    = path;
+	x->pending = 0;
+	x->scanned = false;
+	x->done    = false;
+	x->nfile   = 0;
+	x->nfail   = 0;
+
+	mutex_lock lck(mtx_);
+	x->id = idnext_++;
+	append_journal(str(boost::format("J\t%d\t%s\n") % x->id % path));
+	jobs_.push_back(x);
+	active_.push_back(x);
+	cvjob_.notify_all();
+	return x->id;
+}
+
+void DeleteEngine::Wait(uint64_t id) {
+	mutex_lock lck(mtx_);
+	while (find_job(id).use_count()) cvjob_.wait(lck);
+}
+
+int DeleteEngine::Unlink(const std::vector<string> &paths) {
+	jobptr x = boost::make_shared<job>();
+	x->id      = 0;
+	x->pending = 0;
+	x->scanned = false;
+	x->done    = false;
+	x->nfile   = 0;
+	x->nfail   = 0;
+	x->tmstart = microsec_clock::universal_time();
+
+	for (size_t i = 0; i < paths.size(); i += DELETE_BATCH) {
+		batch b;
+		b.owner = x;
+		b.names.assign(paths.begin() + i, paths.begin() + std::min(paths.size(), i + DELETE_BATCH));
+		push_batch(b);
+	}
+
+	mutex_lock lck(mtx_);
+	x->scanned = true;
+	if (x->pending == 0) x->done = true;
+	while (!x->done) cvjob_.wait(lck);
+	return int(x->nfile);
+}
+
+void DeleteEngine::thread_scan() {
+	jobptr x;
+
+	while(1) {
+		mutex_lock lck(mtx_);
+		while (jobs_.empty()) cvjob_.wait(lck);
+		x = jobs_.front();
+		jobs_.pop_front();
+		lck.unlock();
+
+		boost::filesystem::path path(x->path);
+		string parent = path.parent_path().string();
+		int fd = open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		x->tmstart = microsec_clock::universal_time();
+		_gLog.Write("deleting <%s>", x->path.c_str());
+		if (fd < 0) {
+			_gLog.Write(LOG_WARN, "DeleteEngine", "failed to open <%s>. %s", parent.c_str(), strerror(errno));
+		}
+		else {
+			scan_directory(x, fd, path.filename().string(), x->path);
+			close(fd);
+		}
+
+		lck.lock();
+		x->scanned = true;
+		bool finished = x->pending == 0;
+		lck.unlock();
+		if (finished) finish_job(x);
+
+		lck.lock();
+		while (!x->done) {// 逐个执行目录树任务, 定期输出进度
+			if (cvjob_.wait_for(lck, boost::chrono::seconds(DELETE_PROGRESS)) == boost::cv_status::timeout) {
+				double secs = (microsec_clock::universal_time() - x->tmstart).total_milliseconds() * 1E-3;
+				_gLog.Write("deleting <%s>: %lld files removed, %.0f files/s", x->path.c_str(),
+						(long long) x->nfile, secs > 0.0 ? x->nfile / secs : 0.0);
+			}
+		}
+		lck.unlock();
+		x.reset();
+	}
+}
+
+void DeleteEngine::thread_work() {
+	// 工作线程使用空闲I/O优先级, 删除操作让位于写盘
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, syscall(SYS_gettid), IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+
+	while(1) {
+		mutex_lock lck(mtx_);
+		while (batches_.empty()) cvbatch_.wait(lck);
+		batch b = batches_.front();
+		batches_.pop_front();
+		cvbatch_.notify_all();
+		lck.unlock();
+
+		int64_t nfile(0), nfail(0);
+		for (std::vector<string>::iterator it = b.names.begin(); it != b.names.end(); ++it) {
+			throttle();
+			int rc = b.dir.use_count() ? unlinkat(b.dir->fd, it->c_str(), 0) : unlink(it->c_str());
+			if (rc == 0 || errno == ENOENT) ++nfile;
+			else if (nfail++ == 0) {// 每批次仅记录首个失败
+				_gLog.Write(LOG_WARN, "DeleteEngine", "failed to remove <%s>. %s",
+						b.dir.use_count() ? (b.owner->path + "/.../" + *it).c_str() : it->c_str(), strerror(errno));
+			}
+		}
+
+		lck.lock();
+		b.owner->nfile += nfile;
+		b.owner->nfail += nfail;
+		lck.unlock();
+		b.dir.reset();
+		batch_done(b.owner);
+	}
+}
+
+void DeleteEngine::scan_directory(jobptr x, int dirfd, const string &name, const string &path) {
+	std::vector<string> subdirs;
+	struct dirent *ent;
+	struct stat st;
+	DIR *dp;
+	int fd;
+
+	if ((fd = openat(dirfd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) < 0) {
+		if (errno != ENOENT)
+			_gLog.Write(LOG_WARN, "DeleteEngine", "failed to open <%s>. %s", path.c_str(), strerror(errno));
+		return;
+	}
+	x->dirs.push_back(path);
+	dirptr dir = boost::make_shared<dirhandle>(fd);
+	int fddup = dup(fd);
+	if (fddup < 0 || !(dp = fdopendir(fddup))) {
+		if (fddup >= 0) close(fddup);
+		return;
+	}
+
+	batch b;
+	b.owner = x;
+	b.dir   = dir;
+	while ((ent = readdir(dp))) {
+		if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+		bool isdir = ent->d_type == DT_DIR;
+		if (ent->d_type == DT_UNKNOWN && !fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW))
+			isdir = S_ISDIR(st.st_mode);
+		if (isdir) subdirs.push_back(ent->d_name);
+		else {
+			b.names.push_back(ent->d_name);
+			if (b.names.size() >= DELETE_BATCH) {
+				push_batch(b);
+				b.names.clear();
+			}
+		}
+	}
+	closedir(dp);
+	if (b.names.size()) push_batch(b);
+
+	for (std::vector<string>::iterator it = subdirs.begin(); it != subdirs.end(); ++it)
+		scan_directory(x, fd, *it, path + "/" + *it);
+}
+
+void DeleteEngine::push_batch(const batch &b) {
+	mutex_lock lck(mtx_);
+	while (batches_.size() >= DELETE_QUEUE) cvbatch_.wait(lck);
+	++b.owner->pending;
+	batches_.push_back(b);
+	cvbatch_.notify_all();
+}
+
+void DeleteEngine::batch_done(jobptr x) {
+	mutex_lock lck(mtx_);
+	bool finished = --x->pending == 0 && x->scanned;
+	lck.unlock();
+
+	if (finished) finish_job(x);
+}
+
+void DeleteEngine::finish_job(jobptr x) {
+	if (x->id) {// 目录树: 由深至浅删除目录
+		for (std::vector<string>::reverse_iterator it = x->dirs.rbegin(); it != x->dirs.rend(); ++it) {
+			throttle();
+			if (rmdir(it->c_str()) && errno != ENOENT) {
+				_gLog.Write(LOG_WARN, "DeleteEngine", "failed to remove <%s>. %s", it->c_str(), strerror(errno));
+				++x->nfail;
+			}
+		}
+		double secs = (microsec_clock::universal_time() - x->tmstart).total_milliseconds() * 1E-3;
+		_gLog.Write("deleted <%s>: %lld files and %d directories in %.1f seconds, %lld failed", x->path.c_str(),
+				(long long) x->nfile, x->dirs.size(), secs, (long long) x->nfail);
+		if (!cbdone_.empty()) cbdone_(x->path);
+	}
+
+	mutex_lock lck(mtx_);
+	if (x->id) {
+		append_journal(str(boost::format("F\t%d\n") % x->id));
+		for (jobQueue::iterator it = active_.begin(); it != active_.end(); ++it) {
+			if (*it == x) {
+				active_.erase(it);
+				break;
+			}
+		}
+	}
+	x->done = true;
+	cvjob_.notify_all();
+}
+
+void DeleteEngine::throttle() {
+	if (!iops_) return;
+
+	mutex_lock lck(mtxrate_);
+	ptime now = microsec_clock::universal_time();
+	ptime t = tmnext_ > now ? tmnext_ : now;
+	tmnext_ = t + microseconds(1000000 / iops_);
+	lck.unlock();
+
+	if (t > now) boost::this_thread::sleep_for(boost::chrono::microseconds((t - now).total_microseconds()));
+}
+
+DeleteEngine::jobptr DeleteEngine::find_job(uint64_t id) {
+	for (jobQueue::iterator it = active_.begin(); it != active_.end(); ++it) {
+		if ((*it)->id == id) return *it;
+	}
+	return jobptr();
+}
+
+void DeleteEngine::append_journal(const string &line) {
+	if (!fpJournal_) fpJournal_ = fopen(pathJournal_.c_str(), "a");
+	if (fpJournal_) {
+		fputs(line.c_str(), fpJournal_);
+		fflush(fpJournal_);
+	}
+}
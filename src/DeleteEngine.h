@@ -0,0 +1,172 @@
+/*!
+ * @file DeleteEngine.h 并行批量删除引擎声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 删除整个目录树(盘区、观测夜或相机子目录)或一组文件
+ * - 扫描线程逐目录读取条目, 按批次交给工作线程, 以目录描述符执行unlinkat()
+ * - 所有删除操作共享IOPS预算, 工作线程使用空闲I/O优先级, 降低对写盘的影响
+ * - 目录树任务记入日志, 重启后继续未完成的任务
+ * - 定期输出目录树任务的进度
+ */
+
+#ifndef DELETEENGINE_H_
+#define DELETEENGINE_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/container/deque.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/function.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+using std::string;
+
+class DeleteEngine {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param journal 任务日志文件路径
+	 * @param nworker 工作线程数量
+	 * @param iops    删除操作速率上限, 量纲: 次/秒. 0: 不限速
+	 */
+	DeleteEngine(const string &journal, int nworker, int iops);
+	virtual ~DeleteEngine();
+
+public:
+	// 数据类型
+	typedef boost::function<void (const string &)> DoneSlot;	//< 目录树已删除回调函数
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef boost::posix_time::ptime ptime;
+
+	struct dirhandle {// 目录描述符, 由同一目录的批次共享
+		int fd;
+		dirhandle(int _fd) : fd(_fd) {}
+		~dirhandle();
+	};
+	typedef boost::shared_ptr<dirhandle> dirptr;
+
+	struct job {// 删除任务
+		uint64_t id;		//< 任务编号. 0: 文件组
+		string path;		//< 目录树根路径
+		std::vector<string> dirs;	//< 已扫描目录, 按先序排列
+		int pending;		//< 未完成批次数量
+		bool scanned;		//< 扫描完成
+		bool done;			//< 删除完成
+		int64_t nfile;		//< 已删除文件数量
+		int64_t nfail;		//< 删除失败数量
+		ptime tmstart;		//< 开始时间
+	};
+	typedef boost::shared_ptr<job> jobptr;
+
+	struct batch {// 批次
+		jobptr owner;		//< 所属任务
+		dirptr dir;			//< 目录. 为空时条目为完整路径
+		std::vector<string> names;	//< 条目名称
+	};
+	typedef boost::container::deque<batch> batchQueue;
+	typedef boost::container::deque<jobptr> jobQueue;
+
+protected:
+	// 成员变量
+	string pathJournal_;	//< 任务日志文件路径
+	FILE *fpJournal_;		//< 任务日志文件
+	int iops_;				//< 删除操作速率上限, 量纲: 次/秒
+	uint64_t idnext_;		//< 下一个任务编号
+	DoneSlot cbdone_;		//< 目录树已删除回调函数
+
+	boost::mutex mtx_;		//< 互斥锁
+	boost::condition_variable cvbatch_;	//< 条件变量: 批次入队或出队
+	boost::condition_variable cvjob_;	//< 条件变量: 任务入队或完成
+	batchQueue batches_;	//< 待执行批次
+	jobQueue jobs_;			//< 待扫描目录树任务
+	jobQueue active_;		//< 已提交且未完成的目录树任务
+
+	boost::mutex mtxrate_;	//< 互斥锁: 速率控制
+	ptime tmnext_;			//< 下一次删除操作的最早时间
+
+	boost::thread_group thrdwork_;	//< 工作线程
+	boost::shared_ptr<boost::thread> thrdscan_;	//< 扫描线程
+
+public:
+	// 接口
+	/*!
+	 * @brief 注册目录树已删除回调函数
+	 */
+	void RegisterDone(const DoneSlot &slot);
+	/*!
+	 * @brief 继续日志中未完成的任务
+	 * @note
+	 * 在RegisterDone()之后调用
+	 */
+	void Resume();
+	/*!
+	 * @brief 提交目录树删除任务
+	 * @param path 目录树根路径
+	 * @return
+	 * 任务编号
+	 */
+	uint64_t Submit(const string &path);
+	/*!
+	 * @brief 等待任务完成
+	 * @param id 任务编号
+	 */
+	void Wait(uint64_t id);
+	/*!
+	 * @brief 并行删除一组文件, 完成后返回
+	 * @param paths 文件完整路径
+	 * @return
+	 * 已删除或不存在的文件数量
+	 */
+	int Unlink(const std::vector<string> &paths);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 线程: 逐个扫描目录树任务并提交批次
+	 */
+	void thread_scan();
+	/*!
+	 * @brief 线程: 执行批次
+	 */
+	void thread_work();
+	/*!
+	 * @brief 扫描目录, 为其文件提交批次, 并递归扫描子目录
+	 * @param x     任务
+	 * @param dirfd 上级目录描述符
+	 * @param name  目录名称
+	 * @param path  目录完整路径
+	 */
+	void scan_directory(jobptr x, int dirfd, const string &name, const string &path);
+	/*!
+	 * @brief 提交批次. 队列满时等待
+	 */
+	void push_batch(const batch &b);
+	/*!
+	 * @brief 批次完成, 任务的全部批次完成后删除其目录
+	 */
+	void batch_done(jobptr x);
+	/*!
+	 * @brief 删除目录树中已清空的目录, 并记录任务完成
+	 */
+	void finish_job(jobptr x);
+	/*!
+	 * @brief 等待IOPS预算
+	 */
+	void throttle();
+	/*!
+	 * @brief 查找任务
+	 */
+	jobptr find_job(uint64_t id);
+	/*!
+	 * @brief 追加一条任务日志
+	 */
+	void append_journal(const string &line);
+};
+typedef boost::shared_ptr<DeleteEngine> DelEnginePtr;
+
+#endif /* DELETEENGINE_H_ */
@@ -0,0 +1,368 @@
+/*!
+ * @file FileIndex.cpp 已存储文件索引定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <fstream>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include "FileIndex.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+namespace fs = boost::filesystem;
+
+#define INDEX_COMPACT	10000	// 失效记录超出有效记录该数量时压缩索引文件
+
+int night_of_directory(const string &name) {
+	string::size_type pos;
+	int ymd, year, month, day;
+	char tail;
+
+	if (name.empty() || name[0] != 'G' || (pos = name.rfind('_')) == string::npos) return -1;
+	if (name.size() - pos != 7 || sscanf(name.c_str() + pos + 1, "%6d%c", &ymd, &tail) != 1) return -1;
+	day   = ymd % 100;
+	month = ymd / 100 % 100;
+	year  = ymd / 10000 + 2000;
+	try {
+		return ptime::date_type(year, month, day).modjulian_day();
+	}
+	catch(std::exception &ex) {
+		return -1;
+	}
+}
+
+FileIndex::FileIndex(const string &filepath) {
+	pathIndex_ = filepath;
+	fp_   = NULL;
+	dead_ = 0;
+}
+
+FileIndex::~FileIndex() {
+	if (fp_) fclose(fp_);
+}
+
+bool FileIndex::Open(const std::vector<string> &roots) {
+	std::vector<string> tokens;
+	string s;
+
+	boost::system::error_code ec;
+	fs::create_directories(fs::path(pathIndex_).parent_path(), ec);
+
+	mutex_lock lck(mtx_);
+	std::ifstream in(pathIndex_.c_str());
+	if (!in.is_open()) {
+		lck.unlock();
+		for (std::vector<string>::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+			_gLog.Write("file index <%s> is missing, rebuilds it from <%s>", pathIndex_.c_str(), it->c_str());
+			Rebuild(*it);
+		}
+		return fp_ != NULL;
+	}
+	while (std::getline(in, s)) {
+		if (in.eof()) break;	// 末行无换行符: 追加时中断的残缺记录
+		boost::trim_right_if(s, boost::is_any_of("\r\n"));
+		boost::split(tokens, s, boost::is_any_of("\t"));
+		if (tokens[0] == "A" && tokens.size() >= 7
+				&& !tokens[3].empty() && tokens[3].find_first_not_of("0123456789") == string::npos
+				&& !tokens[6].empty() && tokens[6].find_first_not_of("-0123456789") == string::npos) {
+			entry x;
+			x.root    = tokens[1];
+			x.relpath = tokens[2];
+			x.size    = std::stoll(tokens[3]);
+			x.cid     = tokens[4];
+			x.tmobs   = tokens[5];
+			x.night   = std::stoi(tokens[6]);
+			if (tokens.size() > 7 && tokens[7] != "-") x.checksum = tokens[7];
+			if (tokens.size() > 8) x.keywords = boost::join(std::vector<string>(tokens.begin() + 8, tokens.end()), "\t");
+			insert(x);
+		}
+		else if (tokens[0] == "D" && tokens.size() == 3) {
+			erase((fs::path(tokens[1]) / tokens[2]).string());
+		}
+		else if (tokens[0] == "T" && tokens.size() == 2) {
+			erase_tree(tokens[1]);
+		}
+		else if (tokens[0] == "M" && tokens.size() == 4) {
+			move((fs::path(tokens[1]) / tokens[2]).string(), tokens[3]);
+		}
+	}
+	in.close();
+	compact();
+	_gLog.Write("file index <%s> holds %d files", pathIndex_.c_str(), entries_.size());
+
+	return fp_ != NULL;
+}
+
+void FileIndex::Rebuild(const string &root) {
+	std::vector<entry> found;
+	struct stat st;
+	int night;
+
+	try {
+		for (fs::directory_iterator x(root), end; x != end; ++x) {
+			if ((night = night_of_directory(x->path().filename().string())) < 0) continue;
+			for (fs::recursive_directory_iterator y(x->path()), yend; y != yend; ++y) {
+				if (lstat(y->path().c_str(), &st) || !S_ISREG(st.st_mode)) continue;
+				entry e;
+				e.root    = root;
+				e.relpath = y->path().lexically_relative(root).string();
+				e.size    = st.st_size;
+				e.tmobs   = to_iso_extended_string(from_time_t(st.st_mtime));
+				e.night   = night;
+				found.push_back(e);
+			}
+		}
+	}
+	catch(fs::filesystem_error &ex) {
+		_gLog.Write(LOG_WARN, "FileIndex::Rebuild", "%s", ex.what());
+	}
+
+	mutex_lock lck(mtx_);
+	for (entryMap::iterator it = entries_.begin(); it != entries_.end(); ) {
+		entryMap::iterator next = it;
+		++next;
+		if (it->second.root == root) {
+			string fullpath = it->first;
+			erase(fullpath);
+		}
+		it = next;
+	}
+	for (std::vector<entry>::iterator it = found.begin(); it != found.end(); ++it) insert(*it);
+	compact();
+	_gLog.Write("file index is rebuilt from <%s>, %d files", root.c_str(), found.size());
+}
+
+void FileIndex::Add(const string &root, const string &relpath, int64_t size, const string &cid, const string &tmobs,
+		const string &checksum, const string &keywords) {
+	entry x;
+	x.root    = root;
+	x.relpath = relpath;
+	x.size    = size;
+	x.cid     = cid;
+	x.tmobs   = tmobs;
+	x.checksum = checksum;
+	x.keywords = keywords;
+	if ((x.night = night_of_time(tmobs)) < 0) {// 观测时间无法解析时, 以写盘时间排序
+		x.tmobs = to_iso_extended_string(second_clock::universal_time());
+		x.night = night_of_time(x.tmobs);
+	}
+
+	boost::format fmt("A\t%s\t%s\t%d\t%s\t%s\t%d\t%s%s\n");
+	fmt % root % relpath % size % cid % x.tmobs % x.night % (checksum.empty() ? "-" : checksum)
+		% (keywords.empty() ? "" : "\t" + keywords);
+	mutex_lock lck(mtx_);
+	if (entries_.count((fs::path(root) / relpath).string())) ++dead_;	// 覆盖同名文件
+	insert(x);
+	append(fmt.str());
+}
+
+void FileIndex::Remove(const string &root, const string &relpath) {
+	string fullpath = (fs::path(root) / relpath).string();
+	mutex_lock lck(mtx_);
+
+	if (!entries_.count(fullpath)) return;
+	erase(fullpath);
+	append("D\t" + root + "\t" + relpath + "\n");
+	dead_ += 2;
+	if (dead_ > int(entries_.size()) + INDEX_COMPACT) compact();
+}
+
+bool FileIndex::Move(const string &root, const string &relpath, const string &newroot) {
+	mutex_lock lck(mtx_);
+
+	if (!move((fs::path(root) / relpath).string(), newroot)) return false;
+	append("M\t" + root + "\t" + relpath + "\t" + newroot + "\n");
+	dead_ += 2;
+	if (dead_ > int(entries_.size()) + INDEX_COMPACT) compact();
+	return true;
+}
+
+bool FileIndex::Oldest(const string &root, entry &x) {
+	mutex_lock lck(mtx_);
+	ageMap::iterator it = ages_.find(root);
+	if (it == ages_.end() || it->second.empty()) return false;
+	x = entries_[it->second.begin()->second];
+	return true;
+}
+
+void FileIndex::Oldest(const string &root, int n, std::vector<entry> &vec) {
+	mutex_lock lck(mtx_);
+	ageMap::iterator it = ages_.find(root);
+
+	vec.clear();
+	if (it == ages_.end()) return;
+	for (ageSet::iterator ita = it->second.begin(); ita != it->second.end() && int(vec.size()) < n; ++ita)
+		vec.push_back(entries_[ita->second]);
+}
+
+void FileIndex::Before(const string &root, int night, const string &skip, int n, std::vector<entry> &vec) {
+	mutex_lock lck(mtx_);
+	ageMap::iterator it = ages_.find(root);
+
+	vec.clear();
+	if (it == ages_.end()) return;
+	for (ageSet::iterator ita = it->second.begin(); ita != it->second.end() && int(vec.size()) < n; ++ita) {
+		entry &x = entries_[ita->second];
+		if (x.night >= night) break;	// 观测夜随观测时间递增
+		if (!skip.empty() && boost::ends_with(x.relpath, skip)) continue;
+		vec.push_back(x);
+	}
+}
+
+bool FileIndex::Find(const string &root, const string &relpath, entry &x) {
+	mutex_lock lck(mtx_);
+	entryMap::iterator it = entries_.find((fs::path(root) / relpath).string());
+
+	if (it == entries_.end()) return false;
+	x = it->second;
+	return true;
+}
+
+int64_t FileIndex::TreeBytes(const string &path) {
+	string prefix = boost::trim_right_copy_if(path, boost::is_any_of("/")) + "/";
+	int64_t bytes(0);
+	mutex_lock lck(mtx_);
+
+	for (entryMap::iterator it = entries_.lower_bound(prefix);
+			it != entries_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+		bytes += it->second.size;
+	return bytes;
+}
+
+int FileIndex::RemoveTree(const string &path) {
+	mutex_lock lck(mtx_);
+	int n = erase_tree(path);
+
+	if (n) {
+		append("T\t" + path + "\n");
+		dead_ += n + 1;
+		if (dead_ > int(entries_.size()) + INDEX_COMPACT) compact();
+	}
+	return n;
+}
+
+int FileIndex::Count() {
+	mutex_lock lck(mtx_);
+	return entries_.size();
+}
+
+int64_t FileIndex::Used(const string &root) {
+	mutex_lock lck(mtx_);
+	rootMap::iterator it = roots_.find(root);
+	return it == roots_.end() ? 0 : it->second;
+}
+
+int64_t FileIndex::Bytes(const string &cid, int night) {
+	mutex_lock lck(mtx_);
+	camMap::iterator it = cams_.find(camnight(cid, night));
+	return it == cams_.end() ? 0 : it->second;
+}
+
+int64_t FileIndex::NightBytes(int night) {
+	mutex_lock lck(mtx_);
+	nightMap::iterator it = nights_.find(night);
+	return it == nights_.end() ? 0 : it->second;
+}
+
+int FileIndex::night_of_time(const string &tmobs) {
+	typedef boost::date_time::c_local_adjustor<ptime> local_adj;
+	try {
+		ptime tmlocal = local_adj::utc_to_local(from_iso_extended_string(tmobs));
+		return (tmlocal - hours(12)).date().modjulian_day();
+	}
+	catch(std::exception &ex) {
+		return -1;
+	}
+}
+
+void FileIndex::insert(const entry &x) {
+	string fullpath = (fs::path(x.root) / x.relpath).string();
+	entryMap::iterator it = entries_.find(fullpath);
+
+	if (it != entries_.end()) erase(fullpath);
+	entries_[fullpath] = x;
+	ages_[x.root].insert(std::make_pair(x.tmobs, fullpath));
+	cams_[camnight(x.cid, x.night)] += x.size;
+	roots_[x.root] += x.size;
+	nights_[x.night] += x.size;
+}
+
+void FileIndex::erase(const string &fullpath) {
+	entryMap::iterator it = entries_.find(fullpath);
+	if (it == entries_.end()) return;
+
+	entry &x = it->second;
+	camMap::iterator itc = cams_.find(camnight(x.cid, x.night));
+	if ((itc->second -= x.size) <= 0) cams_.erase(itc);
+	rootMap::iterator itr = roots_.find(x.root);
+	if ((itr->second -= x.size) <= 0) roots_.erase(itr);
+	nightMap::iterator itn = nights_.find(x.night);
+	if ((itn->second -= x.size) <= 0) nights_.erase(itn);
+	ageMap::iterator ita = ages_.find(x.root);
+	ita->second.erase(std::make_pair(x.tmobs, fullpath));
+	if (ita->second.empty()) ages_.erase(ita);
+	entries_.erase(it);
+}
+
+bool FileIndex::move(const string &fullpath, const string &newroot) {
+	entryMap::iterator it = entries_.find(fullpath);
+	if (it == entries_.end()) return false;
+
+	entry x = it->second;
+	erase(fullpath);
+	x.root = newroot;
+	insert(x);
+	return true;
+}
+
+int FileIndex::erase_tree(const string &path) {
+	string prefix = boost::trim_right_copy_if(path, boost::is_any_of("/")) + "/";
+	std::vector<string> paths;
+
+	for (entryMap::iterator it = entries_.lower_bound(prefix);
+			it != entries_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+		paths.push_back(it->first);
+	for (std::vector<string>::iterator it = paths.begin(); it != paths.end(); ++it) erase(*it);
+	return int(paths.size());
+}
+
+void FileIndex::compact() {
+	string pathtmp = pathIndex_ + ".tmp";
+	FILE *fp;
+
+	if (fp_) {
+		fclose(fp_);
+		fp_ = NULL;
+	}
+	if ((fp = fopen(pathtmp.c_str(), "w"))) {
+		for (ageMap::iterator itr = ages_.begin(); itr != ages_.end(); ++itr) {
+			for (ageSet::iterator it = itr->second.begin(); it != itr->second.end(); ++it) {
+				entry &x = entries_[it->second];
+				fprintf(fp, "A\t%s\t%s\t%lld\t%s\t%s\t%d\t%s%s%s\n", x.root.c_str(), x.relpath.c_str(),
+						(long long) x.size, x.cid.c_str(), x.tmobs.c_str(), x.night,
+						x.checksum.empty() ? "-" : x.checksum.c_str(), x.keywords.empty() ? "" : "\t",
+						x.keywords.c_str());
+			}
+		}
+		if (fclose(fp) == 0) rename(pathtmp.c_str(), pathIndex_.c_str());
+	}
+	dead_ = 0;
+	if (!(fp_ = fopen(pathIndex_.c_str(), "a")))
+		_gLog.Write(LOG_WARN, "FileIndex", "failed to open file index<%s>. %s", pathIndex_.c_str(), strerror(errno));
+}
+
+void FileIndex::append(const string &line) {
+	if (fp_) {
+		fputs(line.c_str(), fp_);
+		fflush(fp_);
+	}
+}
@@ -0,0 +1,211 @@
+/*!
+ * @file FileIndex.h 已存储文件索引声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 记录已写盘文件的路径、大小、相机、观测时间、校验和、FITS关键字与存储盘区
+ * - 磁盘文件仅追加, 以制表符分隔: A 新文件, D 已删除, T 目录树已删除, M 已迁移盘区. 加载时压缩
+ * - 内存中按观测时间排序, 回收、容量统计及按相机与观测夜统计的查询为O(log n)
+ * - 索引文件丢失时, 扫描盘区中的观测夜目录(G*_yymmdd)重建
+ */
+
+#ifndef FILEINDEX_H_
+#define FILEINDEX_H_
+
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+using std::string;
+
+/*!
+ * @brief 由目录名G*_yymmdd解析观测夜日期
+ * @return
+ * 修正儒略日. 名称不符时返回-1
+ */
+extern int night_of_directory(const string &name);
+
+class FileIndex {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param filepath 索引文件路径
+	 */
+	FileIndex(const string &filepath);
+	virtual ~FileIndex();
+
+public:
+	// 数据类型
+	struct entry {// 文件记录
+		string root;	//< 存储盘区
+		string relpath;	//< 相对盘区的路径
+		int64_t size;	//< 文件大小, 量纲: 字节
+		string cid;		//< 相机标志. 扫描重建时为空
+		string tmobs;	//< 观测时间, ISO扩展格式. 扫描重建或无法解析时为写盘时间
+		int night;		//< 观测夜, 修正儒略日. <0: 未知
+		string checksum;	//< 文件校验和. 为空时未知
+		string keywords;	//< FITS关键字, 以制表符分隔的"关键字=值"
+	};
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef std::map<string, entry> entryMap;	//< 完整路径-文件记录
+	typedef std::set<std::pair<string, string> > ageSet;	//< 观测时间+完整路径
+	typedef std::map<string, ageSet> ageMap;	//< 盘区-按观测时间排序的文件
+	typedef std::pair<string, int> camnight;	//< 相机+观测夜
+	typedef std::map<camnight, int64_t> camMap;	//< 相机与观测夜的字节数
+	typedef std::map<string, int64_t> rootMap;	//< 盘区的字节数
+	typedef std::map<int, int64_t> nightMap;	//< 观测夜的字节数
+
+protected:
+	// 成员变量
+	string pathIndex_;	//< 索引文件路径
+	FILE *fp_;			//< 索引文件
+	boost::mutex mtx_;	//< 互斥锁
+	entryMap entries_;	//< 文件记录
+	ageMap ages_;		//< 各盘区按观测时间排序
+	camMap cams_;		//< 按相机与观测夜统计
+	rootMap roots_;		//< 按盘区统计
+	nightMap nights_;	//< 按观测夜统计
+	int dead_;			//< 索引文件中已失效的记录数
+
+public:
+	// 接口
+	/*!
+	 * @brief 加载并压缩索引文件. 索引文件不存在时扫描各盘区重建
+	 * @param roots 存储盘区
+	 * @return
+	 * 索引文件可写入
+	 */
+	bool Open(const std::vector<string> &roots);
+	/*!
+	 * @brief 扫描盘区中的观测夜目录重建索引, 替换该盘区的原有记录
+	 * @param root 存储盘区
+	 */
+	void Rebuild(const string &root);
+	/*!
+	 * @brief 记录新写盘文件
+	 * @param root    存储盘区
+	 * @param relpath 相对盘区的路径
+	 * @param size    文件大小, 量纲: 字节
+	 * @param cid     相机标志
+	 * @param tmobs   观测时间, ISO扩展格式
+	 * @param checksum 文件校验和
+	 * @param keywords FITS关键字, 以制表符分隔的"关键字=值"
+	 */
+	void Add(const string &root, const string &relpath, int64_t size, const string &cid, const string &tmobs,
+			const string &checksum = string(), const string &keywords = string());
+	/*!
+	 * @brief 记录文件已删除
+	 */
+	void Remove(const string &root, const string &relpath);
+	/*!
+	 * @brief 记录文件已迁移至其它盘区, 相对路径不变
+	 * @param root    原存储盘区
+	 * @param relpath 相对盘区的路径
+	 * @param newroot 新存储盘区
+	 * @return
+	 * 文件在索引中
+	 */
+	bool Move(const string &root, const string &relpath, const string &newroot);
+	/*!
+	 * @brief 查看盘区中最早的文件
+	 * @param root 存储盘区
+	 * @param x    文件记录
+	 * @return
+	 * 盘区中无文件时返回false
+	 */
+	bool Oldest(const string &root, entry &x);
+	/*!
+	 * @brief 按观测时间由早至晚查看盘区中的文件
+	 * @param root 存储盘区
+	 * @param n    最多查看的文件数量
+	 * @param vec  文件记录
+	 */
+	void Oldest(const string &root, int n, std::vector<entry> &vec);
+	/*!
+	 * @brief 按观测时间由早至晚查看盘区中早于观测夜的文件
+	 * @param root  存储盘区
+	 * @param night 观测夜, 修正儒略日. 仅查看之前观测夜的文件
+	 * @param skip  跳过以该后缀结尾的文件
+	 * @param n     最多查看的文件数量
+	 * @param vec   文件记录
+	 */
+	void Before(const string &root, int night, const string &skip, int n, std::vector<entry> &vec);
+	/*!
+	 * @brief 查找文件记录
+	 * @return
+	 * 文件在索引中
+	 */
+	bool Find(const string &root, const string &relpath, entry &x);
+	/*!
+	 * @brief 查看目录树中已索引文件的总字节数
+	 * @param path 目录完整路径
+	 */
+	int64_t TreeBytes(const string &path);
+	/*!
+	 * @brief 记录目录树已删除
+	 * @param path 目录完整路径
+	 * @return
+	 * 目录树中的文件数量
+	 */
+	int RemoveTree(const string &path);
+	/*!
+	 * @brief 查看文件数量
+	 */
+	int Count();
+	/*!
+	 * @brief 查看盘区中已索引文件的总字节数
+	 */
+	int64_t Used(const string &root);
+	/*!
+	 * @brief 查看相机在观测夜的写盘字节数
+	 * @param cid   相机标志
+	 * @param night 观测夜, 修正儒略日
+	 */
+	int64_t Bytes(const string &cid, int night);
+	/*!
+	 * @brief 查看观测夜全部相机的写盘字节数
+	 * @param night 观测夜, 修正儒略日
+	 */
+	int64_t NightBytes(int night);
+	/*!
+	 * @brief 由观测时间计算观测夜: 本地时间正午至次日正午
+	 * @return
+	 * 修正儒略日. 无法解析时返回-1
+	 */
+	static int night_of_time(const string &tmobs);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 在内存中插入/删除文件记录
+	 */
+	void insert(const entry &x);
+	void erase(const string &fullpath);
+	/*!
+	 * @brief 在内存中将文件记录移至新盘区
+	 */
+	bool move(const string &fullpath, const string &newroot);
+	/*!
+	 * @brief 在内存中删除目录树中的文件记录
+	 * @return
+	 * 删除的记录数量
+	 */
+	int erase_tree(const string &path);
+	/*!
+	 * @brief 以有效记录重写索引文件
+	 */
+	void compact();
+	/*!
+	 * @brief 追加一条记录
+	 */
+	void append(const string &line);
+};
+typedef boost::shared_ptr<FileIndex> FileIndexPtr;
+
+#endif /* FILEINDEX_H_ */
@@ -6,24 +6,39 @@
 #include <boost/make_shared.hpp>
 #include <boost/format.hpp>
 #include <boost/bind/bind.hpp>
+#include <time.h>
 #include "FileReceiver.h"
+#include "TileCompressor.h"
+#include "Checksum.h"
 #include "GLog.h"
 
+#define CODEC_RICE	"rice"	// 传输压缩算法: RICE_1分块压缩图像
+
 using namespace boost::placeholders;
 
-FileRcvPtr make_filercv(FileWritePtr ptr) {
-	return boost::make_shared<FileReceiver>(ptr);
+FileRcvPtr make_filercv(FileWritePtr ptr, BufPoolPtr bufpool) {
+	return boost::make_shared<FileReceiver>(ptr, bufpool);
 }
 
-FileReceiver::FileReceiver(FileWritePtr fwptr) {
-	fwptr_ = fwptr;
+FileReceiver::FileReceiver(FileWritePtr fwptr, BufPoolPtr bufpool) {
+	fwptr_   = fwptr;
+	bufpool_ = bufpool;
 	state_ = WAITING;
 	ascproto_ = boost::make_shared<AsciiProtocol>();
 	bufrcv_.reset(new char[TCP_PACK_SIZE]);
+	streamsize_ = INT64_MAX;
+	chunksize_  = 4 << 20;
+	depth_      = 4;
+	nencoded_   = 0;
+	ndecoded_   = 0;
+	wirebytes_  = 0;
+	rawbytes_   = 0;
+	cpudecode_  = 0.0;
 }
 
 FileReceiver::~FileReceiver() {
 	Stop();
+	if (fileptr_.use_count() && fileptr_->pipe.use_count()) fileptr_->pipe->Abort();
 }
 
 bool FileReceiver::CoupleNetwork(TcpCPtr client) {
@@ -54,6 +69,12 @@ bool FileReceiver::IsAlive() {
 	return (tcpptr_.unique() && tcpptr_->IsOpen());
 }
 
+void FileReceiver::SetStream(int64_t threshold, int chunksize, int depth) {
+	streamsize_ = threshold;
+	chunksize_  = chunksize;
+	depth_      = depth;
+}
+
 void FileReceiver::network_receive(long client, long ec) {
 	if (ec) PostMessage(MSG_NETWORK_CLOSE);
 	else if(state_ == READY) {// 接收文件数据
@@ -87,8 +108,27 @@ void FileReceiver::on_network_receive(long param1, long param2) {
 			// 缓存文件信息
 			apfileinfo fileinfo = from_apbase<ascii_proto_fileinfo>(base);
 			const long n = fileptr_.use_count();
-			if (n == 0 || n > 1 || (n == 1 && fileptr_->filesize != fileinfo->filesize))
-				fileptr_ = boost::make_shared<FileInfo>(fileinfo->filesize);
+			if (!fileinfo->codec.empty() && fileinfo->codec != CODEC_RICE) {// 拒绝, 由客户端不压缩重发
+				_gLog.Write(LOG_WARN, "FileReceiver", "rejects <%s> for unsupported codec<%s>",
+						fileinfo->filename.c_str(), fileinfo->codec.c_str());
+				notify_status(FAILURE);
+				state_ = WAITING;
+				return;
+			}
+			uint32_t crc;
+			if (!fileinfo->checksum.empty() && !crc32c_parse(fileinfo->checksum, crc)) {// 拒绝, 由客户端改用crc32c
+				_gLog.Write(LOG_WARN, "FileReceiver", "rejects <%s> for unsupported checksum<%s>",
+						fileinfo->filename.c_str(), fileinfo->checksum.c_str());
+				notify_status(FAILURE);
+				state_ = WAITING;
+				return;
+			}
+			checksum_ = fileinfo->checksum;
+			if (fileinfo->filesize > streamsize_ && fileinfo->codec.empty())	// 压缩文件在内存中接收
+				fileptr_ = boost::make_shared<FileInfo>(fileinfo->filesize, chunksize_, depth_, bufpool_);
+			else if (n == 0 || n > 1 || fileptr_->pipe.use_count() || fileptr_->filesize != fileinfo->filesize
+					|| !fileptr_->filedata.unique()) // 缓冲区仍被帧缓存或数据库注册引用
+				fileptr_ = boost::make_shared<FileInfo>(fileinfo->filesize, bufpool_);
 			fileptr_->gid      = fileinfo->gid;
 			fileptr_->uid      = fileinfo->uid;
 			fileptr_->cid      = fileinfo->cid;
@@ -96,8 +136,13 @@ void FileReceiver::on_network_receive(long param1, long param2) {
 			fileptr_->subpath  = fileinfo->subpath;
 			fileptr_->filename = fileinfo->filename;
 			fileptr_->rcvsize  = 0;
+			fileptr_->crc      = 0;
+			fileptr_->checksum.clear();
+			fileptr_->keywords.clear();
+			fileptr_->codec    = fileinfo->codec;
+			if (fileptr_->pipe.use_count()) fwptr_->NewStream(fileptr_);
 			// 通知可以接收数据
-			notify_status(READY);
+			notify_status(READY, fileinfo->codec);
 		}
 		else if (base->type == "filestat") {
 			//...心跳机制, 不处理
@@ -110,28 +155,90 @@ void FileReceiver::on_network_receive(long param1, long param2) {
 }
 
 void FileReceiver::on_network_close(long param1, long param2) {
+	if (fileptr_.use_count() && fileptr_->pipe.use_count()) fileptr_->pipe->Abort();
+	if (nencoded_) {
+		_gLog.Write("%d compressed transfers, %d decoded: %.1f MB on wire for %.1f MB raw, decode %.1f ms/file",
+				nencoded_, ndecoded_, wirebytes_ / 1048576.0, rawbytes_ / 1048576.0,
+				ndecoded_ ? cpudecode_ * 1000.0 / ndecoded_ : 0.0);
+	}
 	tcpptr_.reset();
 }
 
 void FileReceiver::on_receive_complete(long param1, long param2) {
-	if (fileptr_->filesize == fileptr_->rcvsize) {
-		fwptr_->NewFile(fileptr_);
+	if (!fileptr_.use_count()) return;	// 管道中止后重复到达的完成消息
+
+	ChunkPipePtr pipe = fileptr_->pipe;
+	bool aborted = pipe.use_count() && pipe->IsAborted();
+	bool rcvd = fileptr_->filesize == fileptr_->rcvsize && !aborted;
+
+	if (rcvd && verify_checksum() && decode_file()) {
+		if (pipe.use_count()) pipe->Close();
+		else fwptr_->NewFile(fileptr_);
+		fileptr_.reset(); // 写盘完成后, 由FileWritter释放缓冲区
 		notify_status(COMPLETE);
 	}
 	else {
-		_gLog.Write(LOG_FAULT, NULL, "bytes received<%d> is greater than file size<%d>",
-				fileptr_->rcvsize, fileptr_->filesize);
+		if (aborted) _gLog.Write(LOG_FAULT, NULL, "stream of <%s> is aborted at %lld of %lld bytes",
+				fileptr_->filename.c_str(), (long long) fileptr_->rcvsize, (long long) fileptr_->filesize);
+		else if (!rcvd) _gLog.Write(LOG_FAULT, NULL, "bytes received<%lld> mismatches file size<%lld>",
+				(long long) fileptr_->rcvsize, (long long) fileptr_->filesize);
+		if (pipe.use_count()) {
+			pipe->Abort();
+			fileptr_.reset();
+		}
 		notify_status(FAILURE);
 	}
 	state_ = WAITING;
 }
 
-void FileReceiver::notify_status(int status) {
+bool FileReceiver::verify_checksum() {
+	uint32_t crc;
+
+	if (!checksum_.empty() && crc32c_parse(checksum_, crc) && crc != fileptr_->crc) {
+		_gLog.Write(LOG_FAULT, "FileReceiver", "<%s> is corrupted: checksum<%s> received as <%s>",
+				fileptr_->filename.c_str(), checksum_.c_str(), crc32c_string(fileptr_->crc).c_str());
+		return false;
+	}
+	fileptr_->checksum = crc32c_string(fileptr_->crc);
+	return true;
+}
+
+bool FileReceiver::decode_file() {
+	if (fileptr_->codec.empty()) return true;
+	++nencoded_;
+	if (fwptr_->StoresCompressed()) return true;	// 存储格式相同, 直接写盘
+
+	boost::shared_array<char> data;
+	int64_t size;
+	struct timespec t0, t1;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+	bool rslt = TileCompressor::Decompress(fileptr_->filedata.get(), fileptr_->filesize, bufpool_, data, size);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+	if (!rslt) {
+		_gLog.Write(LOG_FAULT, "FileReceiver", "failed to decode <%s> with codec<%s>",
+				fileptr_->filename.c_str(), fileptr_->codec.c_str());
+		return false;
+	}
+	++ndecoded_;
+	wirebytes_ += fileptr_->filesize;
+	rawbytes_  += size;
+	cpudecode_ += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1E-9;
+	fileptr_->filedata = data;
+	fileptr_->filesize = size;
+	fileptr_->rcvsize  = size;
+	fileptr_->checksum = crc32c_string(crc32c_update(0, data.get(), size));
+	fileptr_->codec.clear();
+	return true;
+}
+
+void FileReceiver::notify_status(int status, const string &codec) {
 	apfilestat filestat = boost::make_shared<ascii_proto_filestat>();
 	const char *tosend;
 	int n;
 
 	filestat->status = state_ = status;
+	filestat->codec  = codec;
 	tosend = ascproto_->CompactFileStat(filestat, n);
 	tcpptr_->Write(tosend, n);
 }
@@ -6,6 +6,8 @@
  * - 维持网络连接
  * - 接收客户端信息和文件数据
  * - 向客户端反馈状态
+ * - 接收数据时增量计算CRC32C, 与客户端声明的校验和不符时拒绝文件
+ * - 协商传输压缩: 接受rice算法压缩的图像. 存储格式相同时直接写盘, 否则解压至帧缓冲区
  */
 
 #ifndef FILERECEIVER_H_
@@ -19,7 +21,7 @@
 
 class FileReceiver : public MessageQueue {
 public:
-	FileReceiver(FileWritePtr fwptr);
+	FileReceiver(FileWritePtr fwptr, BufPoolPtr bufpool = BufPoolPtr());
 	virtual ~FileReceiver();
 
 protected:
@@ -43,11 +45,21 @@ protected:
 protected:
 	// 成员变量
 	FileWritePtr fwptr_;		//< 文件写盘接口
+	BufPoolPtr bufpool_;		//< 文件缓冲区池
 	nfileptr fileptr_;		//< 待接收数据
 	TcpCPtr tcpptr_;			//< 网络接口
 	AscProtoPtr ascproto_;	//< 通信协议封装接口
 	int state_;				//< 文件传输过程
 	charray bufrcv_;			//< 数据接收缓存区
+	int64_t streamsize_;		//< 流式接收阈值, 量纲: 字节. 大于该值的文件以数据块写盘
+	int chunksize_;			//< 流式接收数据块长度, 量纲: 字节
+	int depth_;				//< 流式接收管道深度
+	string checksum_;		//< 客户端声明的当前文件校验和. 为空时不校验
+	int nencoded_;			//< 压缩传输的文件数量
+	int ndecoded_;			//< 接收后解压的文件数量
+	int64_t wirebytes_;		//< 解压文件的传输字节数
+	int64_t rawbytes_;		//< 解压文件的原始字节数
+	double cpudecode_;		//< 解压CPU耗时, 量纲: 秒
 
 public:
 	// 接口
@@ -64,6 +76,13 @@ public:
 	 * 网络连接有效性
 	 */
 	bool IsAlive();
+	/*!
+	 * @brief 设置流式接收参数
+	 * @param threshold 流式接收阈值, 量纲: 字节
+	 * @param chunksize 数据块长度, 量纲: 字节
+	 * @param depth     管道深度
+	 */
+	void SetStream(int64_t threshold, int chunksize, int depth);
 
 protected:
 	// 功能
@@ -97,17 +116,31 @@ protected:
 	void on_receive_complete(long param1, long param2);
 	/*!
 	 * @brief 通知远程主机数据接收状况
-	 * @param status 接收状态. 1: 可以发送数据; 2: 完成数据接收
+	 * @param status 接收状态. 1: 可以发送数据; 2: 完成数据接收; 3: 接收错误
+	 * @param codec  已接受的传输压缩算法
+	 */
+	void notify_status(int status, const string &codec = "");
+	/*!
+	 * @brief 解压压缩传输的文件
+	 * @return
+	 * 解压成功
+	 */
+	bool decode_file();
+	/*!
+	 * @brief 比对接收数据与客户端声明的校验和, 并记录写盘内容的校验和
+	 * @return
+	 * 校验和一致或客户端未声明
 	 */
-	void notify_status(int status);
+	bool verify_checksum();
 };
 typedef boost::shared_ptr<FileReceiver> FileRcvPtr;
 /*!
  * @brief 工厂函数, 创建TransferClient指针
- * @param ptr 文件写盘接口
+ * @param ptr     文件写盘接口
+ * @param bufpool 文件缓冲区池
  * @return
  * 文件接收接口
  */
-extern FileRcvPtr make_filercv(FileWritePtr ptr);
+extern FileRcvPtr make_filercv(FileWritePtr ptr, BufPoolPtr bufpool = BufPoolPtr());
 
 #endif /* FILERECEIVER_H_ */
@@ -0,0 +1,251 @@
+/*!
+ * @file FileSpool.cpp 预写缓存(spool)定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <set>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#include "FileSpool.h"
+#include "FileWritter.h"
+#include "GLog.h"
+
+#define SPOOL_MAGIC		0x50535446	//< 记录起始标志: FTSP
+#define SPOOL_END		0x45535446	//< 记录结束标志: FTSE
+#define SPOOL_OFFSET	40			//< 缓存编号中段编号的偏移位数
+
+/*!
+ * @brief 向文件描述符写入完整数据
+ */
+static bool write_all(int fd, const char *data, int64_t n) {
+	ssize_t len;
+	while (n > 0) {
+		if ((len = write(fd, data, n)) < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += len;
+		n    -= len;
+	}
+	return true;
+}
+
+FileSpool::FileSpool(const string &path, int64_t segsize, bool sync) {
+	pathRoot_ = path;
+	segsize_  = segsize;
+	sync_     = sync;
+	segcur_   = 0;
+	fdcur_    = -1;
+	offcur_   = 0;
+}
+
+FileSpool::~FileSpool() {
+	if (fdcur_ >= 0) close(fdcur_);
+}
+
+bool FileSpool::Open(nfileVec &files) {
+	namespace fs = boost::filesystem;
+	boost::system::error_code ec;
+	std::vector<uint32_t> segs;
+	string name;
+	int n;
+
+	fs::create_directories(pathRoot_, ec);
+	if (!fs::is_directory(pathRoot_, ec)) {
+		_gLog.Write(LOG_FAULT, "FileSpool::Open", "spool directory<%s> is unavailable", pathRoot_.c_str());
+		return false;
+	}
+
+	for (fs::directory_iterator x = fs::directory_iterator(pathRoot_); x != fs::directory_iterator(); ++x) {
+		name = x->path().filename().string();
+		if (x->path().extension() == ".spl" && name.find_first_not_of("0123456789") == 8)
+			segs.push_back(stoul(name.substr(0, 8)));
+	}
+	std::sort(segs.begin(), segs.end());
+
+	mutex_lock lck(mtx_);
+	for (std::vector<uint32_t>::iterator it = segs.begin(); it != segs.end(); ++it) {
+		if ((n = replay_segment(*it, files))) pending_[*it] = n;
+		else remove_segment(*it);
+	}
+	segcur_ = segs.empty() ? 0 : segs.back() + 1;
+	if (files.size()) _gLog.Write("%d uncommitted files are recovered from spool <%s>", files.size(), pathRoot_.c_str());
+
+	return true;
+}
+
+bool FileSpool::Append(nfileptr ptr) {
+	boost::format fmt("gid=%s\nuid=%s\ncid=%s\ngrid=%s\nfield=%s\ntmobs=%s\nsubpath=%s\nfilename=%s\n");
+	fmt % ptr->gid % ptr->uid % ptr->cid % ptr->grid % ptr->field % ptr->tmobs % ptr->subpath % ptr->filename;
+	string meta = fmt.str();
+	spool_head head;
+	uint32_t tail(SPOOL_END);
+
+	head.magic   = SPOOL_MAGIC;
+	head.lenmeta = meta.size();
+	head.lendata = ptr->filesize;
+
+	mutex_lock lck(mtx_);
+	if (fdcur_ < 0 && !new_segment()) return false;
+	if (!(write_all(fdcur_, (const char*) &head, sizeof(head))
+			&& write_all(fdcur_, meta.data(), meta.size())
+			&& write_all(fdcur_, ptr->filedata.get(), ptr->filesize)
+			&& write_all(fdcur_, (const char*) &tail, sizeof(tail)))) {
+		_gLog.Write(LOG_FAULT, "FileSpool::Append", "failed to spool <%s>. %s", ptr->filename.c_str(), strerror(errno));
+		if (ftruncate(fdcur_, offcur_) || lseek(fdcur_, offcur_, SEEK_SET) < 0) {
+			close(fdcur_);
+			fdcur_ = -1;
+			++segcur_;
+		}
+		return false;
+	}
+	if (sync_) fdatasync(fdcur_);
+
+	ptr->spoolid = (int64_t(segcur_) << SPOOL_OFFSET) | offcur_;
+	++pending_[segcur_];
+	offcur_ += sizeof(head) + meta.size() + ptr->filesize + sizeof(tail);
+	if (offcur_ >= segsize_) {// 封存当前段
+		close(fdcur_);
+		fdcur_ = -1;
+		++segcur_;
+	}
+
+	return true;
+}
+
+bool FileSpool::IsSync() {
+	return sync_;
+}
+
+void FileSpool::Commit(int64_t spoolid) {
+	if (spoolid < 0) return;
+
+	uint32_t seg = spoolid >> SPOOL_OFFSET;
+	int64_t offset = spoolid & ((int64_t(1) << SPOOL_OFFSET) - 1);
+	mutex_lock lck(mtx_);
+	segmap::iterator it = pending_.find(seg);
+
+	if (it == pending_.end()) return;
+	if (--it->second == 0 && (seg != segcur_ || fdcur_ < 0)) {
+		pending_.erase(it);
+		remove_segment(seg);
+	}
+	else {
+		FILE *fp = fopen(segment_path(seg, ".cmt").c_str(), "ab");
+		if (fp) {
+			fwrite(&offset, sizeof(offset), 1, fp);
+			fclose(fp);
+		}
+	}
+}
+
+bool FileSpool::Read(int64_t spoolid, char *data, int64_t n) {
+	uint32_t seg = spoolid >> SPOOL_OFFSET;
+	int64_t offset = spoolid & ((int64_t(1) << SPOOL_OFFSET) - 1);
+	spool_head head;
+	ssize_t len;
+	int fd;
+
+	if (spoolid < 0 || (fd = open(segment_path(seg, ".spl").c_str(), O_RDONLY)) < 0) return false;
+	if (pread(fd, &head, sizeof(head), offset) != ssize_t(sizeof(head)) || head.magic != SPOOL_MAGIC
+			|| n > head.lendata) {
+		close(fd);
+		return false;
+	}
+	offset += sizeof(head) + head.lenmeta;
+	while (n > 0) {
+		if ((len = pread(fd, data, n, offset)) <= 0) {
+			if (len < 0 && errno == EINTR) continue;
+			break;
+		}
+		data   += len;
+		offset += len;
+		n      -= len;
+	}
+	close(fd);
+	return n == 0;
+}
+
+bool FileSpool::Load(nfileptr ptr) {
+	boost::shared_array<char> data(new char[ptr->filesize]);
+	if (!Read(ptr->spoolid, data.get(), ptr->filesize)) return false;
+	ptr->filedata = data;
+	return true;
+}
+
+string FileSpool::segment_path(uint32_t seg, const char *ext) {
+	boost::format fmt("%08u%s");
+	fmt % seg % ext;
+	return (boost::filesystem::path(pathRoot_) / fmt.str()).string();
+}
+
+bool FileSpool::new_segment() {
+	string filepath = segment_path(segcur_, ".spl");
+	if ((fdcur_ = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		_gLog.Write(LOG_FAULT, "FileSpool::new_segment", "failed to create <%s>. %s", filepath.c_str(), strerror(errno));
+		return false;
+	}
+	offcur_ = 0;
+	return true;
+}
+
+int FileSpool::replay_segment(uint32_t seg, nfileVec &files) {
+	std::set<int64_t> committed;
+	FILE *fp;
+	int64_t offset;
+	int n(0);
+
+	if ((fp = fopen(segment_path(seg, ".cmt").c_str(), "rb"))) {
+		while (fread(&offset, sizeof(offset), 1, fp) == 1) committed.insert(offset);
+		fclose(fp);
+	}
+	if (!(fp = fopen(segment_path(seg, ".spl").c_str(), "rb"))) return 0;
+
+	spool_head head;
+	uint32_t tail;
+	string meta, line, keyword, value;
+	string::size_type pos, eq;
+	while ((offset = ftello(fp)) >= 0 && fread(&head, sizeof(head), 1, fp) == 1) {
+		if (head.magic != SPOOL_MAGIC || head.lendata < 0) break;
+		meta.resize(head.lenmeta);
+		if (fread(&meta[0], 1, head.lenmeta, fp) != head.lenmeta) break;
+		// 跳过文件数据, 仅检查结束标志. 记录不完整时尚未应答客户端, 丢弃
+		if (fseeko(fp, head.lendata, SEEK_CUR) || fread(&tail, sizeof(tail), 1, fp) != 1 || tail != SPOOL_END)
+			break;
+		if (committed.count(offset)) continue;
+
+		nfileptr ptr = boost::make_shared<FileInfo>(head.lendata, (int64_t(seg) << SPOOL_OFFSET) | offset);
+		for (pos = 0; (eq = meta.find('\n', pos)) != string::npos; pos = eq + 1) {
+			line = meta.substr(pos, eq - pos);
+			string::size_type i = line.find('=');
+			if (i == string::npos) continue;
+			keyword = line.substr(0, i);
+			value   = line.substr(i + 1);
+			if      (keyword == "gid")      ptr->gid      = value;
+			else if (keyword == "uid")      ptr->uid      = value;
+			else if (keyword == "cid")      ptr->cid      = value;
+			else if (keyword == "grid")     ptr->grid     = value;
+			else if (keyword == "field")    ptr->field    = value;
+			else if (keyword == "tmobs")    ptr->tmobs    = value;
+			else if (keyword == "subpath")  ptr->subpath  = value;
+			else if (keyword == "filename") ptr->filename = value;
+		}
+		files.push_back(ptr);
+		++n;
+	}
+	fclose(fp);
+
+	return n;
+}
+
+void FileSpool::remove_segment(uint32_t seg) {
+	boost::system::error_code ec;
+	boost::filesystem::remove(segment_path(seg, ".spl"), ec);
+	boost::filesystem::remove(segment_path(seg, ".cmt"), ec);
+}
@@ -0,0 +1,134 @@
+/*!
+ * @file FileSpool.h 预写缓存(spool)声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 在应答客户端之前, 将接收到的文件顺序追加到本地快速存储的分段日志中
+ * - 文件写入最终位置后, 在段提交记录中登记
+ * - 段内文件均已提交且段已封存时, 删除该段
+ * - 服务启动时, 重放未提交文件的元数据. 文件内容留在段中, 写盘时再读取, 积压量不受内存限制
+ * @note
+ * 段文件格式:
+ * [spool_head][元数据: keyword=value\n...][文件数据][结束标志]
+ */
+
+#ifndef FILESPOOL_H_
+#define FILESPOOL_H_
+
+#include <map>
+#include <vector>
+#include <string>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+using std::string;
+
+struct FileInfo;
+typedef boost::shared_ptr<FileInfo> nfileptr;
+
+class FileSpool {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param path    缓存目录
+	 * @param segsize 段容量, 量纲: 字节. 超出后封存当前段并创建新段
+	 * @param sync    追加后同步到磁盘
+	 */
+	FileSpool(const string &path, int64_t segsize, bool sync = true);
+	virtual ~FileSpool();
+
+public:
+	// 数据类型
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef std::vector<nfileptr> nfileVec;
+
+protected:
+	typedef std::map<uint32_t, int> segmap;	//< 段编号-未提交文件数量
+
+	struct spool_head {// 记录头
+		uint32_t magic;		//< 起始标志
+		uint32_t lenmeta;	//< 元数据长度, 量纲: 字节
+		int64_t  lendata;	//< 文件数据长度, 量纲: 字节
+	};
+
+protected:
+	// 成员变量
+	boost::mutex mtx_;	//< 互斥锁
+	string pathRoot_;	//< 缓存目录
+	int64_t segsize_;	//< 段容量, 量纲: 字节
+	bool sync_;			//< 追加后同步到磁盘
+	uint32_t segcur_;	//< 当前段编号
+	int fdcur_;			//< 当前段文件描述符
+	int64_t offcur_;	//< 当前段写入位置
+	segmap pending_;	//< 各段未提交文件数量
+
+public:
+	// 接口
+	/*!
+	 * @brief 打开缓存目录, 并读取未提交文件的元数据
+	 * @param files 未提交文件. 文件内容为空, 由Load()读取
+	 * @return
+	 * 缓存目录可用性
+	 */
+	bool Open(nfileVec &files);
+	/*!
+	 * @brief 追加文件
+	 * @param ptr 文件
+	 * @return
+	 * 操作结果. 成功时, 在ptr->spoolid中记录缓存编号
+	 */
+	bool Append(nfileptr ptr);
+	/*!
+	 * @brief 提交文件, 即文件已写入最终位置
+	 * @param spoolid 缓存编号
+	 */
+	void Commit(int64_t spoolid);
+	/*!
+	 * @brief 查看是否同步写入. 为真时, 文件写入最终位置后也应同步到磁盘再提交
+	 */
+	bool IsSync();
+	/*!
+	 * @brief 读取缓存文件的起始部分
+	 * @param spoolid 缓存编号
+	 * @param data    输出缓冲区
+	 * @param n       读取长度, 量纲: 字节. 不超过文件长度
+	 * @return
+	 * 读取成功
+	 */
+	bool Read(int64_t spoolid, char *data, int64_t n);
+	/*!
+	 * @brief 读取重放文件的内容
+	 * @param ptr 由Open()重放的文件
+	 * @return
+	 * 读取成功. 成功时ptr->filedata为文件内容
+	 */
+	bool Load(nfileptr ptr);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 生成段文件路径
+	 * @param seg 段编号
+	 * @param ext 扩展名
+	 */
+	string segment_path(uint32_t seg, const char *ext);
+	/*!
+	 * @brief 创建新段
+	 */
+	bool new_segment();
+	/*!
+	 * @brief 重放一个段中未提交的文件
+	 * @param seg   段编号
+	 * @param files 未提交文件
+	 * @return
+	 * 未提交文件数量
+	 */
+	int replay_segment(uint32_t seg, nfileVec &files);
+	/*!
+	 * @brief 删除段文件
+	 */
+	void remove_segment(uint32_t seg);
+};
+typedef boost::shared_ptr<FileSpool> FileSpoolPtr;
+
+#endif /* FILESPOOL_H_ */
@@ -4,13 +4,21 @@
  * @date 2017-10-28
  */
 
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <vector>
 #include "FileWritter.h"
 #include "GLog.h"
+#include "Checksum.h"
+
+#define SPOOL_PEEK	(2880 * 4)	//< 预写缓存重放文件读取的FITS头长度, 量纲: 字节
 
 using namespace boost;
 using namespace boost::posix_time;
@@ -21,8 +29,13 @@ FileWritePtr make_filewritter() {
 
 FileWritter::FileWritter() {
 	running_ = false;
-	ascproto_ = boost::make_shared<AsciiProtocol>();
+	dbupload_ = false;
+	dbuprate_ = 0;
+	imgtype_  = boost::make_shared<FitsHeader>("IMAGETYP");
+	quenf_    = boost::make_shared<WriteScheduler>(32 * 1024 * 1024, "OBJECT=0,FOCUS=1,FLAT=1,DARK=1,BIAS=1,UNKNOWN=1", "");
+	tmstat_   = microsec_clock::universal_time();
 	thrdmntr_.reset(new boost::thread(boost::bind(&FileWritter::thread_monitor, this)));
+	thrdpredir_.reset(new boost::thread(boost::bind(&FileWritter::thread_predir, this)));
 }
 
 FileWritter::~FileWritter() {
@@ -31,14 +44,40 @@ FileWritter::~FileWritter() {
 		thrdmntr_->join();
 		running_ = false;
 	}
-	if (quenf_.size()) {
-		_gLog.Write(LOG_WARN, "", "%d unsaved files will be lost", quenf_.size());
-		quenf_.clear();
+	if (thrdpredir_.unique()) {
+		thrdpredir_->interrupt();
+		thrdpredir_->join();
+	}
+	{// 中止流式接收, 等待写盘线程退出
+		mutex_lock lck(mtxstream_);
+		for (nfileQueue::iterator it = quens_.begin(); it != quens_.end(); ++it) (*it)->pipe->Abort();
+		while (quens_.size()) cvstream_.wait(lck);
+	}
+	if (thrdenc_.unique()) {
+		thrdenc_->interrupt();
+		thrdenc_->join();
+		if (quenc_.size()) {
+			_gLog.Write(LOG_WARN, "", "%d uncompressed files will be %s", int(quenc_.size()),
+					spool_.use_count() ? "recovered from spool" : "lost");
+			quenc_.clear();
+		}
+	}
+	if (quenf_->Size()) {
+		if (spool_.use_count())
+			_gLog.Write(LOG_WARN, "", "%d unsaved files will be recovered from spool", quenf_->Size());
+		else
+			_gLog.Write(LOG_WARN, "", "%d unsaved files will be lost", quenf_->Size());
+		quenf_->Clear();
 	}
 }
 
 void FileWritter::UpdateStorage(const char* path) {
-	pathRoot_ = path;
+	if (migrator_.use_count()) migrator_->SetTarget(path);	// 着陆盘区不变, 更换迁移目标
+	else {
+		mutex_lock lck(mtxdir_);
+		pathRoot_ = path;
+		dirs_.clear();
+	}
 	if (!pathNotify_.empty()) {
 		FILE *fp = fopen(pathNotify_.c_str(), "wt");
 		boost::posix_time::ptime t(boost::posix_time::second_clock::local_time());
@@ -48,51 +87,219 @@ void FileWritter::UpdateStorage(const char* path) {
 	_gLog.Write("LocalStorage use <%s>", path);
 }
 
-void FileWritter::SetDatabase(bool enabled, const char* url) {
-	if (!enabled) dbt_.reset();
-	else if(url) dbt_.reset(new DBCurl(url));
+void FileWritter::SetDatabase(bool enabled, const char* url, int nworker, int capacity, const char* outbox) {
+	if (!enabled) dbreg_.reset();
+	else if(url) dbreg_.reset(new DBRegister(url, nworker, capacity, outbox ? outbox : "dboutbox.txt",
+			dbref_.use_count() && dbupload_, dbuprate_));
+}
+
+void FileWritter::SetDatabaseTimeout(int connect, int total, int failmax) {
+	if (dbreg_.use_count()) dbreg_->SetTimeout(connect, total, failmax);
+}
+
+void FileWritter::SetDatabaseBatch(const char* url, int size, int window) {
+	if (dbreg_.use_count()) dbreg_->SetBatch(url ? url : "", size, window);
+}
+
+void FileWritter::SetDatabaseReference(bool byref, const char* keywords, bool upload, int64_t rate) {
+	if (!byref) dbref_.reset();
+	else dbref_ = boost::make_shared<FitsHeader>(keywords ? keywords : "");
+	dbupload_ = upload;
+	dbuprate_ = rate;
 }
 
 void FileWritter::SetNotifyPath(bool enabled, const char* filepath) {
 	pathNotify_ = enabled ? filepath : "";
 }
 
+void FileWritter::SetSpool(bool enabled, const char* path, int64_t segsize, bool sync) {
+	spool_.reset();
+	respool_.clear();
+	if (!enabled || !path) return;
+
+	FileSpool::nfileVec files;
+	FileSpoolPtr spool = boost::make_shared<FileSpool>(path, segsize, sync);
+	if (spool->Open(files)) {
+		// 仅读取FITS头, 用于按图像类型调度. 文件内容在写盘时读取
+		boost::scoped_array<char> head(new char[SPOOL_PEEK]);
+		for (FileSpool::nfileVec::iterator it = files.begin(); it != files.end(); ++it) {
+			int64_t n = (*it)->filesize < SPOOL_PEEK ? (*it)->filesize : SPOOL_PEEK;
+			if (spool->Read((*it)->spoolid, head.get(), n)) imgtype_->Parse(head.get(), n, (*it)->keywords);
+		}
+		mutex_lock lck(mtxfile_);
+		spool_ = spool;
+		respool_.swap(files);
+	}
+}
+
+void FileWritter::ReplaySpool() {
+	mutex_lock lck(mtxfile_);
+	for (FileSpool::nfileVec::iterator it = respool_.begin(); it != respool_.end(); ++it)
+		quenf_->Push(*it, image_type_of(*it));
+	if (respool_.size()) {
+		_gLog.Write("replays %lu files from spool", respool_.size());
+		cvfile_.notify_one();
+	}
+	respool_.clear();
+}
+
+void FileWritter::SetScheduler(int64_t quantum, const char* priority, const char* weights) {
+	WriteSchedPtr sched = boost::make_shared<WriteScheduler>(quantum, priority ? priority : "", weights ? weights : "");
+	mutex_lock lck(mtxfile_);
+	nfileptr ptr;
+
+	while ((ptr = quenf_->Front()).use_count()) {
+		quenf_->Pop();
+		sched->Push(ptr, image_type_of(ptr));
+	}
+	quenf_ = sched;
+}
+
 void FileWritter::NewFile(nfileptr nfptr) {
 	if (running_) {
-		quenf_.push_back(nfptr);
-		cvfile_.notify_one();
+		// 应答客户端前写入预写缓存
+		if (spool_.use_count() && !nfptr->stored && nfptr->spoolid < 0 && !spool_->Append(nfptr))
+			_gLog.Write(LOG_WARN, "FileWritter::NewFile", "<%s> is queued without spool", nfptr->filename.c_str());
+		if (!nfptr->codec.empty() && nfptr->filedata.get()) {// 客户端已压缩: 关键字位于压缩图像扩展头
+			parse_header(nfptr->filedata.get(), nfptr->filesize, nfptr->keywords);
+			enqueue(nfptr);
+		}
+		else if (compress_.use_count() && !nfptr->stored && nfptr->filedata.get()) {
+			// 压缩前提取关键字: 压缩后的主头不含原关键字
+			parse_header(nfptr->filedata.get(), nfptr->filesize, nfptr->keywords);
+			mutex_lock lck(mtxenc_);
+			quenc_.push_back(nfptr);
+			cvenc_.notify_one();
+		}
+		else enqueue(nfptr);
+	}
+	else {
+		if (spool_.use_count() && nfptr->spoolid < 0 && !nfptr->stored && spool_->Append(nfptr))
+			_gLog.Write(LOG_WARN, NULL, "spools <%s> for FileWritter terminated", nfptr->filename.c_str());
+		else
+			_gLog.Write(LOG_WARN, NULL, "rejects new file for FileWritter terminated");
+	}
+}
+
+void FileWritter::enqueue(nfileptr nfptr) {
+	IMAGE_TYPE imgtype = image_type_of(nfptr);
+	mutex_lock lck(mtxfile_);
+	quenf_->Push(nfptr, imgtype);
+	cvfile_.notify_one();
+}
+
+void FileWritter::NewStream(nfileptr nfptr) {
+	if (running_) {
+		// 各流式文件由独立线程写盘: 一个客户端停滞不阻塞其它文件
+		mutex_lock lck(mtxstream_);
+		quens_.push_back(nfptr);
+		boost::thread(boost::bind(&FileWritter::thread_stream, this, nfptr)).detach();
+	}
+	else {
+		_gLog.Write(LOG_WARN, NULL, "rejects new stream for FileWritter terminated");
+		nfptr->pipe->Abort();
 	}
+}
+
+void FileWritter::SetPublisher(DataPubPtr dppub, ShmPubPtr shmpub) {
+	dppub_  = dppub;
+	shmpub_ = shmpub;
+}
+
+void FileWritter::SetFrameCache(FrameCachePtr cache) {
+	cache_ = cache;
+}
+
+void FileWritter::SetReclaimer(ReclaimerPtr reclaim) {
+	reclaim_ = reclaim;
+}
+
+void FileWritter::SetFileIndex(FileIndexPtr index) {
+	index_ = index;
+}
+
+void FileWritter::SetForecast(ForecastPtr forecast) {
+	forecast_ = forecast;
+}
+
+void FileWritter::SetMigrator(MigratorPtr migrator) {
+	mutex_lock lck(mtxdir_);
+	migrator_ = migrator;
+	migrator_->SetTarget(pathRoot_);
+	pathRoot_ = migrator_->Landing();
+	dirs_.clear();
+	lck.unlock();
+	_gLog.Write("LocalStorage lands on <%s>", pathRoot_.c_str());
+}
+
+void FileWritter::SetCompressor(bool enabled, int nworker) {
+	if (!enabled || compress_.use_count()) return;
+	compress_ = boost::make_shared<TileCompressor>(nworker);
+	thrdenc_.reset(new boost::thread(boost::bind(&FileWritter::thread_compress, this)));
+	_gLog.Write("LocalStorage compresses images with %d threads", nworker);
+}
+
+bool FileWritter::StoresCompressed() {
+	return compress_.use_count();
+}
+
+void FileWritter::SetMetadata(bool enabled, const char* keywords) {
+	if (!enabled || !keywords) meta_.reset();
 	else {
-		_gLog.Write(LOG_WARN, NULL, "rejects new file for FileWritter terminated");
+		meta_ = boost::make_shared<FitsHeader>(keywords);
+		if (meta_->Empty()) meta_.reset();
 	}
 }
 
-void FileWritter::CoupleNetwork(const TcpCPtr tcpc) {
-	tcpc_dp_ = tcpc;
+void FileWritter::ForgetDirectory(const string &path) {
+	namespace fs = boost::filesystem;
+	mutex_lock lck(mtxdir_);
+	string prefix = path;
+
+	if (prefix.back() != '/') prefix += "/";
+	for (dirset::iterator it = dirs_.begin(); it != dirs_.end(); ) {
+		string fullpath = (fs::path(it->first) / it->second).string() + "/";
+		if (fullpath.compare(0, prefix.size(), prefix) == 0) it = dirs_.erase(it);
+		else ++it;
+	}
 }
 
-void FileWritter::DecoupleNetowrk() {
-	tcpc_dp_.reset();
+void FileWritter::FileMoved(const FileIndex::entry &x, const string &root, const string &container) {
+	namespace fs = boost::filesystem;
+	if (!dbreg_.unique()) return;
+
+	fs::path oldpath = fs::path(x.root) / x.relpath;
+	if (container.empty()) {
+		dbreg_->RegImageMove(x.cid, oldpath.filename().string(), oldpath.parent_path().string(),
+				(fs::path(root) / x.relpath).parent_path().string());
+	}
+	else {
+		fs::path pathpack = fs::path(root) / container;
+		dbreg_->RegImageMove(x.cid, oldpath.filename().string(), oldpath.parent_path().string(),
+				pathpack.parent_path().string(), pathpack.string());
+	}
 }
 
 void FileWritter::thread_monitor() {
-	boost::mutex dummy;
-	mutex_lock lck(dummy);
 	bool rslt(true);
 	int errcnt(0);
 	boost::chrono::minutes period(1); // 异常等待延时1分钟
 
 	running_ = true;
 	while(errcnt < 5) {
-		if (!quenf_.size()) // 队列空时, 等待新的文件
+		mutex_lock lck(mtxfile_);
+		while (quenf_->Empty()) // 队列空时, 等待新的文件
 			cvfile_.wait(lck);
-		else if (!rslt) { // 文件存储失败, 计数加1, 延时等待1分钟
+		lck.unlock();
+
+		if (!rslt) { // 文件存储失败, 计数加1, 延时等待1分钟
 			++errcnt;
 			boost::this_thread::sleep_for(period);
 		}
 		else if (errcnt) // 存储成功, 清除计数
 			errcnt = 0;
 		rslt = save_first();
+		if ((microsec_clock::universal_time() - tmstat_).total_seconds() >= 60) log_schedule();
 	}
 	running_ = false;
 	_gLog.Write(LOG_FAULT, NULL, "FileWritter terminated due to too much error");
@@ -100,53 +307,336 @@ void FileWritter::thread_monitor() {
 
 bool FileWritter::save_first() {
 	namespace fs = boost::filesystem;
-	fs::path filepath = pathRoot_;	// 文件路径
-	nfileptr ptr = quenf_.front();
+	mutex_lock lckdir(mtxdir_);
+	string root = pathRoot_;		// 根路径. 可能由容量预测更换
+	lckdir.unlock();
+	mutex_lock lck(mtxfile_);
+	nfileptr ptr = quenf_->Front();
 	bool rslt(false);
+	lck.unlock();
+	if (ptr->stored && ptr->root.size()) root = ptr->root;	// 流式接收文件已写入该根路径
+	fs::path filepath = root;	// 文件路径
+	// 预写缓存重放的文件: 此时读取内容, 启动时不占用内存
+	if (!ptr->stored && !ptr->filedata && spool_.use_count() && !spool_->Load(ptr)) {
+		_gLog.Write(LOG_FAULT, "FileWritter::save_first", "failed to read <%s> from spool, kept for recovery",
+				ptr->filename.c_str());
+		lck.lock();
+		quenf_->Pop();
+		return true;
+	}
+	string relpath = (fs::path(ptr->subpath) / ptr->filename).string();	// 相对根路径的文件路径
 
 	filepath /= ptr->subpath;
-	ptr->subpath = filepath.string();
-	if (!fs::is_directory(filepath) && !fs::create_directory(filepath)) {
+	if (!check_directory(root, ptr->subpath, filepath)) {
 		_gLog.Write(LOG_FAULT, "FileWritter::OnNewFile", "failed to create directory<%s>", filepath.c_str());
 	}
 	else {
-		FILE *fp;
+		FILE *fp(NULL);
+		int err(0);
 
 		filepath /= ptr->filename;
-		if (NULL != (fp = fopen(filepath.c_str(), "wb"))) {
-			fwrite(ptr->filedata.get(), 1, ptr->filesize, fp);
-			fclose(fp);
+		// 文件仍在内存中时提取关键字. 流式接收文件已从首块提取
+		if (ptr->filedata && (dbref_.use_count() || meta_.use_count()))
+			parse_header(ptr->filedata.get(), ptr->filesize, ptr->keywords);
+		if (!ptr->stored && NULL == (fp = fopen(filepath.c_str(), "wb"))) {
+			_gLog.Write(LOG_FAULT, "FileWritter::save_first", "failed to create file<%s>. %s",
+					filepath.c_str(), strerror(errno));
+		}
+		else if (!ptr->stored && (err = write_file(fp, ptr))) {
+			// 文件保留在队列中, 预写缓存记录保持未提交, 稍后重试
+			_gLog.Write(LOG_FAULT, "FileWritter::save_first", "failed to write file<%s>. %s",
+					filepath.c_str(), strerror(err));
+			boost::system::error_code ec;
+			fs::remove(filepath, ec);
+		}
+		else {
+			ptr->subpath = filepath.parent_path().string();
+			// 接收时已增量计算; 仅预写缓存恢复的文件需要计算
+			if (ptr->checksum.empty() && ptr->filedata)
+				ptr->checksum = crc32c_string(crc32c_update(0, ptr->filedata.get(), ptr->filesize));
 
-			if (dbt_.unique()) {
+			if (dbreg_.unique()) {// 提交注册信息, 由注册线程异步完成
 				ptime tmobs = from_iso_extended_string(ptr->tmobs) + hours(8);
 				ptime::time_duration_type tdt = tmobs.time_of_day();
 				ptime tmutc(tmobs.date(), hours(tdt.hours()) + minutes(tdt.minutes()) + seconds(tdt.seconds()));
 
-				dbt_->RegImageFile(ptr->cid, ptr->filename, filepath.parent_path().string(),
-						to_iso_string(tmutc), tdt.fractional_seconds());
+				if (!dbref_.use_count()) {
+					dbreg_->RegImageFile(ptr->cid, ptr->filename, filepath.parent_path().string(),
+							to_iso_string(tmutc), tdt.fractional_seconds(), ptr->filedata, ptr->filesize, ptr->checksum,
+							meta_.use_count() ? ptr->keywords : fitskeys());
+				}
+				else {// 按引用注册
+					dbreg_->RegImageRef(ptr->cid, ptr->filename, filepath.parent_path().string(),
+							to_iso_string(tmutc), tdt.fractional_seconds(), ptr->filesize, ptr->checksum, ptr->keywords);
+				}
 			}
-			quenf_.pop_front();
+			if (spool_.use_count()) spool_->Commit(ptr->spoolid);
+			if (index_.use_count()) {
+				string keywords;
+				if (meta_.use_count()) {
+					for (fitskeys::iterator it = ptr->keywords.begin(); it != ptr->keywords.end(); ++it) {
+						string value = it->second;
+						std::replace_if(value.begin(), value.end(), boost::is_any_of("\t\r\n"), ' ');
+						if (!keywords.empty()) keywords += "\t";
+						keywords += it->first + "=" + value;
+					}
+				}
+				index_->Add(root, relpath, ptr->filesize, ptr->cid, ptr->tmobs, ptr->checksum, keywords);
+			}
+			if (reclaim_.use_count()) reclaim_->Written(ptr->filesize);
+			if (forecast_.use_count()) forecast_->Written(root, ptr->cid, ptr->filesize);
+			if (migrator_.use_count()) migrator_->Written(ptr->filesize);
+			lck.lock();
+			quenf_->Pop();
+			lck.unlock();
 			rslt = true;
 
 			_gLog.Write("Received: %s", ptr->filename.c_str());
 
-			if (tcpc_dp_.use_count()) {// 通知数据处理已经接收到新的文件
-				int n;
+			if (cache_.use_count() && ptr->filedata.get()) cache_->Put(ptr->cid, ptr->filename, ptr->filedata, ptr->filesize);
+			bool tcp = dppub_.use_count() && dppub_->Count();
+			if (tcp || shmpub_.use_count()) {// 通知数据处理已经接收到新的文件
 				apfileinfo proto = boost::make_shared<ascii_proto_fileinfo>();
 				proto->gid = ptr->gid;
 				proto->uid = ptr->uid;
 				proto->cid = ptr->cid;
+				proto->tmobs = ptr->tmobs;
 				proto->subpath = ptr->subpath;
 				proto->filename = ptr->filename;
-				const char *s = ascproto_->CompactFileInfo(proto, n);
-				tcpc_dp_->Write(s, n);
+				proto->filesize = ptr->filesize;
+				if (meta_.use_count()) proto->keywords = ptr->keywords;
+				fitskeys::iterator it = ptr->keywords.find("IMAGETYP");
+				if (it == ptr->keywords.end() && ptr->filedata.get()
+						&& (shmpub_.use_count() || dppub_->WantImageType())) {
+					imgtype_->Parse(ptr->filedata.get(), ptr->filesize, ptr->keywords);
+					it = ptr->keywords.find("IMAGETYP");
+				}
+				const string &imgtype = it == ptr->keywords.end() ? string() : it->second;
+				if (shmpub_.use_count()) shmpub_->Publish(proto, imgtype);
+				if (tcp) dppub_->Publish(proto, imgtype);
 			}
 		}
-		else {
-			_gLog.Write(LOG_FAULT, "FileWritter::save_first", "failed to create file<%s>. %s",
+	}
+
+	return rslt;
+}
+
+int FileWritter::write_file(FILE *fp, nfileptr ptr) {
+	int err(0);
+
+	errno = 0;
+	if (fwrite(ptr->filedata.get(), 1, ptr->filesize, fp) != size_t(ptr->filesize)) err = errno ? errno : EIO;
+	else if (fflush(fp)) err = errno;
+	// 预写缓存同步写入时, 最终文件落盘后才能提交缓存记录
+	else if (spool_.use_count() && ptr->spoolid >= 0 && spool_->IsSync() && fdatasync(fileno(fp))) err = errno;
+	if (fclose(fp) && !err) err = errno;
+	return err;
+}
+
+void FileWritter::thread_stream(nfileptr ptr) {
+	save_stream(ptr);
+
+	mutex_lock lck(mtxstream_);
+	quens_.erase(std::find(quens_.begin(), quens_.end(), ptr));
+	cvstream_.notify_all();
+}
+
+void FileWritter::save_stream(nfileptr ptr) {
+	namespace fs = boost::filesystem;
+	mutex_lock lck(mtxdir_);
+	ptr->root = pathRoot_;
+	lck.unlock();
+	fs::path filepath = ptr->root;
+	ChunkPipe::chunk x;
+	int64_t nwrite(0);
+	FILE *fp(NULL);
+
+	filepath /= ptr->subpath;
+	if (!check_directory(ptr->root, ptr->subpath, filepath)) {
+		_gLog.Write(LOG_FAULT, "FileWritter::save_stream", "failed to create directory<%s>", filepath.c_str());
+	}
+	else {
+		filepath /= ptr->filename;
+		if (NULL == (fp = fopen(filepath.c_str(), "wb"))) {
+			_gLog.Write(LOG_FAULT, "FileWritter::save_stream", "failed to create file<%s>. %s",
 					filepath.c_str(), strerror(errno));
 		}
 	}
+	if (!fp) {
+		ptr->pipe->Abort();
+		return;
+	}
 
-	return rslt;
+	while (ptr->pipe->Pop(x)) {
+		if (fwrite(x.data.get(), 1, x.size, fp) != size_t(x.size)) {
+			_gLog.Write(LOG_FAULT, "FileWritter::save_stream", "failed to write file<%s>. %s",
+					filepath.c_str(), strerror(errno));
+			ptr->pipe->Abort();
+			break;
+		}
+		if (nwrite == 0) parse_header(x.data.get(), x.size, ptr->keywords);	// 从首块提取关键字
+		nwrite += x.size;
+		x.data.reset();
+	}
+	// 关闭时写出缓冲区数据, 失败则文件不完整
+	if (fclose(fp) && !ptr->pipe->IsAborted()) {
+		_gLog.Write(LOG_FAULT, "FileWritter::save_stream", "failed to close file<%s>. %s",
+				filepath.c_str(), strerror(errno));
+		ptr->pipe->Abort();
+	}
+
+	// 校验和由接收线程随数据到达计算. 校验失败时管道已中止
+	if (nwrite != ptr->filesize || ptr->pipe->IsAborted()) {
+		boost::system::error_code ec;
+		_gLog.Write(LOG_WARN, "FileWritter::save_stream", "discards <%s> for %lld of %lld bytes written",
+				filepath.c_str(), (long long) nwrite, (long long) ptr->filesize);
+		if (!fs::remove(filepath, ec) && ec)
+			_gLog.Write(LOG_WARN, "FileWritter::save_stream", "failed to remove <%s>. %s",
+					filepath.c_str(), ec.message().c_str());
+	}
+	else {// 完成写盘, 进入常规队列完成注册与通知
+		ptr->stored = true;
+		NewFile(ptr);
+	}
+}
+
+void FileWritter::thread_compress() {
+	boost::posix_time::ptime tmlog = microsec_clock::universal_time();
+	boost::shared_array<char> data;
+	int64_t size;
+	nfileptr ptr;
+
+	while(1) {
+		mutex_lock lck(mtxenc_);
+		while (quenc_.empty()) cvenc_.wait(lck);
+		ptr = quenc_.front();
+		lck.unlock();
+
+		if (compress_->Compress(ptr->cid, ptr->filedata.get(), ptr->filesize, data, size)) {
+			ptr->filedata = data;
+			ptr->filesize = size;
+			ptr->checksum = crc32c_string(crc32c_update(0, data.get(), size));	// 写盘内容已改变
+			data.reset();
+		}
+		enqueue(ptr);
+
+		lck.lock();
+		quenc_.pop_front();
+		lck.unlock();
+		ptr.reset();
+		if ((microsec_clock::universal_time() - tmlog).total_seconds() >= 600) {
+			log_compress();
+			tmlog = microsec_clock::universal_time();
+		}
+	}
+}
+
+IMAGE_TYPE FileWritter::image_type_of(nfileptr ptr) {
+	fitskeys::iterator it = ptr->keywords.find("IMAGETYP");
+	if (it == ptr->keywords.end() && ptr->filedata.get()) {
+		imgtype_->Parse(ptr->filedata.get(), ptr->filesize, ptr->keywords);
+		it = ptr->keywords.find("IMAGETYP");
+	}
+	return it == ptr->keywords.end() ? IMGTYPE_ERROR : image_type(it->second);
+}
+
+void FileWritter::parse_header(const char *data, int64_t n, fitskeys &kvs) {
+	const char *hdr = TileCompressor::ImageHeader(data, n);
+
+	n -= hdr - data;
+	imgtype_->Parse(hdr, n, kvs);
+	if (dbref_.use_count()) dbref_->Parse(hdr, n, kvs);
+	if (meta_.use_count())  meta_->Parse(hdr, n, kvs);
+}
+
+void FileWritter::log_schedule() {
+	WriteScheduler::statVec stats;
+	string text;
+	mutex_lock lck(mtxfile_);
+	quenf_->Stats(stats);
+	tmstat_ = microsec_clock::universal_time();
+	lck.unlock();
+
+	for (WriteScheduler::statVec::iterator it = stats.begin(); it != stats.end(); ++it) {
+		if (!(it->count || it->queued)) continue;
+		text += str(format("; level %d: %lld saved, %d queued, delay avg %.1f ms max %.1f ms")
+				% it->level % (long long) it->count % it->queued % it->avgdelay % it->maxdelay);
+	}
+	if (!text.empty()) _gLog.Write("write queue%s", text.c_str());
+}
+
+void FileWritter::log_compress() {
+	TileCompressor::statVec stats;
+	compress_->Stats(stats);
+
+	for (TileCompressor::statVec::iterator it = stats.begin(); it != stats.end(); ++it) {
+		_gLog.Write("compress <%s>: %lld files, %lld raw, ratio %.2f, cpu %.1f ms/file", it->cid.c_str(),
+				(long long) it->nfile, (long long) it->nraw,
+				it->bytesout ? double(it->bytesin) / it->bytesout : 1.0, it->cpu * 1000.0 / it->nfile);
+	}
+}
+
+bool FileWritter::check_directory(const string &root, const string &subpath, const boost::filesystem::path &path) {
+	namespace fs = boost::filesystem;
+	mutex_lock lck(mtxdir_);
+	dirkey key(root, subpath);
+
+	if (dirs_.find(key) != dirs_.end()) return true;
+
+	boost::system::error_code ec;
+	if (!fs::is_directory(path, ec) && !fs::create_directory(path, ec)) return false;
+	dirs_.insert(key);
+	return true;
+}
+
+void FileWritter::thread_predir() {
+	namespace fs = boost::filesystem;
+	boost::chrono::minutes period(30);
+	boost::system::error_code ec;
+	std::vector<dirkey> todo;
+	string next;
+
+	while(1) {
+		boost::this_thread::sleep_for(period);
+
+		todo.clear();
+		mutex_lock lck(mtxdir_);
+		for (dirset::iterator it = dirs_.begin(); it != dirs_.end(); ++it) {
+			if (it->first == pathRoot_ && next_subpath(it->second, next)
+					&& dirs_.find(dirkey(it->first, next)) == dirs_.end())
+				todo.push_back(dirkey(it->first, next));
+		}
+		lck.unlock();
+
+		for (std::vector<dirkey>::iterator it = todo.begin(); it != todo.end(); ++it) {
+			fs::path path = fs::path(it->first) / it->second;
+			if (fs::is_directory(path, ec) || fs::create_directory(path, ec)) {
+				lck.lock();
+				if (it->first == pathRoot_) dirs_.insert(*it);
+				lck.unlock();
+			}
+		}
+	}
+}
+
+bool FileWritter::next_subpath(const string &subpath, string &next) {
+	namespace gd = boost::gregorian;
+	string::size_type pos = subpath.rfind('_');
+	if (pos == string::npos || subpath.size() - pos != 7) return false;
+
+	string ymd = subpath.substr(pos + 1);
+	if (ymd.find_first_not_of("0123456789") != string::npos) return false;
+
+	int val = stoi(ymd);
+	try {
+		gd::date date(val / 10000 + 2000, val / 100 % 100, val % 100);
+		date += gd::days(1);
+		boost::format fmt("%s%02d%02d%02d");
+		fmt % subpath.substr(0, pos + 1) % (date.year() - 2000) % date.month().as_number() % date.day().as_number();
+		next = fmt.str();
+		return true;
+	}
+	catch(std::out_of_range &ex) {
+		return false;
+	}
 }
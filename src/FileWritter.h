@@ -5,7 +5,7 @@
  * @note
  * - 缓存待写盘文件
  * - 创建子目录
- * - 串行写盘
+ * - 串行写盘, 按相机公平调度
  * - 维护日志
  * - 维护资源
  */
@@ -14,12 +14,26 @@
 #define FILEWRITTER_H_
 
 #include <boost/container/deque.hpp>
+#include <boost/filesystem/path.hpp>
 #include <string.h>
 #include <string>
+#include <set>
 #include "MessageQueue.h"
-#include "DBCurl.h"
+#include "DBRegister.h"
 #include "tcpasio.h"
 #include "AsciiProtocol.h"
+#include "BufferPool.h"
+#include "ChunkPipe.h"
+#include "FileSpool.h"
+#include "FitsHeader.h"
+#include "DataPublisher.h"
+#include "ShmPublisher.h"
+#include "WriteScheduler.h"
+#include "StorageReclaimer.h"
+#include "CapacityForecast.h"
+#include "TierMigrator.h"
+#include "TileCompressor.h"
+#include "Checksum.h"
 
 using std::string;
 
@@ -33,15 +47,61 @@ struct FileInfo {// 待写盘文件信息
 	string tmobs;	//< 观测时间
 	string subpath;	//< 子目录名称
 	string filename;	//< 文件名称
-	int filesize;	//< 文件大小, 量纲: 字节
-	int rcvsize;		//< 已接收文件大小, 量纲: 字节
-	boost::shared_array<char> filedata;	//< 文件内容
+	int64_t filesize;	//< 文件大小, 量纲: 字节
+	int64_t rcvsize;		//< 已接收文件大小, 量纲: 字节
+	uint32_t crc;		//< 已接收数据的CRC32C, 随数据到达增量计算
+	boost::shared_array<char> filedata;	//< 文件内容. 流式接收时为空
+	ChunkPipePtr pipe;	//< 流式接收管道
+	bool stored;		//< 文件内容已写入磁盘
+	int64_t spoolid;	//< 预写缓存编号. <0: 未缓存
+	string checksum;	//< 写盘内容的校验和. 为空时未计算
+	fitskeys keywords;	//< 从FITS头中提取的关键字
+	string codec;		//< 文件内容的压缩算法. 为空时为原始数据
+	string root;		//< 流式接收文件写盘时的根路径
 
 public:
-	FileInfo(const int _filesize) {
+	/*!
+	 * @brief 构造函数, 在内存中缓存完整文件
+	 * @param _filesize 文件大小, 量纲: 字节
+	 * @param pool      缓冲区池. 为空时从堆中分配缓冲区
+	 */
+	FileInfo(const int64_t _filesize, BufPoolPtr pool = BufPoolPtr()) {
+		filesize = _filesize;
+		rcvsize  = 0;
+		crc      = 0;
+		stored   = false;
+		spoolid  = -1;
+		if (pool.use_count()) filedata = pool->Alloc(filesize);
+		else filedata.reset(new char[filesize]);
+	}
+
+	/*!
+	 * @brief 构造函数, 以数据块流式接收文件
+	 * @param _filesize 文件大小, 量纲: 字节
+	 * @param chunksize 数据块长度, 量纲: 字节
+	 * @param depth     管道深度
+	 * @param pool      缓冲区池
+	 */
+	FileInfo(const int64_t _filesize, int chunksize, int depth, BufPoolPtr pool) {
 		filesize = _filesize;
 		rcvsize  = 0;
-		filedata.reset(new char[filesize]);
+		crc      = 0;
+		stored   = false;
+		spoolid  = -1;
+		pipe     = boost::make_shared<ChunkPipe>(chunksize, depth, pool);
+	}
+
+	/*!
+	 * @brief 构造函数, 文件内容保留在预写缓存中, 写盘时读取
+	 * @param _filesize 文件大小, 量纲: 字节
+	 * @param _spoolid  预写缓存编号
+	 */
+	FileInfo(const int64_t _filesize, const int64_t _spoolid) {
+		filesize = _filesize;
+		rcvsize  = _filesize;
+		crc      = 0;
+		stored   = false;
+		spoolid  = _spoolid;
 	}
 
 	/*!
@@ -49,10 +109,19 @@ public:
 	 * @param data 新到达数据指针
 	 * @param n    新到达数据长度, 量纲: 字节
 	 * @return
-	 * 文件接收完成
+	 * 文件接收完成或流式接收管道已中止
+	 * @note
+	 * 超出文件大小的数据被丢弃, 仍计入rcvsize, 由接收方判定为错误
 	 */
 	bool DataArrive(const char *data, const int n) {
-		memcpy(filedata.get() + rcvsize, data, n);
+		int m = filesize - rcvsize < n ? int(filesize - rcvsize) : n;
+		if (m > 0) {
+			if (pipe.use_count()) {
+				if (!pipe->Push(data, m)) return true;	// 写盘端中止或停滞: 结束接收, 由接收方判定为错误
+			}
+			else memcpy(filedata.get() + rcvsize, data, m);
+			crc = crc32c_update(crc, data, m);
+		}
 		rcvsize += n;
 		return (rcvsize >= filesize);
 	}
@@ -69,19 +138,46 @@ protected:
 	typedef boost::shared_ptr<boost::thread> threadptr;
 	typedef boost::unique_lock<boost::mutex> mutex_lock;
 	typedef boost::container::deque<nfileptr> nfileQueue;
+	typedef std::pair<string, string> dirkey;	//< 目录关键字: 根路径+子目录
+	typedef std::set<dirkey> dirset;	//< 已创建目录集合
 
 protected:
 	// 成员变量
 	string pathRoot_;	//< 当前根路径
-	nfileQueue quenf_;	//< 文件队列
-	boost::shared_ptr<DBCurl> dbt_;	//< 数据库访问接口
+	WriteSchedPtr quenf_;	//< 文件队列, 按图像类型优先级与相机份额调度
+	boost::posix_time::ptime tmstat_;	//< 上次输出排队统计的时间
+	boost::mutex mtxfile_;	//< 互斥锁: 文件队列
+	nfileQueue quens_;	//< 正在写盘的流式接收文件. 每个文件由独立线程写盘
+	boost::mutex mtxstream_;	//< 互斥锁: 正在写盘的流式接收文件
+	boost::condition_variable cvstream_;	//< 条件变量: 流式接收文件完成写盘
+	FileSpoolPtr spool_;	//< 预写缓存
+	FileSpool::nfileVec respool_;	//< 预写缓存中等待重放的文件
+	DBRegPtr dbreg_;	//< 数据库注册接口
+	FitsHeaderPtr dbref_;	//< 按引用注册时提取的FITS关键字. 为空时随注册上传文件
+	bool dbupload_;		//< 按引用注册后在后台上传文件
+	int64_t dbuprate_;	//< 后台上传速率上限, 量纲: 字节/秒
 	boost::condition_variable cvfile_;	//< 条件变量: 新的数据需要存储
 	threadptr thrdmntr_;		//< 监测线程
+	threadptr thrdpredir_;	//< 线程: 预创建下一观测夜目录
+	boost::mutex mtxdir_;	//< 互斥锁: 目录缓存
+	dirset dirs_;			//< 已确认存在的目录
 	bool running_;	//< 运行标志
 	string pathNotify_;	//< 当改变存储路径时, 在文件中记录该变更
 
-	TcpCPtr tcpc_dp_;	//< 网络连接: 数据处理
-	AscProtoPtr ascproto_;	//< 通信协议封装接口
+	DataPubPtr dppub_;	//< 新文件通知发布器: 数据处理
+	ShmPubPtr shmpub_;	//< 新文件通知发布器: 同机数据处理, 共享内存
+	FrameCachePtr cache_;	//< 最近写盘帧的内存缓存, 供数据处理读取
+	FitsHeaderPtr imgtype_;	//< 按图像类型过滤通知时, 提取FITS关键字IMAGETYP
+	ReclaimerPtr reclaim_;	//< 存储空间回收, 由写盘字节数驱动
+	FileIndexPtr index_;	//< 已存储文件索引
+	ForecastPtr forecast_;	//< 存储容量预测
+	MigratorPtr migrator_;	//< 分层存储迁移. 启用时写入着陆盘区
+	CompressorPtr compress_;	//< 分块无损压缩
+	nfileQueue quenc_;		//< 待压缩文件队列
+	boost::mutex mtxenc_;	//< 互斥锁: 待压缩文件队列
+	boost::condition_variable cvenc_;	//< 条件变量: 新的待压缩文件
+	threadptr thrdenc_;		//< 线程: 压缩文件
+	FitsHeaderPtr meta_;	//< 写盘时提取的FITS关键字, 随索引、注册与通知发送. 为空时不提取
 
 public:
 	// 接口
@@ -92,29 +188,147 @@ public:
 	void UpdateStorage(const char* path);
 	/*!
 	 * @brief 设置数据库
-	 * @param enabled 启用数据库
-	 * @param url     URL地址
+	 * @param enabled  启用数据库
+	 * @param url      URL地址
+	 * @param nworker  注册线程数量
+	 * @param capacity 注册队列容量
+	 * @param outbox   注册发件箱文件路径
+	 */
+	void SetDatabase(bool enabled = false, const char* url = NULL, int nworker = 2, int capacity = 1000,
+			const char* outbox = NULL);
+	/*!
+	 * @brief 设置数据库超时与熔断阈值
+	 * @param connect   连接超时, 量纲: 毫秒
+	 * @param total     总超时, 量纲: 毫秒
+	 * @param failmax   熔断阈值: 连续失败次数
+	 */
+	void SetDatabaseTimeout(int connect, int total, int failmax);
+	/*!
+	 * @brief 设置数据库批量注册
+	 * @param url     批量注册URL地址. 为空时使用默认地址
+	 * @param size    单次批量注册的最大记录数. 不大于1时逐条注册
+	 * @param window  累积注册记录的最长时间, 量纲: 毫秒
+	 */
+	void SetDatabaseBatch(const char* url, int size, int window);
+	/*!
+	 * @brief 设置数据库按引用注册
+	 * @param byref     按引用注册: 仅发送路径、大小、校验和及FITS关键字, 不上传文件
+	 * @param keywords  提取的FITS关键字, 以逗号分隔
+	 * @param upload    按引用注册后, 在后台限速上传文件
+	 * @param rate      后台上传速率上限, 量纲: 字节/秒
+	 * @note
+	 * 在SetDatabase()之前调用
 	 */
-	void SetDatabase(bool enabled = false, const char* url = NULL);
+	void SetDatabaseReference(bool byref, const char* keywords, bool upload, int64_t rate);
 	/*!
 	 * @brief 设置文件存储盘区变更文件路径
 	 * @param enabled   启用通知功能
 	 * @param filepath  通知文件路径
 	 */
 	void SetNotifyPath(bool enabled = false, const char* filepath = NULL);
+	/*!
+	 * @brief 设置预写缓存, 并读取缓存中未写盘的文件
+	 * @param enabled  启用预写缓存
+	 * @param path     缓存目录
+	 * @param segsize  段容量, 量纲: 字节
+	 * @param sync     追加后同步到磁盘
+	 * @note
+	 * 未写盘的文件由ReplaySpool()提交写盘
+	 */
+	void SetSpool(bool enabled = false, const char* path = NULL, int64_t segsize = 0, bool sync = true);
+	/*!
+	 * @brief 将预写缓存中未写盘的文件提交写盘
+	 * @note
+	 * 在SetPublisher()、SetFrameCache()、SetReclaimer()等设置完成后调用. 重放文件与新文件同样发布通知、
+	 * 进入帧缓存并累计回收字节数
+	 */
+	void ReplaySpool();
+	/*!
+	 * @brief 设置写盘调度
+	 * @param quantum  每台相机每轮写盘份额, 量纲: 字节
+	 * @param priority 图像类型的优先级, 格式: TYPE=级别[,...]. 级别0最高
+	 * @param weights  相机权重, 格式: gid:uid:cid=权重[,...]
+	 * @note
+	 * 在ReplaySpool()之前调用
+	 */
+	void SetScheduler(int64_t quantum, const char* priority, const char* weights);
 	/*!
 	 * @brief 通知有新的文件等待存储
 	 * @param nfptr 待保存文件
 	 */
 	void NewFile(nfileptr nfptr);
 	/*!
-	 * @brief 建立与网络连接的关联
+	 * @brief 通知有新的文件开始流式接收
+	 * @param nfptr 待保存文件
+	 * @note
+	 * 文件数据经管道逐块写盘. 写盘完成后, 文件进入常规队列完成注册与通知
+	 */
+	void NewStream(nfileptr nfptr);
+	/*!
+	 * @brief 设置新文件通知发布器
+	 * @param dppub  发布器. 写盘完成后向数据处理订阅者发布通知
+	 * @param shmpub 共享内存发布器. 为空时不启用
 	 */
-	void CoupleNetwork(const TcpCPtr tcpc);
+	void SetPublisher(DataPubPtr dppub, ShmPubPtr shmpub = ShmPubPtr());
 	/*!
-	 * @brief 解除与网络连接的关联
+	 * @brief 设置帧缓存
+	 * @param cache 帧缓存. 写盘完成后缓存内存中的文件数据
 	 */
-	void DecoupleNetowrk();
+	void SetFrameCache(FrameCachePtr cache);
+	/*!
+	 * @brief 设置存储空间回收
+	 * @param reclaim 回收器. 写盘完成后累计写盘字节数
+	 */
+	void SetReclaimer(ReclaimerPtr reclaim);
+	/*!
+	 * @brief 设置已存储文件索引
+	 * @param index 文件索引. 写盘完成后记录文件
+	 */
+	void SetFileIndex(FileIndexPtr index);
+	/*!
+	 * @brief 设置存储容量预测
+	 * @param forecast 容量预测. 写盘完成后累计盘区与相机的写盘字节数
+	 */
+	void SetForecast(ForecastPtr forecast);
+	/*!
+	 * @brief 设置分层存储迁移
+	 * @param migrator 迁移器. 此后文件写入其着陆盘区, UpdateStorage()更换迁移目标盘区
+	 */
+	void SetMigrator(MigratorPtr migrator);
+	/*!
+	 * @brief 设置写盘前的分块无损压缩
+	 * @param enabled 启用压缩. 仅压缩16位二维主图像, 压缩收益不足时保留原始数据
+	 * @param nworker 压缩线程数量
+	 * @note
+	 * 文件名不变. 压缩后的文件为fpack格式, cfitsio可直接读取
+	 */
+	void SetCompressor(bool enabled, int nworker);
+	/*!
+	 * @brief 查看是否以分块压缩格式存储图像
+	 * @note
+	 * 为真时, 客户端以rice算法压缩传输的文件直接写盘, 否则接收后解压
+	 */
+	bool StoresCompressed();
+	/*!
+	 * @brief 设置写盘时提取的FITS关键字
+	 * @param enabled  启用提取
+	 * @param keywords 关键字, 以逗号分隔
+	 * @note
+	 * 关键字记录在文件索引中, 并随数据库注册及数据处理通知发送
+	 */
+	void SetMetadata(bool enabled, const char* keywords);
+	/*!
+	 * @brief 从目录缓存中清除路径及其子目录
+	 * @param path 已删除目录路径
+	 */
+	void ForgetDirectory(const string &path);
+	/*!
+	 * @brief 文件已迁移至其它盘区或打包至容器, 更新数据库中的文件路径
+	 * @param x         原文件记录
+	 * @param root      新盘区
+	 * @param container 容器相对盘区的路径. 为空时相对路径不变
+	 */
+	void FileMoved(const FileIndex::entry &x, const string &root, const string &container);
 
 protected:
 	// 功能
@@ -122,12 +336,78 @@ protected:
 	 * @brief 监测线程: 检查是否有文件等待存储, 并存储该文件到磁盘
 	 */
 	void thread_monitor();
+	/*!
+	 * @brief 线程: 将一个流式接收文件逐块写入磁盘
+	 * @param ptr 流式接收文件
+	 */
+	void thread_stream(nfileptr ptr);
+	/*!
+	 * @brief 线程: 压缩内存中的文件, 再进入写盘队列
+	 */
+	void thread_compress();
+	/*!
+	 * @brief 将文件加入写盘队列
+	 */
+	void enqueue(nfileptr nfptr);
+	/*!
+	 * @brief 存储一个流式接收文件
+	 * @param ptr 待保存文件
+	 */
+	void save_stream(nfileptr ptr);
+	/*!
+	 * @brief 查看文件的图像类型, 文件在内存中时从FITS头提取
+	 */
+	IMAGE_TYPE image_type_of(nfileptr ptr);
+	/*!
+	 * @brief 从FITS头提取图像类型及已配置的关键字
+	 * @param data 文件数据或首块数据. 分块压缩FITS从压缩图像扩展头提取
+	 * @param n    数据长度, 量纲: 字节
+	 * @param kvs  提取的关键字
+	 */
+	void parse_header(const char *data, int64_t n, fitskeys &kvs);
+	/*!
+	 * @brief 将内存中的文件写入已打开的文件, 并关闭文件
+	 * @return
+	 * 0: 成功; 其它: 错误码
+	 */
+	int write_file(FILE *fp, nfileptr ptr);
+	/*!
+	 * @brief 输出各优先级类别的排队延时统计
+	 */
+	void log_schedule();
+	/*!
+	 * @brief 输出各相机的压缩统计
+	 */
+	void log_compress();
 	/*!
 	 * @brief 存储缓存中的第一个文件
 	 * @return
 	 * 文件存储结果
 	 */
 	bool save_first();
+	/*!
+	 * @brief 检查目录是否存在, 不存在时创建目录
+	 * @param root    根路径. 由调用方取得, 不受并发更换根路径影响
+	 * @param subpath 子目录名称
+	 * @param path    目录全路径
+	 * @return
+	 * 目录可用性
+	 * @note
+	 * 已确认存在的目录记录在缓存中, 避免重复访问文件系统
+	 */
+	bool check_directory(const string &root, const string &subpath, const boost::filesystem::path &path);
+	/*!
+	 * @brief 线程: 依据当前观测夜目录, 预先创建下一观测夜目录
+	 */
+	void thread_predir();
+	/*!
+	 * @brief 由子目录名称生成下一观测夜的子目录名称
+	 * @param subpath 子目录名称, 格式: *_YYMMDD
+	 * @param next    下一观测夜子目录名称
+	 * @return
+	 * 子目录名称符合格式
+	 */
+	bool next_subpath(const string &subpath, string &next);
 };
 typedef boost::shared_ptr<FileWritter> FileWritePtr;
 extern FileWritePtr make_filewritter();
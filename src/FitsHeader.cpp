@@ -0,0 +1,97 @@
+/*!
+ * @file FitsHeader.cpp FITS主头关键字提取定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <string.h>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "FitsHeader.h"
+
+#define FITS_CARD	80	//< 头单元行长度, 量纲: 字节
+
+FitsHeader::FitsHeader(const string &keywords) {
+	std::vector<string> tokens;
+
+	boost::split(tokens, keywords, boost::is_any_of(", \t"), boost::token_compress_on);
+	for (std::vector<string>::iterator it = tokens.begin(); it != tokens.end(); ++it) {
+		if (it->empty() || it->size() > 8) continue;
+		string name = boost::to_upper_copy(*it);
+		char text[8];
+		uint64_t key;
+
+		memset(text, ' ', 8);
+		memcpy(text, name.data(), name.size());
+		memcpy(&key, text, 8);
+		if (match(key) >= 0) continue;
+		keys_.push_back(key);
+		names_.push_back(name);
+	}
+}
+
+FitsHeader::~FitsHeader() {
+}
+
+bool FitsHeader::Empty() {
+	return keys_.empty();
+}
+
+int FitsHeader::match(uint64_t key) {
+	int n = int(keys_.size()), i(0);
+
+#if defined(__SSE2__)
+	__m128i x = _mm_set1_epi64x(int64_t(key));
+	for (; i + 2 <= n; i += 2) {
+		int m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_loadu_si128((const __m128i *) &keys_[i])));
+		if ((m & 0xFF) == 0xFF) return i;
+		if ((m >> 8) == 0xFF) return i + 1;
+	}
+#endif
+	for (; i < n; ++i) {
+		if (keys_[i] == key) return i;
+	}
+	return -1;
+}
+
+bool FitsHeader::Parse(const char *data, int64_t n, fitskeys &kvs) {
+	uint64_t key, end;
+	int i;
+
+	memcpy(&end, "END     ", 8);
+	if (n < FITS_CARD || (strncmp(data, "SIMPLE  =", 9) && strncmp(data, "XTENSION=", 9))) return false;
+	for (const char *card = data; card + FITS_CARD <= data + n; card += FITS_CARD) {
+		memcpy(&key, card, 8);
+		if (key == end) return true;
+		if (card[8] == '=' && card[9] == ' ' && (i = match(key)) >= 0)
+			kvs[names_[i]] = card_value(card);
+	}
+	return false;
+}
+
+string FitsHeader::card_value(const char *card) {
+	const char *p = card + 10, *end = card + FITS_CARD;
+	string value;
+
+	while (p < end && *p == ' ') ++p;
+	if (p < end && *p == '\'') {// 字符串: 两个连续单引号表示一个单引号
+		for (++p; p < end; ++p) {
+			if (*p == '\'') {
+				if (p + 1 < end && p[1] == '\'') ++p;
+				else break;
+			}
+			value += *p;
+		}
+		boost::trim_right(value);
+	}
+	else {
+		const char *q = p;
+		while (q < end && *q != '/') ++q;
+		value.assign(p, q - p);
+		boost::trim(value);
+	}
+	return value;
+}
@@ -0,0 +1,68 @@
+/*!
+ * @file FitsHeader.h FITS主头关键字提取声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 从内存中的FITS文件(或其起始部分)读取主头
+ * - 仅提取预先配置的关键字. 关键字按8字节整数比较, SSE2每次比较两个配置关键字
+ * - 典型主头(百余行)耗时为微秒量级
+ * - 字符串值去除引号与尾部空格, 其它值去除注释
+ */
+
+#ifndef FITSHEADER_H_
+#define FITSHEADER_H_
+
+#include <string>
+#include <map>
+#include <stdint.h>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+
+using std::string;
+
+typedef std::map<string, string> fitskeys;	//< 关键字-值
+
+class FitsHeader {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param keywords 待提取关键字, 以逗号或空格分隔
+	 */
+	FitsHeader(const string &keywords);
+	virtual ~FitsHeader();
+
+protected:
+	std::vector<uint64_t> keys_;	//< 待提取关键字, 空格补齐至8字节
+	std::vector<string> names_;	//< 与keys_对应的关键字名称
+
+public:
+	/*!
+	 * @brief 提取关键字
+	 * @param data 文件数据
+	 * @param n    数据长度, 量纲: 字节
+	 * @param kvs  提取的关键字
+	 * @return
+	 * 找到END关键字时返回true
+	 */
+	bool Parse(const char *data, int64_t n, fitskeys &kvs);
+	/*!
+	 * @brief 查看是否配置了关键字
+	 */
+	bool Empty();
+
+protected:
+	/*!
+	 * @brief 查找关键字
+	 * @param key 一行的前8字节
+	 * @return
+	 * 在keys_中的位置. 未配置时返回-1
+	 */
+	int match(uint64_t key);
+	/*!
+	 * @brief 解析一行(80字节)中的值
+	 */
+	string card_value(const char *card);
+};
+typedef boost::shared_ptr<FitsHeader> FitsHeaderPtr;
+
+#endif /* FITSHEADER_H_ */
@@ -0,0 +1,67 @@
+/*!
+ * @file FrameCache.cpp 最近写盘帧的内存缓存定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include "FrameCache.h"
+
+FrameCache::FrameCache(int64_t capacity) {
+	capacity_ = capacity;
+	used_     = 0;
+	nhit_     = 0;
+	nmiss_    = 0;
+}
+
+FrameCache::~FrameCache() {
+}
+
+void FrameCache::Put(const string &cid, const string &filename, const charray &data, int64_t size) {
+	if (!data.get() || size <= 0 || size > capacity_) return;
+
+	string key = cid + "/" + filename;
+	mutex_lock lck(mtx_);
+	frameMap::iterator it = index_.find(key);
+
+	if (it != index_.end()) {// 同名文件被覆盖
+		used_ -= it->second->size;
+		frames_.erase(it->second);
+		index_.erase(it);
+	}
+	while (used_ + size > capacity_ && frames_.size()) {// 淘汰最久未使用的帧
+		used_ -= frames_.back().size;
+		index_.erase(frames_.back().key);
+		frames_.pop_back();
+	}
+
+	frame x;
+	x.key  = key;
+	x.data = data;
+	x.size = size;
+	frames_.push_front(x);
+	index_[key] = frames_.begin();
+	used_ += size;
+}
+
+bool FrameCache::Get(const string &cid, const string &filename, charray &data, int64_t &size) {
+	mutex_lock lck(mtx_);
+	frameMap::iterator it = index_.find(cid + "/" + filename);
+
+	if (it == index_.end()) {
+		++nmiss_;
+		return false;
+	}
+	frames_.splice(frames_.begin(), frames_, it->second);
+	data = it->second->data;
+	size = it->second->size;
+	++nhit_;
+	return true;
+}
+
+void FrameCache::Stats(int &nframe, int64_t &used, int64_t &nhit, int64_t &nmiss) {
+	mutex_lock lck(mtx_);
+	nframe = frames_.size();
+	used   = used_;
+	nhit   = nhit_;
+	nmiss  = nmiss_;
+}
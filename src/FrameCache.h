@@ -0,0 +1,86 @@
+/*!
+ * @file FrameCache.h 最近写盘帧的内存缓存声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 以相机标志与文件名为关键字, 按最近最少使用(LRU)淘汰
+ * - 总容量以字节计. 缓存引用接收缓冲区, 不复制文件数据
+ * - 缓存的缓冲区在淘汰前不归还缓冲区池, 缓冲区池容量应计入缓存容量
+ */
+
+#ifndef FRAMECACHE_H_
+#define FRAMECACHE_H_
+
+#include <list>
+#include <map>
+#include <string>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+using std::string;
+
+class FrameCache {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param capacity 总容量, 量纲: 字节
+	 */
+	FrameCache(int64_t capacity);
+	virtual ~FrameCache();
+
+public:
+	// 数据类型
+	typedef boost::shared_array<char> charray;
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	struct frame {// 缓存帧
+		string key;		//< 关键字
+		charray data;	//< 文件数据
+		int64_t size;	//< 文件大小, 量纲: 字节
+	};
+	typedef std::list<frame> frameList;	//< 按使用时间排序, 最近使用在前
+	typedef std::map<string, frameList::iterator> frameMap;
+
+protected:
+	// 成员变量
+	int64_t capacity_;	//< 总容量, 量纲: 字节
+	int64_t used_;		//< 已用容量, 量纲: 字节
+	frameList frames_;	//< 缓存帧
+	frameMap index_;	//< 关键字索引
+	int64_t nhit_;		//< 统计: 命中次数
+	int64_t nmiss_;		//< 统计: 未命中次数
+	boost::mutex mtx_;	//< 互斥锁
+
+public:
+	// 接口
+	/*!
+	 * @brief 缓存新写盘的帧
+	 * @param cid      相机标志
+	 * @param filename 文件名
+	 * @param data     文件数据
+	 * @param size     文件大小, 量纲: 字节
+	 */
+	void Put(const string &cid, const string &filename, const charray &data, int64_t size);
+	/*!
+	 * @brief 查找帧
+	 * @param cid      相机标志
+	 * @param filename 文件名
+	 * @param data     文件数据
+	 * @param size     文件大小, 量纲: 字节
+	 * @return
+	 * 命中时返回true
+	 */
+	bool Get(const string &cid, const string &filename, charray &data, int64_t &size);
+	/*!
+	 * @brief 查看统计信息
+	 * @param nframe 缓存帧数量
+	 * @param used   已用容量, 量纲: 字节
+	 * @param nhit   命中次数
+	 * @param nmiss  未命中次数
+	 */
+	void Stats(int &nframe, int64_t &used, int64_t &nhit, int64_t &nmiss);
+};
+typedef boost::shared_ptr<FrameCache> FrameCachePtr;
+
+#endif /* FRAMECACHE_H_ */
@@ -0,0 +1,173 @@
+/*!
+ * @file NightPacker.cpp 观测夜容器打包定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <map>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind/bind.hpp>
+#include "NightPacker.h"
+#include "PackFile.h"
+#include "TierMigrator.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+namespace fs = boost::filesystem;
+
+#define IOPRIO_CLASS_SHIFT	13
+#define IOPRIO_CLASS_IDLE	3
+#define IOPRIO_WHO_PROCESS	1
+
+#define PACK_PERIOD		3600		// 检查周期, 量纲: 秒
+#define PACK_SCAN		100000		// 每次查看的最多文件数量
+#define PACK_SUFFIX		".fpk"		// 容器文件后缀
+
+NightPacker::NightPacker(const std::vector<string> &roots, FileIndexPtr index, int after) {
+	roots_ = roots;
+	index_ = index;
+	after_ = after > 0 ? after : 1;
+}
+
+NightPacker::~NightPacker() {
+	Stop();
+}
+
+void NightPacker::Start(const RemovedSlot &slot, const MovedSlot &moved) {
+	cbremoved_ = slot;
+	cbmoved_   = moved;
+	thrd_.reset(new boost::thread(boost::bind(&NightPacker::thread_pack, this)));
+}
+
+void NightPacker::Stop() {
+	if (thrd_.unique()) {
+		thrd_->interrupt();
+		thrd_->join();
+		thrd_.reset();
+	}
+}
+
+string NightPacker::ContainerName(const string &cid) {
+	return (cid.empty() ? string("night") : cid) + PACK_SUFFIX;
+}
+
+void NightPacker::thread_pack() {
+	// 打包线程使用空闲I/O优先级, 仅在磁盘空闲时复制数据
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, syscall(SYS_gettid), IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+
+	while(1) {
+		boost::this_thread::sleep_for(boost::chrono::seconds(PACK_PERIOD));
+
+		for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {
+			int n, total(0);
+			while ((n = pack_root(*it)) > 0) total += n;
+			if (total) _gLog.Write("packed %d files into night containers on <%s>", total, it->c_str());
+		}
+	}
+}
+
+int NightPacker::pack_root(const string &root) {
+	typedef std::pair<string, string> groupkey;	// 观测夜目录+相机标志
+	typedef std::map<groupkey, std::vector<FileIndex::entry> > groupMap;
+	std::vector<FileIndex::entry> files;
+	groupMap groups;
+	string::size_type pos;
+	int tonight = FileIndex::night_of_time(to_iso_extended_string(second_clock::universal_time()));
+	int n(0);
+
+	index_->Before(root, tonight - after_ + 1, PACK_SUFFIX, PACK_SCAN, files);
+	for (std::vector<FileIndex::entry>::iterator it = files.begin(); it != files.end(); ++it) {
+		if ((pos = it->relpath.find('/')) == string::npos) continue;
+		string top = it->relpath.substr(0, pos);
+		if (night_of_directory(top) >= 0) groups[groupkey(top, it->cid)].push_back(*it);
+	}
+	for (groupMap::iterator it = groups.begin(); it != groups.end(); ++it) {
+		n += pack_group(root, it->first.first, it->first.second, it->second);
+		boost::this_thread::interruption_point();
+	}
+	// 仅有无法打包的文件时停止, 避免反复查看
+	return files.size() < PACK_SCAN ? 0 : n;
+}
+
+int NightPacker::pack_group(const string &root, const string &top, const string &cid,
+		const std::vector<FileIndex::entry> &files) {
+	string relpack = top + "/" + ContainerName(cid);
+	string pathpack = (fs::path(root) / relpack).string();
+	std::vector<const FileIndex::entry*> packed;
+	PackFile::itemVec items;
+	FileIndex::entry old;
+	string tmobs = files.front().tmobs;
+	int64_t end(-1);
+	struct stat st;
+	int fd, fdin;
+
+	if ((fd = open(pathpack.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+		_gLog.Write(LOG_WARN, "NightPacker", "failed to open <%s>. %s", pathpack.c_str(), strerror(errno));
+		return 0;
+	}
+	// 已有容器: 截断至索引记录的长度, 丢弃中断时写入的数据
+	if (index_->Find(root, relpack, old)) {
+		if (!PackFile::Load(fd, old.size, items)) {// 不覆盖已打包的数据
+			_gLog.Write(LOG_WARN, "NightPacker", "<%s> is corrupted, leaves files unpacked", pathpack.c_str());
+			close(fd);
+			return 0;
+		}
+		if (ftruncate(fd, old.size) == 0) end = old.size;
+		if (old.tmobs < tmobs) tmobs = old.tmobs;
+	}
+	else if (ftruncate(fd, 0) == 0) {
+		items.clear();
+		end = PackFile::WriteHeader(fd);
+	}
+
+	for (std::vector<FileIndex::entry>::const_iterator it = files.begin(); end >= 0 && it != files.end(); ++it) {
+		string src = (fs::path(root) / it->relpath).string();
+		if ((fdin = open(src.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+			if (errno == ENOENT) index_->Remove(root, it->relpath);
+			continue;
+		}
+		if (fstat(fdin, &st) == 0 && lseek(fd, end, SEEK_SET) == end && TierMigrator::CopyData(fdin, fd, st.st_size)) {
+			PackFile::item x;
+			x.name   = it->relpath.substr(top.size() + 1);
+			x.offset = end;
+			x.size   = st.st_size;
+			items.push_back(x);
+			packed.push_back(&*it);
+			end += st.st_size;
+		}
+		else _gLog.Write(LOG_WARN, "NightPacker", "failed to pack <%s>. %s", src.c_str(), strerror(errno));
+		close(fdin);
+	}
+	if (packed.empty() || fdatasync(fd) || (end = PackFile::WriteIndex(fd, end, items)) < 0 || fdatasync(fd)) {
+		if (packed.size()) _gLog.Write(LOG_WARN, "NightPacker", "failed to write <%s>. %s", pathpack.c_str(), strerror(errno));
+		close(fd);
+		return 0;
+	}
+	close(fd);
+
+	// 容器已同步: 记录容器, 再删除原文件
+	index_->Add(root, relpack, end, cid, tmobs);
+	for (std::vector<const FileIndex::entry*>::iterator it = packed.begin(); it != packed.end(); ++it) {
+		string src = (fs::path(root) / (*it)->relpath).string();
+		index_->Remove(root, (*it)->relpath);
+		if (!cbmoved_.empty()) cbmoved_(**it, root, relpack);
+		unlink(src.c_str());
+		prune_directory(src, (fs::path(root) / top).string());
+	}
+	return int(packed.size());
+}
+
+void NightPacker::prune_directory(const string &path, const string &top) {
+	for (fs::path dir = fs::path(path).parent_path(); dir.string().size() > top.size(); dir = dir.parent_path()) {
+		if (rmdir(dir.c_str())) break;	// 目录非空
+		if (!cbremoved_.empty()) cbremoved_(dir.string());
+	}
+}
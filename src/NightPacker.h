@@ -0,0 +1,105 @@
+/*!
+ * @file NightPacker.h 观测夜容器打包声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 归档模式: 观测夜结束后, 将各相机的文件打包为观测夜目录下的容器<cid>.fpk
+ * - 大量小文件合并为少量大文件, 减少inode数量, 加速扫描、备份与同步
+ * - 容器内嵌散列索引, 按文件名O(1)提取单帧, 数据处理仍可按原路径读取
+ * - 容器仅追加. 迟到的文件追加至已有容器, 中断后按索引记录的容器长度截断
+ * - 打包线程使用空闲I/O优先级
+ * - 文件打包后经回调通知, 由数据库注册更新文件路径
+ */
+
+#ifndef NIGHTPACKER_H_
+#define NIGHTPACKER_H_
+
+#include <string>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include "FileIndex.h"
+
+using std::string;
+
+class NightPacker {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param roots 存储盘区
+	 * @param index 已存储文件索引
+	 * @param after 观测夜结束该天数后打包. 1: 次日打包
+	 */
+	NightPacker(const std::vector<string> &roots, FileIndexPtr index, int after);
+	virtual ~NightPacker();
+
+public:
+	// 数据类型
+	typedef boost::function<void (const string &)> RemovedSlot;	//< 目录已删除回调函数
+	/*!
+	 * @brief 文件已迁移回调函数
+	 * 参数: 原文件记录, 新盘区, 容器相对盘区的路径(仅打包时非空)
+	 */
+	typedef boost::function<void (const FileIndex::entry &, const string &, const string &)> MovedSlot;
+
+protected:
+	typedef boost::shared_ptr<boost::thread> threadptr;
+
+protected:
+	// 成员变量
+	std::vector<string> roots_;	//< 存储盘区
+	FileIndexPtr index_;	//< 已存储文件索引
+	int after_;				//< 观测夜结束该天数后打包
+	RemovedSlot cbremoved_;	//< 目录已删除回调函数
+	MovedSlot cbmoved_;		//< 文件已迁移回调函数
+	threadptr thrd_;		//< 线程: 打包
+
+public:
+	// 接口
+	/*!
+	 * @brief 启动打包线程
+	 * @param slot  目录已删除回调函数
+	 * @param moved 文件已迁移回调函数
+	 */
+	void Start(const RemovedSlot &slot, const MovedSlot &moved = MovedSlot());
+	/*!
+	 * @brief 停止打包线程
+	 */
+	void Stop();
+	/*!
+	 * @brief 查看相机在观测夜目录下的容器名称
+	 * @param cid 相机标志. 为空时(扫描重建的记录)使用night.fpk
+	 */
+	static string ContainerName(const string &cid);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 线程: 定时打包已结束的观测夜
+	 */
+	void thread_pack();
+	/*!
+	 * @brief 打包盘区中已结束观测夜的文件
+	 * @return
+	 * 已打包文件数量
+	 */
+	int pack_root(const string &root);
+	/*!
+	 * @brief 将同一观测夜目录、同一相机的文件追加至容器
+	 * @param root  存储盘区
+	 * @param top   观测夜目录名称
+	 * @param cid   相机标志
+	 * @param files 文件记录
+	 * @return
+	 * 已打包文件数量
+	 */
+	int pack_group(const string &root, const string &top, const string &cid, const std::vector<FileIndex::entry> &files);
+	/*!
+	 * @brief 由文件所在目录向上删除空目录, 直至观测夜目录
+	 */
+	void prune_directory(const string &path, const string &top);
+};
+typedef boost::shared_ptr<NightPacker> PackerPtr;
+
+#endif /* NIGHTPACKER_H_ */
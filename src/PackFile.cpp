@@ -0,0 +1,140 @@
+/*!
+ * @file PackFile.cpp 观测夜容器文件格式定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <map>
+#include <boost/smart_ptr.hpp>
+#include "PackFile.h"
+
+#define PACK_HEADER		"FTPACK01"
+#define PACK_FOOTER		"FTPKEND1"
+#define PACK_MAGICLEN	8
+#define PACK_FOOTLEN	32			// 文件尾长度
+#define PACK_SLOTLEN	32			// 散列表槽长度
+#define PACK_MAXNAME	65535		// 名称最大长度
+
+/*!
+ * @brief 在指定位置写入全部数据
+ */
+static bool pwrite_all(int fd, const void *data, size_t size, int64_t pos) {
+	const char *p = (const char *) data;
+	ssize_t n;
+
+	for (; size > 0; p += n, size -= n, pos += n) {
+		if ((n = pwrite(fd, p, size, pos)) <= 0) return false;
+	}
+	return true;
+}
+
+int64_t PackFile::WriteHeader(int fd) {
+	return pwrite_all(fd, PACK_HEADER, PACK_MAGICLEN, 0) ? PACK_MAGICLEN : -1;
+}
+
+bool PackFile::Locate(int fd, int64_t end, const string &name, int64_t &offset, int64_t &size) {
+	uint64_t table, nslot, nitem, slot[4];
+	uint64_t h = hash(name);
+	string x;
+
+	if (!read_footer(fd, end, table, nslot, nitem) || !nslot) return false;
+	for (uint64_t i = 0, k = h % nslot; i < nslot; ++i, k = (k + 1) % nslot) {// 线性探测
+		if (pread(fd, slot, sizeof(slot), table + k * PACK_SLOTLEN) != sizeof(slot) || slot[0] == 0) return false;
+		if (slot[0] == h && read_name(fd, slot[1], x) && x == name) {
+			offset = slot[2];
+			size   = slot[3];
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PackFile::Load(int fd, int64_t end, itemVec &items) {
+	uint64_t table, nslot, nitem, slot[4];
+
+	items.clear();
+	if (!read_footer(fd, end, table, nslot, nitem)) return false;
+	for (uint64_t k = 0; k < nslot; ++k) {
+		if (pread(fd, slot, sizeof(slot), table + k * PACK_SLOTLEN) != sizeof(slot)) return false;
+		if (slot[0] == 0) continue;
+		item x;
+		if (!read_name(fd, slot[1], x.name)) return false;
+		x.offset = slot[2];
+		x.size   = slot[3];
+		items.push_back(x);
+	}
+	return items.size() == nitem;
+}
+
+int64_t PackFile::WriteIndex(int fd, int64_t pos, const itemVec &items) {
+	std::map<string, const item*> unique;	// 同名文件以后者为准
+	for (itemVec::const_iterator it = items.begin(); it != items.end(); ++it) {
+		if (it->name.size() <= PACK_MAXNAME) unique[it->name] = &*it;
+	}
+
+	// 名称表
+	string names;
+	std::vector<uint64_t> nameoff;
+	for (std::map<string, const item*>::iterator it = unique.begin(); it != unique.end(); ++it) {
+		uint16_t len = it->first.size();
+		nameoff.push_back(pos + names.size());
+		names.append((const char *) &len, sizeof(len));
+		names.append(it->first);
+	}
+	if (!pwrite_all(fd, names.data(), names.size(), pos)) return -1;
+	pos += names.size();
+
+	// 散列表: 装载率不超过1/2
+	uint64_t nslot = 16;
+	while (nslot < unique.size() * 2) nslot *= 2;
+	boost::shared_array<uint64_t> table(new uint64_t[nslot * 4]);
+	memset(table.get(), 0, nslot * PACK_SLOTLEN);
+	size_t i = 0;
+	for (std::map<string, const item*>::iterator it = unique.begin(); it != unique.end(); ++it, ++i) {
+		uint64_t h = hash(it->first), k = h % nslot;
+		while (table[k * 4]) k = (k + 1) % nslot;
+		table[k * 4]     = h;
+		table[k * 4 + 1] = nameoff[i];
+		table[k * 4 + 2] = it->second->offset;
+		table[k * 4 + 3] = it->second->size;
+	}
+	uint64_t footer[4] = { 0, uint64_t(pos), nslot, unique.size() };
+	memcpy(footer, PACK_FOOTER, PACK_MAGICLEN);
+	if (!pwrite_all(fd, table.get(), nslot * PACK_SLOTLEN, pos)) return -1;
+	pos += nslot * PACK_SLOTLEN;
+	if (!pwrite_all(fd, footer, sizeof(footer), pos)) return -1;
+	return pos + PACK_FOOTLEN;
+}
+
+uint64_t PackFile::hash(const string &name) {
+	uint64_t h = 14695981039346656037ULL;	// FNV-1a
+	for (string::const_iterator it = name.begin(); it != name.end(); ++it) {
+		h ^= (unsigned char) *it;
+		h *= 1099511628211ULL;
+	}
+	return h ? h : 1;
+}
+
+bool PackFile::read_footer(int fd, int64_t end, uint64_t &table, uint64_t &nslot, uint64_t &nitem) {
+	uint64_t footer[4];
+
+	if (end < PACK_MAGICLEN + PACK_FOOTLEN || pread(fd, footer, sizeof(footer), end - PACK_FOOTLEN) != sizeof(footer)
+			|| memcmp(footer, PACK_FOOTER, PACK_MAGICLEN))
+		return false;
+	table = footer[1];
+	nslot = footer[2];
+	nitem = footer[3];
+	return table + nslot * PACK_SLOTLEN + PACK_FOOTLEN == uint64_t(end);
+}
+
+bool PackFile::read_name(int fd, int64_t pos, string &name) {
+	char buff[PACK_MAXNAME];
+	uint16_t len;
+
+	if (pread(fd, &len, sizeof(len), pos) != sizeof(len)) return false;
+	if (len && pread(fd, buff, len, pos + sizeof(len)) != len) return false;
+	name.assign(buff, len);
+	return true;
+}
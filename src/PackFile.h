@@ -0,0 +1,86 @@
+/*!
+ * @file PackFile.h 观测夜容器文件格式声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 容器由文件头、文件数据、名称表、散列表与文件尾组成, 仅在末尾追加
+ * - 追加文件时在新数据之后写入完整的名称表、散列表与文件尾, 以最后的文件尾为准
+ * - 文件尾: 标志"FTPKEND1", 散列表位置, 槽数量, 文件数量, 各8字节
+ * - 散列表槽: 名称散列值(0表示空槽), 名称位置, 数据位置, 数据长度, 各8字节. 名称为2字节长度+字符
+ * - 按名称查找为O(1): 读取文件尾后按散列值线性探测
+ * - 按索引记录的容器长度查找: 追加期间该长度之前的数据不变, 已打包的文件仍可读取
+ */
+
+#ifndef PACKFILE_H_
+#define PACKFILE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using std::string;
+
+class PackFile {
+public:
+	// 数据类型
+	struct item {// 容器中的文件
+		string name;	//< 相对观测夜目录的路径
+		int64_t offset;	//< 数据位置
+		int64_t size;	//< 数据长度, 量纲: 字节
+	};
+	typedef std::vector<item> itemVec;
+
+public:
+	// 接口
+	/*!
+	 * @brief 写入文件头
+	 * @return
+	 * 首个文件的数据位置. 失败时返回-1
+	 */
+	static int64_t WriteHeader(int fd);
+	/*!
+	 * @brief 按名称查找文件
+	 * @param fd     容器文件描述符
+	 * @param end    容器有效长度, 即最后文件尾的结束位置
+	 * @param name   相对观测夜目录的路径
+	 * @param offset 数据位置
+	 * @param size   数据长度, 量纲: 字节
+	 * @return
+	 * 找到文件
+	 */
+	static bool Locate(int fd, int64_t end, const string &name, int64_t &offset, int64_t &size);
+	/*!
+	 * @brief 读取全部文件
+	 * @param fd    容器文件描述符
+	 * @param end   容器有效长度, 即最后文件尾的结束位置
+	 * @param items 文件
+	 * @return
+	 * 文件尾有效
+	 */
+	static bool Load(int fd, int64_t end, itemVec &items);
+	/*!
+	 * @brief 在数据之后写入名称表、散列表与文件尾. 同名文件以后者为准
+	 * @param fd    容器文件描述符
+	 * @param pos   写入位置
+	 * @param items 文件
+	 * @return
+	 * 容器有效长度. 失败时返回-1
+	 */
+	static int64_t WriteIndex(int fd, int64_t pos, const itemVec &items);
+
+protected:
+	/*!
+	 * @brief 名称散列值, 不为0
+	 */
+	static uint64_t hash(const string &name);
+	/*!
+	 * @brief 读取位于end之前的文件尾
+	 */
+	static bool read_footer(int fd, int64_t end, uint64_t &table, uint64_t &nslot, uint64_t &nitem);
+	/*!
+	 * @brief 读取名称
+	 */
+	static bool read_name(int fd, int64_t pos, string &name);
+};
+
+#endif /* PACKFILE_H_ */
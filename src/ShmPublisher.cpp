@@ -0,0 +1,93 @@
+/*!
+ * @file ShmPublisher.cpp 共享内存新文件通知发布器定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include "ShmPublisher.h"
+#include "GLog.h"
+
+/*!
+ * @brief 复制字符串, 超长时截断
+ */
+template <size_t N>
+static void copy_field(char (&dst)[N], const string &src) {
+	size_t n = src.size() < N - 1 ? src.size() : N - 1;
+	memcpy(dst, src.data(), n);
+	dst[n] = 0;
+}
+
+ShmPublisher::ShmPublisher(const string &name, int nslot) {
+	name_  = name;
+	nslot_ = nslot > 0 ? nslot : 1024;
+	base_  = NULL;
+	size_  = shm_ring_size(nslot_);
+}
+
+ShmPublisher::~ShmPublisher() {
+	if (base_) munmap(base_, size_);
+}
+
+bool ShmPublisher::Open() {
+	struct stat st;
+	bool reuse;
+	int fd;
+
+	if ((fd = shm_open(name_.c_str(), O_RDWR | O_CREAT, 0644)) < 0) {
+		_gLog.Write(LOG_FAULT, "ShmPublisher::Open", "failed to open shared memory<%s>. %s",
+				name_.c_str(), strerror(errno));
+		return false;
+	}
+	reuse = fstat(fd, &st) == 0 && size_t(st.st_size) == size_;
+	if ((!reuse && ftruncate(fd, size_))
+			|| (base_ = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		_gLog.Write(LOG_FAULT, "ShmPublisher::Open", "failed to map shared memory<%s>. %s",
+				name_.c_str(), strerror(errno));
+		base_ = NULL;
+		close(fd);
+		return false;
+	}
+	close(fd);
+
+	shm_ring_head *hdr = head();
+	if (!(reuse && hdr->magic == SHMRING_MAGIC && hdr->version == SHMRING_VERSION
+			&& hdr->nslot == nslot_ && hdr->slotsize == sizeof(shm_slot))) {
+		memset(base_, 0, size_);
+		hdr->version  = SHMRING_VERSION;
+		hdr->nslot    = nslot_;
+		hdr->slotsize = sizeof(shm_slot);
+		std::atomic_thread_fence(std::memory_order_release);
+		hdr->magic    = SHMRING_MAGIC;
+	}
+	_gLog.Write("notifications are published in shared memory<%s>, %u slots", name_.c_str(), nslot_);
+
+	return true;
+}
+
+void ShmPublisher::Publish(apfileinfo proto, const string &imgtype) {
+	if (!base_) return;
+
+	shm_ring_head *hdr = head();
+	uint64_t seq = hdr->head.load(std::memory_order_relaxed);
+	shm_slot *slot = slots() + seq % nslot_;
+	shm_fileinfo &info = slot->info;
+
+	slot->seq.store(2 * seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	info.filesize  = proto->filesize;
+	info.tmpublish = shm_ring_now();
+	copy_field(info.gid,      proto->gid);
+	copy_field(info.uid,      proto->uid);
+	copy_field(info.cid,      proto->cid);
+	copy_field(info.imgtype,  imgtype);
+	copy_field(info.tmobs,    proto->tmobs);
+	copy_field(info.subpath,  proto->subpath);
+	copy_field(info.filename, proto->filename);
+	slot->seq.store(2 * (seq + 1), std::memory_order_release);
+	hdr->head.store(seq + 1, std::memory_order_release);
+
+	hdr->wake.fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, &hdr->wake, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
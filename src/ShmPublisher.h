@@ -0,0 +1,66 @@
+/*!
+ * @file ShmPublisher.h 共享内存新文件通知发布器声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 向同机数据处理进程发布新文件通知, 内存布局与读取接口见ShmRing.h
+ * - 单生产者: 仅由写盘线程调用Publish()
+ * - 发布不等待读者: 写入槽位、推进序号并唤醒休眠的读者
+ * - 启动时若已有布局相同的共享内存, 沿用其序号, 使已连接的读者继续读取
+ */
+
+#ifndef SHMPUBLISHER_H_
+#define SHMPUBLISHER_H_
+
+#include <string>
+#include <boost/smart_ptr.hpp>
+#include "ShmRing.h"
+#include "AsciiProtocol.h"
+
+using std::string;
+
+class ShmPublisher {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param name  共享内存名称, 格式: /name
+	 * @param nslot 槽位数量
+	 */
+	ShmPublisher(const string &name, int nslot);
+	virtual ~ShmPublisher();
+
+protected:
+	// 成员变量
+	string name_;		//< 共享内存名称
+	uint32_t nslot_;	//< 槽位数量
+	void *base_;		//< 共享内存映射地址
+	size_t size_;		//< 共享内存长度
+
+public:
+	// 接口
+	/*!
+	 * @brief 创建或打开共享内存
+	 * @return
+	 * 操作结果
+	 */
+	bool Open();
+	/*!
+	 * @brief 发布新文件通知
+	 * @param proto   文件描述信息
+	 * @param imgtype 图像类型. 未知时为空
+	 */
+	void Publish(apfileinfo proto, const string &imgtype);
+
+protected:
+	// 功能
+	shm_ring_head *head() {
+		return (shm_ring_head*) base_;
+	}
+
+	shm_slot *slots() {
+		return (shm_slot*) ((char*) base_ + sizeof(shm_ring_head));
+	}
+};
+typedef boost::shared_ptr<ShmPublisher> ShmPubPtr;
+
+#endif /* SHMPUBLISHER_H_ */
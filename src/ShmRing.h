@@ -0,0 +1,228 @@
+/*!
+ * @file ShmRing.h 共享内存新文件通知环形缓冲区: 内存布局与读取接口
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 单生产者多消费者(SPMC)广播环: ftserver写入, 同机数据处理进程读取
+ * - 本文件仅依赖C++11与POSIX, 数据处理软件直接包含即可使用, 无需链接
+ * - 每个槽位带序号: 写入期间为奇数, 完成后为2*(seq+1). 读者依据序号检测覆盖(overrun)
+ * - 读者以只读方式映射共享内存, 不影响写入者与其它读者
+ * - 读者可忙等待获取最低延迟, 或经futex休眠等待
+ * @note
+ * 使用示例:
+ * ShmRingReader reader;
+ * shm_fileinfo info;
+ * if (reader.Open("/ftserver_notify")) {
+ *     while (1) {
+ *         while (reader.Next(info)) process(info);
+ *         reader.Wait(1000);
+ *     }
+ * }
+ */
+
+#ifndef SHMRING_H_
+#define SHMRING_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHMRING_MAGIC	0x474E5253	//< 共享内存起始标志: SRNG
+#define SHMRING_VERSION	1			//< 内存布局版本
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+		"shared memory ring requires lock-free atomics");
+
+struct shm_fileinfo {// 新文件通知
+	int64_t filesize;	//< 文件大小, 量纲: 字节
+	int64_t tmpublish;	//< 发布时间, 量纲: 纳秒, CLOCK_REALTIME
+	char gid[16];		//< 组标志
+	char uid[16];		//< 单元标志
+	char cid[16];		//< 相机标志
+	char imgtype[24];	//< 图像类型. 未知时为空
+	char tmobs[32];		//< 观测时间
+	char subpath[256];	//< 文件目录
+	char filename[160];	//< 文件名称
+};
+
+struct alignas(64) shm_slot {// 环形缓冲区槽位
+	std::atomic<uint64_t> seq;	//< 槽位序号. 0: 未写入; 奇数: 写入中; 2*(seq+1): 序号seq的通知
+	shm_fileinfo info;			//< 通知
+};
+
+struct alignas(64) shm_ring_head {// 共享内存头
+	uint32_t magic;		//< 起始标志
+	uint32_t version;	//< 内存布局版本
+	uint32_t nslot;		//< 槽位数量
+	uint32_t slotsize;	//< 槽位长度, 量纲: 字节
+	alignas(64) std::atomic<uint64_t> head;	//< 下一条通知的序号, 即已发布通知数量
+	alignas(64) std::atomic<uint32_t> wake;	//< futex等待字: 每次发布后加1
+};
+
+/*!
+ * @brief 计算共享内存长度
+ * @param nslot 槽位数量
+ */
+inline size_t shm_ring_size(uint32_t nslot) {
+	return sizeof(shm_ring_head) + size_t(nslot) * sizeof(shm_slot);
+}
+
+/*!
+ * @brief 读取当前时间, 量纲: 纳秒
+ */
+inline int64_t shm_ring_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+class ShmRingReader {
+public:
+	ShmRingReader() {
+		base_ = NULL;
+		size_ = 0;
+		next_ = 0;
+		lost_ = 0;
+	}
+
+	virtual ~ShmRingReader() {
+		Close();
+	}
+
+protected:
+	void *base_;		//< 共享内存映射地址
+	size_t size_;		//< 共享内存长度
+	uint64_t next_;		//< 下一条待读取通知的序号
+	uint64_t lost_;		//< 因覆盖丢失的通知数量
+
+public:
+	/*!
+	 * @brief 打开共享内存
+	 * @param name 共享内存名称
+	 * @return
+	 * 打开结果. 打开后从最新的通知开始读取
+	 */
+	bool Open(const char *name) {
+		struct stat st;
+		int fd;
+
+		Close();
+		if ((fd = shm_open(name, O_RDONLY, 0)) < 0) return false;
+		if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(shm_ring_head)) {
+			size_ = st.st_size;
+			if ((base_ = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) base_ = NULL;
+		}
+		close(fd);
+		if (base_ && (head()->magic != SHMRING_MAGIC || head()->version != SHMRING_VERSION
+				|| head()->slotsize != sizeof(shm_slot) || shm_ring_size(head()->nslot) > size_))
+			Close();
+		if (!base_) return false;
+		next_ = head()->head.load(std::memory_order_acquire);
+		return true;
+	}
+
+	/*!
+	 * @brief 关闭共享内存
+	 */
+	void Close() {
+		if (base_) munmap(base_, size_);
+		base_ = NULL;
+		size_ = 0;
+	}
+
+	/*!
+	 * @brief 读取下一条通知
+	 * @param info 通知
+	 * @return
+	 * 读取到通知时返回true
+	 * @note
+	 * 读取速度落后于写入超过一圈时, 跳过被覆盖的通知并计入Lost()
+	 */
+	bool Next(shm_fileinfo &info) {
+		if (!base_) return false;
+
+		shm_ring_head *hdr = head();
+		uint64_t last = hdr->head.load(std::memory_order_acquire), s1, s2;
+		shm_slot *slot;
+
+		while (next_ < last) {
+			if (last - next_ > hdr->nslot) {// 落后超过一圈
+				lost_ += last - next_ - hdr->nslot;
+				next_  = last - hdr->nslot;
+			}
+			slot = slots() + next_ % hdr->nslot;
+			s1 = slot->seq.load(std::memory_order_acquire);
+			memcpy(&info, &slot->info, sizeof(info));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			s2 = slot->seq.load(std::memory_order_relaxed);
+			if (s1 == s2 && s1 == 2 * (next_ + 1)) {
+				++next_;
+				return true;
+			}
+			// 读取期间槽位被覆盖
+			++lost_;
+			++next_;
+			last = hdr->head.load(std::memory_order_acquire);
+		}
+		return false;
+	}
+
+	/*!
+	 * @brief 等待新的通知
+	 * @param timeout 超时时间, 量纲: 毫秒
+	 * @param spin    休眠前忙等待时间, 量纲: 微秒. 忙等待期间通知延迟最低
+	 * @return
+	 * 有新的通知时返回true
+	 */
+	bool Wait(int timeout, int spin = 50) {
+		if (!base_) return false;
+
+		shm_ring_head *hdr = head();
+		int64_t until = shm_ring_now() + int64_t(spin) * 1000;
+		uint32_t wake;
+
+		do {
+			if (hdr->head.load(std::memory_order_acquire) > next_) return true;
+		} while (shm_ring_now() < until);
+
+		wake = hdr->wake.load(std::memory_order_acquire);
+		if (hdr->head.load(std::memory_order_acquire) > next_) return true;
+		struct timespec ts;
+		ts.tv_sec  = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000L;
+		syscall(SYS_futex, &hdr->wake, FUTEX_WAIT, wake, &ts, NULL, 0);
+		return hdr->head.load(std::memory_order_acquire) > next_;
+	}
+
+	/*!
+	 * @brief 查看因覆盖丢失的通知数量
+	 */
+	uint64_t Lost() const {
+		return lost_;
+	}
+
+	/*!
+	 * @brief 查看尚未读取的通知数量
+	 */
+	uint64_t Pending() const {
+		return base_ ? head()->head.load(std::memory_order_acquire) - next_ : 0;
+	}
+
+protected:
+	shm_ring_head *head() const {
+		return (shm_ring_head*) base_;
+	}
+
+	shm_slot *slots() const {
+		return (shm_slot*) ((char*) base_ + sizeof(shm_ring_head));
+	}
+};
+
+#endif /* SHMRING_H_ */
@@ -0,0 +1,194 @@
+/*!
+ * @file StorageReclaimer.cpp 存储空间持续回收定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind/bind.hpp>
+#include "StorageReclaimer.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+namespace fs = boost::filesystem;
+using namespace boost::placeholders;
+
+#define IOPRIO_CLASS_SHIFT	13
+#define IOPRIO_CLASS_IDLE	3
+#define IOPRIO_WHO_PROCESS	1
+
+#define RECLAIM_PERIOD		60			// 定时检查周期, 量纲: 秒
+#define RECLAIM_MINWAKE		(256LL << 20)	// 提前检查的最小写盘字节数
+#define RECLAIM_BATCH		256			// 按批次删除时, 每批最多文件数量
+
+StorageReclaimer::StorageReclaimer(const std::vector<string> &roots, FileIndexPtr index, DelEnginePtr engine,
+		int64_t low, int64_t high, int retain, int64_t rate) {
+	roots_    = roots;
+	index_    = index;
+	engine_   = engine;
+	low_      = low;
+	high_     = high > low ? high : low;
+	retain_   = retain > 0 ? retain : 1;
+	rate_     = rate > 0 ? rate : 0;
+	written_  = 0;
+	wakeup_   = RECLAIM_MINWAKE;
+}
+
+StorageReclaimer::~StorageReclaimer() {
+	Stop();
+}
+
+void StorageReclaimer::Start(const RemovedSlot &slot) {
+	cbremoved_ = slot;
+	engine_->RegisterDone(boost::bind(&StorageReclaimer::tree_removed, this, _1));
+	thrd_.reset(new boost::thread(boost::bind(&StorageReclaimer::thread_reclaim, this)));
+}
+
+void StorageReclaimer::Stop() {
+	if (thrd_.unique()) {
+		thrd_->interrupt();
+		thrd_->join();
+		thrd_.reset();
+	}
+}
+
+void StorageReclaimer::Written(int64_t n) {
+	if (written_.fetch_add(n, std::memory_order_relaxed) + n >= wakeup_.load(std::memory_order_relaxed))
+		cv_.notify_one();
+}
+
+void StorageReclaimer::Demand(const string &root, int64_t bytes) {
+	mutex_lock lck(mtx_);
+	int64_t &x = demand_[root];
+	bool raised = bytes > x;
+
+	x = bytes;
+	if (raised) cv_.notify_one();
+}
+
+void StorageReclaimer::thread_reclaim() {
+	// 回收线程使用空闲I/O优先级, 仅在磁盘空闲时执行删除
+	if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, syscall(SYS_gettid), IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT))
+		_gLog.Write(LOG_WARN, "StorageReclaimer", "failed to set idle I/O priority. %s", strerror(errno));
+	for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {
+		_gLog.Write("reclaims <%s> below %lld GB free up to %lld GB, keeps %d nights, %lld GB indexed",
+				it->c_str(), (long long) (low_ >> 30), (long long) (high_ >> 30), retain_,
+				(long long) (index_->Used(*it) >> 30));
+	}
+
+	while(1) {
+		int64_t margin(-1);
+		written_ = 0;
+		for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {
+			mutex_lock lck(mtx_);
+			int64_t demand = demand_[*it];
+			lck.unlock();
+			int64_t low  = demand > low_ ? demand : low_;
+			int64_t high = demand > high_ ? demand : high_;
+			int64_t avail = available(*it);
+
+			if (avail >= 0 && avail < low) {
+				_gLog.Write("Cleaning <%s> for LocalStorage, %lld GB free, %lld GB wanted", it->c_str(),
+						(long long) (avail >> 30), (long long) (high >> 30));
+				int64_t freed = reclaim(*it, high);
+				avail = available(*it);
+				_gLog.Write("removed %lld MB, free capacity of <%s> is %lld GB",
+						(long long) (freed >> 20), it->c_str(), (long long) (avail >> 30));
+				if (avail >= 0 && avail < low)
+					_gLog.Write(LOG_WARN, "StorageReclaimer", "free capacity of <%s> stays below %lld GB, no more files to remove",
+							it->c_str(), (long long) (low >> 30));
+			}
+			if (avail >= 0 && (margin < 0 || avail - low < margin)) margin = avail > low ? avail - low : 0;
+		}
+		update_wakeup(margin);
+
+		mutex_lock lck(mtx_);
+		if (written_.load(std::memory_order_relaxed) < wakeup_.load(std::memory_order_relaxed))
+			cv_.wait_for(lck, boost::chrono::seconds(RECLAIM_PERIOD));
+	}
+}
+
+int64_t StorageReclaimer::available(const string &root) {
+	struct statvfs st;
+	if (statvfs(root.c_str(), &st)) return -1;
+	return int64_t(st.f_bavail) * st.f_frsize;
+}
+
+void StorageReclaimer::update_wakeup(int64_t margin) {
+	// 写入余量的一半后提前检查, 使检查频度随余量减少而增加
+	margin /= 2;
+	wakeup_ = margin > RECLAIM_MINWAKE ? margin : RECLAIM_MINWAKE;
+}
+
+int64_t StorageReclaimer::reclaim(const string &root, int64_t target) {
+	std::vector<FileIndex::entry> files;
+	std::vector<string> paths;
+	FileIndex::entry x;
+	int mjd_now = second_clock::local_time().date().modjulian_day();
+	int64_t freed(0), avail, need, bytes;
+	ptime tmstart = microsec_clock::universal_time();
+
+	while (index_->Oldest(root, x) && (x.night < 0 || mjd_now - x.night > retain_)) {
+		need = (avail = available(root)) < 0 ? target : target - avail;
+		if (need <= 0) break;
+
+		// 最早文件所在观测夜目录的文件总量不超过缺口时, 删除整个目录树
+		string top = x.relpath.substr(0, x.relpath.find('/'));
+		string tree = (fs::path(x.root) / top).string();
+		int night = top.size() < x.relpath.size() ? night_of_directory(top) : -1;
+		if (night >= 0 && mjd_now - night > retain_ && (bytes = index_->TreeBytes(tree)) <= need) {
+			engine_->Wait(engine_->Submit(tree));	// 由完成回调更新索引
+			freed += bytes;
+		}
+		else {// 否则按批次删除最早的文件, 直至填补缺口
+			index_->Oldest(root, RECLAIM_BATCH, files);
+			paths.clear();
+			bytes = 0;
+			for (std::vector<FileIndex::entry>::iterator it = files.begin(); it != files.end() && bytes < need; ++it) {
+				if (it->night >= 0 && mjd_now - it->night <= retain_) break;
+				paths.push_back((fs::path(it->root) / it->relpath).string());
+				bytes += it->size;
+			}
+			engine_->Unlink(paths);	// 不再跟踪无法删除的文件, 避免阻塞回收
+			for (size_t i = 0; i < paths.size(); ++i) {
+				index_->Remove(files[i].root, files[i].relpath);
+				if (i + 1 == paths.size() || fs::path(paths[i]).parent_path() != fs::path(paths[i + 1]).parent_path())
+					prune_directory(paths[i]);
+			}
+			freed += bytes;
+		}
+
+		if (rate_) {// 按删除字节数限速
+			int64_t due = freed * 1000000 / rate_ - (microsec_clock::universal_time() - tmstart).total_microseconds();
+			if (due > 0) boost::this_thread::sleep_for(boost::chrono::microseconds(due));
+		}
+	}
+	return freed;
+}
+
+void StorageReclaimer::tree_removed(const string &path) {
+	index_->RemoveTree(path);
+	if (!cbremoved_.empty()) cbremoved_(path);
+	prune_directory(path);
+}
+
+void StorageReclaimer::prune_directory(const fs::path &path) {
+	string root;
+
+	for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {// 文件所在盘区
+		string x = boost::trim_right_copy_if(*it, boost::is_any_of("/"));
+		if (path.string().compare(0, x.size() + 1, x + "/") == 0) root = x;
+	}
+	if (root.empty()) return;
+	for (fs::path dir = path.parent_path(); dir.string().size() > root.size(); dir = dir.parent_path()) {
+		if (rmdir(dir.c_str())) break;	// 目录非空
+		if (!cbremoved_.empty()) cbremoved_(dir.string());
+	}
+}
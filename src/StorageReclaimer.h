@@ -0,0 +1,134 @@
+/*!
+ * @file StorageReclaimer.h 存储空间持续回收声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 替代每日正午的集中清理: 可用空间低于低水位时开始回收, 回收至高水位后停止
+ * - 可按容量预测提高盘区的回收目标, 在观测开始前预先回收
+ * - 由写盘字节数驱动检查: 距低水位越近, 检查越频繁
+ * - 按文件索引由旧至新删除, 按字节速率限速. 目录清空后删除目录
+ * - 整个观测夜目录可删除时, 交由删除引擎删除目录树; 否则按批次并行删除最早的文件
+ * - 回收线程使用空闲I/O优先级, 不阻塞写盘
+ */
+
+#ifndef STORAGERECLAIMER_H_
+#define STORAGERECLAIMER_H_
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/filesystem/path.hpp>
+#include "FileIndex.h"
+#include "DeleteEngine.h"
+
+using std::string;
+
+class StorageReclaimer {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param roots   存储盘区根路径
+	 * @param index   已存储文件索引
+	 * @param engine  删除引擎
+	 * @param low     低水位, 量纲: 字节. 可用空间低于该值时开始回收
+	 * @param high    高水位, 量纲: 字节. 回收至可用空间不低于该值
+	 * @param retain  保留天数. 不删除该天数内的观测夜目录
+	 * @param rate    删除速率上限, 量纲: 字节/秒. 0: 不限速
+	 */
+	StorageReclaimer(const std::vector<string> &roots, FileIndexPtr index, DelEnginePtr engine, int64_t low, int64_t high, int retain, int64_t rate);
+	virtual ~StorageReclaimer();
+
+public:
+	// 数据类型
+	typedef boost::function<void (const string &)> RemovedSlot;	//< 目录已删除回调函数
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef boost::shared_ptr<boost::thread> threadptr;
+
+protected:
+	// 成员变量
+	std::vector<string> roots_;	//< 存储盘区根路径
+	std::map<string, int64_t> demand_;	//< 盘区的预期可用空间需求, 量纲: 字节
+	FileIndexPtr index_;	//< 已存储文件索引
+	DelEnginePtr engine_;	//< 删除引擎
+	int64_t low_;		//< 低水位, 量纲: 字节
+	int64_t high_;		//< 高水位, 量纲: 字节
+	int retain_;		//< 保留天数
+	int64_t rate_;		//< 删除速率上限, 量纲: 字节/秒
+	RemovedSlot cbremoved_;	//< 目录已删除回调函数
+	std::atomic<int64_t> written_;	//< 上次检查后的写盘字节数
+	std::atomic<int64_t> wakeup_;	//< 写盘字节数达到该值时提前检查
+	boost::mutex mtx_;	//< 互斥锁: 条件变量
+	boost::condition_variable cv_;	//< 条件变量: 需要检查可用空间
+	threadptr thrd_;	//< 线程: 回收存储空间
+
+public:
+	// 接口
+	/*!
+	 * @brief 启动回收线程
+	 * @param slot 目录已删除回调函数
+	 * @note
+	 * 在删除引擎Resume()之前调用, 以便继续的任务完成后更新索引
+	 */
+	void Start(const RemovedSlot &slot);
+	/*!
+	 * @brief 停止回收线程
+	 */
+	void Stop();
+	/*!
+	 * @brief 累计写盘字节数
+	 * @param n 新写盘字节数
+	 * @note
+	 * 仅原子累加, 可在写盘线程中调用
+	 */
+	void Written(int64_t n);
+	/*!
+	 * @brief 设置盘区的预期可用空间需求
+	 * @param root  存储盘区
+	 * @param bytes 可用空间需求, 量纲: 字节. 大于低水位时, 可用空间低于该值即开始回收. 0: 取消
+	 */
+	void Demand(const string &root, int64_t bytes);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 线程: 检查可用空间, 低于低水位时回收
+	 */
+	void thread_reclaim();
+	/*!
+	 * @brief 查看盘区的可用空间
+	 * @return
+	 * 可用空间, 量纲: 字节. 失败时返回-1
+	 */
+	int64_t available(const string &root);
+	/*!
+	 * @brief 由旧至新删除盘区中保留天数之前的文件, 直至可用空间不低于目标
+	 * @param root   存储盘区
+	 * @param target 目标可用空间, 量纲: 字节
+	 * @return
+	 * 已删除字节数
+	 */
+	int64_t reclaim(const string &root, int64_t target);
+	/*!
+	 * @brief 删除引擎回调: 目录树已删除, 更新索引并删除空的上级目录
+	 */
+	void tree_removed(const string &path);
+	/*!
+	 * @brief 由文件所在目录向上删除空目录, 直至盘区根路径
+	 * @param path 已删除文件路径
+	 */
+	void prune_directory(const boost::filesystem::path &path);
+	/*!
+	 * @brief 按上次检查的最小余量更新提前检查阈值
+	 * @param margin 各盘区可用空间与回收阈值之差的最小值, 量纲: 字节
+	 */
+	void update_wakeup(int64_t margin);
+};
+typedef boost::shared_ptr<StorageReclaimer> ReclaimerPtr;
+
+#endif /* STORAGERECLAIMER_H_ */
@@ -0,0 +1,208 @@
+/*!
+ * @file TierMigrator.cpp 分层存储迁移定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind/bind.hpp>
+#include "TierMigrator.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+namespace fs = boost::filesystem;
+
+#define IOPRIO_CLASS_SHIFT	13
+#define IOPRIO_CLASS_BE		2
+#define IOPRIO_WHO_PROCESS	1
+
+#define MIGRATE_PERIOD		10			// 定时检查周期, 量纲: 秒
+#define MIGRATE_BATCH		64			// 每次查看的最早文件数量
+#define MIGRATE_CHUNK		(64LL << 20)	// 单次复制的最大字节数
+#define MIGRATE_BUFFER		(4 << 20)	// 不支持copy_file_range()时的读写缓冲区
+#define MIGRATE_WAKE		(1LL << 30)	// 写入着陆盘区该字节数后提前检查
+
+TierMigrator::TierMigrator(const string &landing, FileIndexPtr index, int minage, int64_t minfree) {
+	landing_  = landing;
+	index_    = index;
+	minage_   = minage > 0 ? minage : 0;
+	minfree_  = minfree > 0 ? minfree : 0;
+	written_  = 0;
+}
+
+TierMigrator::~TierMigrator() {
+	Stop();
+}
+
+void TierMigrator::Start(const RemovedSlot &slot, const MovedSlot &moved) {
+	cbremoved_ = slot;
+	cbmoved_   = moved;
+	thrd_.reset(new boost::thread(boost::bind(&TierMigrator::thread_migrate, this)));
+}
+
+void TierMigrator::Stop() {
+	if (thrd_.unique()) {
+		thrd_->interrupt();
+		thrd_->join();
+		thrd_.reset();
+	}
+}
+
+const string &TierMigrator::Landing() {
+	return landing_;
+}
+
+void TierMigrator::SetTarget(const string &root) {
+	mutex_lock lck(mtx_);
+	target_ = root;
+	cv_.notify_one();
+}
+
+void TierMigrator::Written(int64_t n) {
+	mutex_lock lck(mtx_);
+	if ((written_ += n) >= MIGRATE_WAKE) cv_.notify_one();
+}
+
+void TierMigrator::thread_migrate() {
+	std::vector<FileIndex::entry> files;
+	int64_t nfile(0), bytes(0);
+	ptime tmlog = second_clock::universal_time();
+
+	// 迁移线程使用最低的尽力而为I/O优先级, 让位于着陆盘区写盘与数据处理读取
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, syscall(SYS_gettid), (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 7);
+	_gLog.Write("migrates files from <%s> after %d seconds, or below %lld GB free", landing_.c_str(),
+			minage_, (long long) (minfree_ >> 30));
+
+	while(1) {
+		mutex_lock lck(mtx_);
+		string target = target_;
+		written_ = 0;
+		lck.unlock();
+
+		int nmoved(0);
+		bool wait(false);
+		index_->Oldest(landing_, MIGRATE_BATCH, files);
+		for (std::vector<FileIndex::entry>::iterator it = files.begin(); it != files.end() && !target.empty() && !wait; ++it) {
+			int64_t avail = available();
+			int rc = migrate(*it, target, avail >= 0 && avail < minfree_);
+			if (rc == 0) {
+				++nmoved;
+				++nfile;
+				bytes += it->size;
+			}
+			else wait = true;	// 未达到驻留时间或失败, 等待下次检查
+			boost::this_thread::interruption_point();
+		}
+		if ((second_clock::universal_time() - tmlog).total_seconds() >= 600 && nfile) {
+			_gLog.Write("migrated %lld files, %lld MB to <%s>", (long long) nfile, (long long) (bytes >> 20), target.c_str());
+			tmlog = second_clock::universal_time();
+			nfile = bytes = 0;
+		}
+
+		if (nmoved == 0 || wait) {
+			lck.lock();
+			if (written_ < MIGRATE_WAKE) cv_.wait_for(lck, boost::chrono::seconds(MIGRATE_PERIOD));
+		}
+	}
+}
+
+int TierMigrator::migrate(const FileIndex::entry &x, const string &target, bool force) {
+	string src = (fs::path(landing_) / x.relpath).string();
+	string dst = (fs::path(target) / x.relpath).string();
+	string tmp = dst + ".part";
+	struct stat st;
+	int fdin, fdout;
+
+	if ((fdin = open(src.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+		if (errno != ENOENT) {
+			_gLog.Write(LOG_WARN, "TierMigrator", "failed to open <%s>. %s", src.c_str(), strerror(errno));
+			return -1;
+		}
+		index_->Remove(landing_, x.relpath);	// 文件已不存在
+		return 0;
+	}
+	if (fstat(fdin, &st) || (!force && time(NULL) - st.st_mtime < minage_)) {
+		close(fdin);
+		return 1;
+	}
+
+	boost::system::error_code ec;
+	fs::create_directories(fs::path(dst).parent_path(), ec);
+	if ((fdout = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+		_gLog.Write(LOG_WARN, "TierMigrator", "failed to create <%s>. %s", tmp.c_str(), strerror(errno));
+		close(fdin);
+		return -1;
+	}
+	posix_fadvise(fdin, 0, 0, POSIX_FADV_SEQUENTIAL);
+	bool ok = CopyData(fdin, fdout, st.st_size) && fdatasync(fdout) == 0;
+	if (!ok) _gLog.Write(LOG_WARN, "TierMigrator", "failed to copy <%s> to <%s>. %s", src.c_str(), tmp.c_str(), strerror(errno));
+	struct timespec tms[2] = { st.st_atim, st.st_mtim };	// 保留修改时间, 供扫描重建索引
+	futimens(fdout, tms);
+	close(fdout);
+	close(fdin);
+	if (ok && rename(tmp.c_str(), dst.c_str())) {
+		_gLog.Write(LOG_WARN, "TierMigrator", "failed to rename <%s>. %s", tmp.c_str(), strerror(errno));
+		ok = false;
+	}
+	if (!ok) {
+		unlink(tmp.c_str());
+		return -1;
+	}
+
+	// 先更新索引再删除源文件: 中断后至多在着陆盘区残留副本, 不丢失索引记录
+	if (index_->Move(landing_, x.relpath, target) && !cbmoved_.empty()) cbmoved_(x, target, "");
+	unlink(src.c_str());
+	// 不删除当前观测夜的目录, 避免与写盘创建文件冲突
+	int tonight = FileIndex::night_of_time(to_iso_extended_string(second_clock::universal_time()));
+	if (x.night >= 0 && x.night < tonight) prune_directory(src);
+	return 0;
+}
+
+bool TierMigrator::CopyData(int fdin, int fdout, int64_t size) {
+	boost::shared_array<char> buff;
+	ssize_t n;
+
+	while (size > 0) {
+		if (!buff.get()) {
+			n = copy_file_range(fdin, NULL, fdout, NULL, size < MIGRATE_CHUNK ? size : MIGRATE_CHUNK, 0);
+			if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+				buff.reset(new char[MIGRATE_BUFFER]);	// 跨文件系统或内核不支持
+				continue;
+			}
+		}
+		else if ((n = read(fdin, buff.get(), size < MIGRATE_BUFFER ? size : MIGRATE_BUFFER)) > 0) {
+			for (ssize_t off = 0, m; off < n; off += m) {
+				if ((m = write(fdout, buff.get() + off, n - off)) <= 0) return false;
+			}
+		}
+		if (n <= 0) return false;
+		size -= n;
+	}
+	return true;
+}
+
+void TierMigrator::prune_directory(const string &path) {
+	string root = boost::trim_right_copy_if(landing_, boost::is_any_of("/"));
+
+	for (fs::path dir = fs::path(path).parent_path(); dir.string().size() > root.size(); dir = dir.parent_path()) {
+		if (rmdir(dir.c_str())) break;	// 目录非空
+		if (!cbremoved_.empty()) cbremoved_(dir.string());
+	}
+}
+
+int64_t TierMigrator::available() {
+	struct statvfs st;
+	if (statvfs(landing_.c_str(), &st)) return -1;
+	return int64_t(st.f_bavail) * st.f_frsize;
+}
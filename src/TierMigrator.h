@@ -0,0 +1,124 @@
+/*!
+ * @file TierMigrator.h 分层存储迁移声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 相机文件先写入高速着陆盘区(NVMe或tmpfs), 写盘延迟低, 数据处理读取快
+ * - 后台线程按观测时间由旧至新, 将文件迁移至当前容量盘区, 相对路径不变
+ * - 以copy_file_range()执行大块顺序复制, 写入临时文件并同步后改名, 再以单条记录更新索引
+ * - 仅迁移写盘超过最短驻留时间的文件, 避开数据处理的热数据; 着陆盘区可用空间不足时不受该限制
+ * - 更新索引后经回调通知, 由数据库注册更新文件路径
+ */
+
+#ifndef TIERMIGRATOR_H_
+#define TIERMIGRATOR_H_
+
+#include <string>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include "FileIndex.h"
+
+using std::string;
+
+class TierMigrator {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param landing 着陆盘区根路径
+	 * @param index   已存储文件索引
+	 * @param minage  最短驻留时间, 量纲: 秒
+	 * @param minfree 着陆盘区可用空间低于该值时, 不等待驻留时间, 量纲: 字节
+	 */
+	TierMigrator(const string &landing, FileIndexPtr index, int minage, int64_t minfree);
+	virtual ~TierMigrator();
+
+public:
+	// 数据类型
+	typedef boost::function<void (const string &)> RemovedSlot;	//< 目录已删除回调函数
+	/*!
+	 * @brief 文件已迁移回调函数
+	 * 参数: 原文件记录, 新盘区, 容器相对盘区的路径(仅打包时非空)
+	 */
+	typedef boost::function<void (const FileIndex::entry &, const string &, const string &)> MovedSlot;
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef boost::shared_ptr<boost::thread> threadptr;
+
+protected:
+	// 成员变量
+	string landing_;		//< 着陆盘区根路径
+	FileIndexPtr index_;	//< 已存储文件索引
+	int minage_;			//< 最短驻留时间, 量纲: 秒
+	int64_t minfree_;		//< 着陆盘区的最小可用空间, 量纲: 字节
+	RemovedSlot cbremoved_;	//< 目录已删除回调函数
+	MovedSlot cbmoved_;		//< 文件已迁移回调函数
+	boost::mutex mtx_;		//< 互斥锁
+	boost::condition_variable cv_;	//< 条件变量: 更换容量盘区或着陆盘区空间不足
+	string target_;			//< 当前容量盘区
+	int64_t written_;		//< 上次检查后写入着陆盘区的字节数
+	threadptr thrd_;		//< 线程: 迁移文件
+
+public:
+	// 接口
+	/*!
+	 * @brief 启动迁移线程
+	 * @param slot  目录已删除回调函数
+	 * @param moved 文件已迁移回调函数
+	 */
+	void Start(const RemovedSlot &slot, const MovedSlot &moved = MovedSlot());
+	/*!
+	 * @brief 停止迁移线程
+	 */
+	void Stop();
+	/*!
+	 * @brief 查看着陆盘区根路径
+	 */
+	const string &Landing();
+	/*!
+	 * @brief 设置迁移目标容量盘区
+	 */
+	void SetTarget(const string &root);
+	/*!
+	 * @brief 累计写入着陆盘区的字节数. 超出可用空间余量时立即检查
+	 * @param n 新写盘字节数
+	 */
+	void Written(int64_t n);
+	/*!
+	 * @brief 自两个文件的当前位置, 以copy_file_range()复制数据, 不支持时改为读写
+	 * @param fdin  源文件描述符
+	 * @param fdout 目标文件描述符
+	 * @param size  字节数
+	 * @return
+	 * 复制成功
+	 */
+	static bool CopyData(int fdin, int fdout, int64_t size);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 线程: 迁移达到驻留时间的文件
+	 */
+	void thread_migrate();
+	/*!
+	 * @brief 迁移一个文件
+	 * @param x      文件记录
+	 * @param target 容量盘区
+	 * @param force  不检查驻留时间
+	 * @return
+	 * 0: 已迁移; 1: 未达到驻留时间; -1: 失败
+	 */
+	int migrate(const FileIndex::entry &x, const string &target, bool force);
+	/*!
+	 * @brief 由文件所在目录向上删除空目录, 直至着陆盘区根路径
+	 */
+	void prune_directory(const string &path);
+	/*!
+	 * @brief 查看着陆盘区的可用空间
+	 */
+	int64_t available();
+};
+typedef boost::shared_ptr<TierMigrator> MigratorPtr;
+
+#endif /* TIERMIGRATOR_H_ */
@@ -0,0 +1,575 @@
+/*!
+ * @file TileCompressor.cpp FITS分块无损压缩定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <set>
+#include <map>
+#include <boost/algorithm/string.hpp>
+#include <boost/bind/bind.hpp>
+#include "TileCompressor.h"
+
+#define FITS_CARD		80
+#define FITS_BLOCK		2880
+#define RICE_NBLOCK		32		// Rice编码块的像素数量
+#define RICE_FSBITS		4		// 16位数据的编码参数位数
+#define RICE_FSMAX		14		// 16位数据的编码参数上限
+#define RICE_BBITS		16		// 16位数据的原始位数
+#define COMPRESS_CHUNK	8		// 工作线程每次领取的分块数量
+#define COMPRESS_MINGAIN	5	// 压缩后长度减少不足该百分比时保留原始数据
+
+/*!
+ * @brief 按高位在前写入比特流
+ */
+struct bitwriter {
+	unsigned char *p, *end;
+	uint64_t acc;	//< 待输出比特, 低n位有效
+	int n;			//< 待输出比特数量, <8
+	bool full;		//< 缓冲区不足
+
+	bitwriter(unsigned char *out, int cap) : p(out), end(out + cap), acc(0), n(0), full(false) {}
+
+	void put(uint32_t v, int bits) {// bits <= 32
+		if (p + 5 > end) {
+			full = true;
+			return;
+		}
+		acc = (acc << bits) | (bits < 32 ? v & ((1U << bits) - 1) : v);
+		n += bits;
+		while (n >= 8) {
+			n -= 8;
+			*p++ = (unsigned char) (acc >> n);
+		}
+	}
+
+	void zeros(uint32_t count) {// count个0
+		for (; count > 32; count -= 32) put(0, 32);
+		put(0, count);
+	}
+
+	void flush() {
+		if (n > 0 && p < end) *p++ = (unsigned char) (acc << (8 - n));
+		n = 0;
+	}
+};
+
+/*!
+ * @brief 按高位在前读取比特流
+ */
+struct bitreader {
+	const unsigned char *p, *end;
+	uint64_t acc;	//< 已读入比特, 低n位有效
+	int n;			//< 有效比特数量
+	bool over;		//< 超出数据长度
+
+	bitreader(const unsigned char *c, int clen) : p(c), end(c + clen), acc(0), n(0), over(false) {}
+
+	uint32_t get(int bits) {// bits <= 32
+		while (n < bits) {
+			if (p < end) acc = (acc << 8) | *p++;
+			else {
+				acc <<= 8;
+				over = true;
+			}
+			n += 8;
+		}
+		n -= bits;
+		return uint32_t(acc >> n) & (bits < 32 ? (1U << bits) - 1 : ~0U);
+	}
+
+	uint32_t unary() {// 连续0的数量, 并跳过其后的1
+		uint32_t count(0), v;
+		while (1) {
+			if (n == 0) {
+				if (p >= end) {
+					over = true;
+					return count;
+				}
+				acc = *p++;
+				n = 8;
+			}
+			if ((v = uint32_t(acc) & ((1U << n) - 1)) == 0) {
+				count += n;
+				n = 0;
+			}
+			else {
+				int high = 31 - __builtin_clz(v);
+				count += n - 1 - high;
+				n = high;
+				return count;
+			}
+		}
+	}
+};
+
+static double thread_cpu() {
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static int64_t fits_pad(int64_t n) {
+	return (n + FITS_BLOCK - 1) / FITS_BLOCK * FITS_BLOCK;
+}
+
+static string card_keyword(const char *card) {
+	string key(card, 8);
+	boost::trim_right(key);
+	return key;
+}
+
+static string card_string(const char *card) {// 字符串值, 不含引号与尾部空格
+	const char *p = (const char *) memchr(card + 10, '\'', FITS_CARD - 10), *q;
+	if (!p || !(q = (const char *) memchr(p + 1, '\'', card + FITS_CARD - p - 1))) return string();
+	string value(p + 1, q);
+	boost::trim_right(value);
+	return value;
+}
+
+static int64_t big_endian32(const char *p) {
+	const unsigned char *q = (const unsigned char *) p;
+	return (uint32_t(q[0]) << 24) | (uint32_t(q[1]) << 16) | (uint32_t(q[2]) << 8) | q[3];
+}
+
+static void card_raw(string &h, const char *key, const string &value, const char *comment) {
+	char card[FITS_CARD + 1];
+	int n = snprintf(card, sizeof(card), "%-8.8s= %-20s / %s", key, value.c_str(), comment);
+	h.append(card, n < FITS_CARD ? n : FITS_CARD);
+	h.append(FITS_CARD - (n < FITS_CARD ? n : FITS_CARD), ' ');
+}
+
+static void card_int(string &h, const char *key, int64_t value, const char *comment) {
+	char text[32];
+	snprintf(text, sizeof(text), "%20lld", (long long) value);
+	card_raw(h, key, text, comment);
+}
+
+static void card_str(string &h, const char *key, const char *value, const char *comment) {
+	char text[72];
+	snprintf(text, sizeof(text), "'%-8s'", value);
+	card_raw(h, key, text, comment);
+}
+
+static void card_log(string &h, const char *key, bool value, const char *comment) {
+	card_raw(h, key, value ? "                   T" : "                   F", comment);
+}
+
+/*!
+ * @brief 解析主头, 查看图像是否可压缩
+ * @return
+ * 主头长度. 不可压缩时返回-1
+ */
+static int64_t parse_primary(const char *data, int64_t n, int &nx, int &ny) {
+	int bitpix(0), naxis(-1);
+	string key;
+
+	nx = ny = 0;
+	if (n < FITS_BLOCK || strncmp(data, "SIMPLE  =", 9)) return -1;
+	for (int64_t pos = 0; pos + FITS_CARD <= n; pos += FITS_CARD) {
+		const char *card = data + pos;
+		key.assign(card, 8);
+		boost::trim_right(key);
+		if (key == "END") {
+			int64_t hdr = fits_pad(pos + FITS_CARD);
+			int64_t size = int64_t(nx) * ny * 2;
+			if (bitpix != 16 || naxis != 2 || nx <= 0 || ny <= 0) return -1;
+			// 仅压缩单一主图像: 其后没有扩展
+			if (n != hdr + size && n != hdr + fits_pad(size)) return -1;
+			return hdr;
+		}
+		if (card[8] != '=') continue;
+		if (key == "BITPIX") bitpix = atoi(card + 10);
+		else if (key == "NAXIS") naxis = atoi(card + 10);
+		else if (key == "NAXIS1") nx = atoi(card + 10);
+		else if (key == "NAXIS2") ny = atoi(card + 10);
+		else if (key == "ZIMAGE") return -1;	// 已压缩
+	}
+	return -1;
+}
+
+TileCompressor::TileCompressor(int nworker) {
+	job_ = NULL;
+	for (int i = 1; i < nworker; ++i)
+		thrds_.create_thread(boost::bind(&TileCompressor::thread_work, this));
+}
+
+TileCompressor::~TileCompressor() {
+	thrds_.interrupt_all();
+	thrds_.join_all();
+}
+
+bool TileCompressor::Compress(const string &cid, const char *data, int64_t n, boost::shared_array<char> &out,
+		int64_t &outsize) {
+	mutex_lock lckcall(mtxcall_);
+	double cpu = thread_cpu();
+	int nx, ny;
+	int64_t hdr = parse_primary(data, n, nx, ny);
+
+	if (hdr < 0) {
+		account(cid, n, n, 0.0, true);
+		return false;
+	}
+
+	// 并行压缩各行
+	job x;
+	x.data  = data + hdr;
+	x.nx    = nx;
+	x.ny    = ny;
+	x.cap   = (nx / RICE_NBLOCK + 1) * 96 + 16;
+	x.sizes.resize(ny);
+	x.next  = 0;
+	x.done  = 0;
+	x.cpu   = 0.0;
+	boost::shared_array<unsigned char> tiles(new unsigned char[int64_t(x.cap) * ny]);
+	x.out   = tiles.get();
+
+	mutex_lock lck(mtx_);
+	job_ = &x;
+	cvjob_.notify_all();
+	cpu -= thread_cpu();	// 调用线程的压缩耗时计入x.cpu
+	work(lck);
+	cpu += thread_cpu();
+	while (x.done < ny) cvdone_.wait(lck);
+	job_ = NULL;
+	lck.unlock();
+
+	// 组装: 空主HDU + BINTABLE扩展
+	int64_t heap(0);
+	int maxlen(0);
+	for (int i = 0; i < ny; ++i) {
+		if (x.sizes[i] < 0) heap = n;	// 缓冲区不足
+		else {
+			heap += x.sizes[i];
+			if (x.sizes[i] > maxlen) maxlen = x.sizes[i];
+		}
+	}
+
+	string primary, ext;
+	card_log(primary, "SIMPLE", true, "file does conform to FITS standard");
+	card_int(primary, "BITPIX", 8, "number of bits per data pixel");
+	card_int(primary, "NAXIS", 0, "number of data axes");
+	card_log(primary, "EXTEND", true, "FITS dataset may contain extensions");
+	primary.append("END");
+	primary.resize(fits_pad(primary.size()), ' ');
+
+	char tform[32];
+	snprintf(tform, sizeof(tform), "1PB(%d)", maxlen);
+	card_str(ext, "XTENSION", "BINTABLE", "binary table extension");
+	card_int(ext, "BITPIX", 8, "8-bit bytes");
+	card_int(ext, "NAXIS", 2, "2-dimensional binary table");
+	card_int(ext, "NAXIS1", 8, "width of table in bytes");
+	card_int(ext, "NAXIS2", ny, "number of rows in table");
+	card_int(ext, "PCOUNT", heap, "size of special data area");
+	card_int(ext, "GCOUNT", 1, "one data group (required keyword)");
+	card_int(ext, "TFIELDS", 1, "number of fields in each row");
+	card_str(ext, "TTYPE1", "COMPRESSED_DATA", "label for field 1");
+	card_str(ext, "TFORM1", tform, "data format of field: variable length array");
+	card_log(ext, "ZIMAGE", true, "extension contains compressed image");
+	card_log(ext, "ZSIMPLE", true, "file does conform to FITS standard");
+	card_int(ext, "ZBITPIX", 16, "data type of original image");
+	card_int(ext, "ZNAXIS", 2, "dimension of original image");
+	card_int(ext, "ZNAXIS1", nx, "length of original image axis");
+	card_int(ext, "ZNAXIS2", ny, "length of original image axis");
+	card_int(ext, "ZTILE1", nx, "size of tiles to be compressed");
+	card_int(ext, "ZTILE2", 1, "size of tiles to be compressed");
+	card_str(ext, "ZCMPTYPE", "RICE_1", "compression algorithm");
+	card_str(ext, "ZNAME1", "BLOCKSIZE", "compression block size");
+	card_int(ext, "ZVAL1", RICE_NBLOCK, "pixels per block");
+	card_str(ext, "ZNAME2", "BYTEPIX", "bytes per pixel (1, 2, 4, or 8)");
+	card_int(ext, "ZVAL2", 2, "bytes per pixel (1, 2, 4, or 8)");
+	card_log(ext, "ZEXTEND", true, "value of the EXTEND keyword");
+	static const char *structural[] = {"SIMPLE", "BITPIX", "NAXIS", "NAXIS1", "NAXIS2", "EXTEND",
+			"PCOUNT", "GCOUNT", "CHECKSUM", "DATASUM", "END"};
+	std::set<string> skip(structural, structural + sizeof(structural) / sizeof(structural[0]));
+	string key;
+	for (int64_t pos = 0; pos + FITS_CARD <= hdr; pos += FITS_CARD) {// 复制原主头的其它关键字
+		key.assign(data + pos, 8);
+		boost::trim_right(key);
+		if (key == "END") break;
+		if (!skip.count(key)) ext.append(data + pos, FITS_CARD);
+	}
+	ext.append("END");
+	ext.resize(fits_pad(ext.size()), ' ');
+
+	int64_t table = int64_t(ny) * 8;
+	int64_t size = primary.size() + ext.size() + fits_pad(table + heap);
+	bool compressed = heap < n && size * 100 <= n * (100 - COMPRESS_MINGAIN);
+	if (compressed) {
+		out.reset(new char[size]);
+		outsize = size;
+		char *p = out.get();
+		memcpy(p, primary.data(), primary.size());
+		p += primary.size();
+		memcpy(p, ext.data(), ext.size());
+		p += ext.size();
+		unsigned char *desc = (unsigned char *) p;
+		char *pheap = p + table;
+		uint32_t offset(0);
+		for (int i = 0; i < ny; ++i, desc += 8) {// 描述符: 长度与堆偏移, 大端32位
+			uint32_t len = x.sizes[i];
+			desc[0] = len >> 24;
+			desc[1] = len >> 16;
+			desc[2] = len >> 8;
+			desc[3] = len;
+			desc[4] = offset >> 24;
+			desc[5] = offset >> 16;
+			desc[6] = offset >> 8;
+			desc[7] = offset;
+			memcpy(pheap + offset, tiles.get() + int64_t(x.cap) * i, len);
+			offset += len;
+		}
+		memset(pheap + offset, 0, out.get() + outsize - (pheap + offset));
+	}
+	account(cid, n, compressed ? outsize : n, thread_cpu() - cpu + x.cpu, !compressed);
+	return compressed;
+}
+
+void TileCompressor::Stats(statVec &vec) {
+	mutex_lock lck(mtxstat_);
+	vec.clear();
+	for (statMap::iterator it = stats_.begin(); it != stats_.end(); ++it) vec.push_back(it->second);
+	stats_.clear();
+}
+
+int TileCompressor::RiceShort(const int16_t *a, int nx, unsigned char *out, int cap) {
+	uint16_t diff[RICE_NBLOCK];
+	bitwriter w(out, cap);
+	int16_t last = a[0];
+
+	w.put(uint16_t(a[0]), RICE_BBITS);	// 首个像素的原始值
+	for (int i = 0; i < nx && !w.full; i += RICE_NBLOCK) {
+		int nblock = nx - i < RICE_NBLOCK ? nx - i : RICE_NBLOCK;
+		const int16_t *b = a + i;
+		uint32_t sum(0);
+		int fs;
+
+		// 差分并映射为非负数: 无分支, 可向量化
+		for (int j = 0; j < nblock; ++j) {
+			int16_t pd = int16_t(b[j] - (j ? b[j - 1] : last));
+			diff[j] = uint16_t((pd << 1) ^ (pd >> 15));
+		}
+		for (int j = 0; j < nblock; ++j) sum += diff[j];
+		last = b[nblock - 1];
+
+		// 按平均值选择编码参数
+		double dpsum = (double(sum) - (nblock / 2) - 1) / nblock;
+		unsigned psum = dpsum < 0.0 ? 0 : ((unsigned short) dpsum) >> 1;
+		for (fs = 0; psum > 0; ++fs) psum >>= 1;
+
+		if (fs >= RICE_FSMAX) {// 高熵: 原始位
+			w.put(RICE_FSMAX + 1, RICE_FSBITS);
+			for (int j = 0; j < nblock; ++j) w.put(diff[j], RICE_BBITS);
+		}
+		else if (fs == 0 && sum == 0) {// 低熵: 全部相同
+			w.put(0, RICE_FSBITS);
+		}
+		else {// 高位一元编码, 低fs位原样输出
+			w.put(fs + 1, RICE_FSBITS);
+			for (int j = 0; j < nblock; ++j) {
+				uint32_t top = diff[j] >> fs;
+				if (top < 32) w.put(1, top + 1);
+				else {
+					w.zeros(top);
+					w.put(1, 1);
+				}
+				if (fs) w.put(diff[j], fs);
+			}
+		}
+	}
+	w.flush();
+	return w.full ? -1 : int(w.p - out);
+}
+
+bool TileCompressor::RiceDecodeShort(const unsigned char *c, int clen, int16_t *a, int nx) {
+	bitreader r(c, clen);
+	uint16_t last = uint16_t(r.get(RICE_BBITS));
+
+	for (int i = 0; i < nx && !r.over; ) {
+		int fs = int(r.get(RICE_FSBITS)) - 1;
+		int imax = nx - i < RICE_NBLOCK ? nx : i + RICE_NBLOCK;
+
+		if (fs < 0) {// 低熵: 全部相同
+			for (; i < imax; ++i) a[i] = int16_t(last);
+		}
+		else {
+			for (; i < imax; ++i) {
+				uint32_t diff = fs == RICE_FSMAX ? r.get(RICE_BBITS) : (r.unary() << fs) | (fs ? r.get(fs) : 0);
+				last += uint16_t(diff & 1 ? ~(diff >> 1) : diff >> 1);
+				a[i] = int16_t(last);
+			}
+		}
+	}
+	return !r.over;
+}
+
+const char *TileCompressor::ImageHeader(const char *data, int64_t n) {
+	int nx, ny;
+	int64_t hdr = parse_primary(data, n, nx, ny);
+	string key;
+	bool empty(false);
+
+	if (hdr >= 0 || n < FITS_BLOCK || strncmp(data, "SIMPLE  =", 9)) return data;
+	for (int64_t pos = 0; pos + FITS_CARD <= n; pos += FITS_CARD) {// 空主HDU + ZIMAGE扩展
+		key = card_keyword(data + pos);
+		if (key == "NAXIS") empty = atoi(data + pos + 10) == 0;
+		else if (key == "END") {
+			hdr = fits_pad(pos + FITS_CARD);
+			break;
+		}
+	}
+	if (!empty || hdr < 0 || hdr + FITS_BLOCK > n || strncmp(data + hdr, "XTENSION=", 9)) return data;
+	for (int64_t pos = hdr; pos + FITS_CARD <= n; pos += FITS_CARD) {
+		key = card_keyword(data + pos);
+		if (key == "ZIMAGE") return data + hdr;
+		if (key == "END") break;
+	}
+	return data;
+}
+
+bool TileCompressor::Decompress(const char *data, int64_t n, BufPoolPtr pool, boost::shared_array<char> &out,
+		int64_t &outsize) {
+	const char *ext = ImageHeader(data, n);
+	if (ext == data) return false;
+
+	// 解析压缩图像扩展头
+	int64_t naxis1(0), naxis2(0), pcount(0), theap(-1), len(-1);
+	int zbitpix(0), znaxis(0), nx(0), ny(0), ztile1(0), ztile2(1), blocksize(RICE_NBLOCK), bytepix(2);
+	bool zextend(false);
+	string cmptype, tform, key;
+	std::map<string, string> znames;	// ZNAMEi - 名称
+	std::map<string, int> zvals;		// ZVALi - 数值
+	static const char *structural[] = {"XTENSION", "BITPIX", "NAXIS", "NAXIS1", "NAXIS2", "PCOUNT", "GCOUNT",
+			"TFIELDS", "THEAP", "EXTNAME", "CHECKSUM", "DATASUM", "ZIMAGE", "ZSIMPLE", "ZTENSION", "ZBITPIX",
+			"ZNAXIS", "ZNAXIS1", "ZNAXIS2", "ZTILE1", "ZTILE2", "ZCMPTYPE", "ZEXTEND", "ZPCOUNT", "ZGCOUNT",
+			"ZHECKSUM", "ZDATASUM", "ZQUANTIZ", "ZDITHER0", "END"};
+	static const char *prefix[] = {"TTYPE", "TFORM", "TUNIT", "TDIM", "ZNAME", "ZVAL"};
+	std::set<string> skip(structural, structural + sizeof(structural) / sizeof(structural[0]));
+	string cards;
+
+	for (const char *card = ext; card + FITS_CARD <= data + n; card += FITS_CARD) {
+		key = card_keyword(card);
+		if (key == "END") {
+			len = fits_pad(card + FITS_CARD - ext);
+			break;
+		}
+		if      (key == "NAXIS1")   naxis1  = atoll(card + 10);
+		else if (key == "NAXIS2")   naxis2  = atoll(card + 10);
+		else if (key == "PCOUNT")   pcount  = atoll(card + 10);
+		else if (key == "THEAP")    theap   = atoll(card + 10);
+		else if (key == "ZBITPIX")  zbitpix = atoi(card + 10);
+		else if (key == "ZNAXIS")   znaxis  = atoi(card + 10);
+		else if (key == "ZNAXIS1")  nx      = atoi(card + 10);
+		else if (key == "ZNAXIS2")  ny      = atoi(card + 10);
+		else if (key == "ZTILE1")   ztile1  = atoi(card + 10);
+		else if (key == "ZTILE2")   ztile2  = atoi(card + 10);
+		else if (key == "ZEXTEND")  zextend = boost::trim_copy(string(card + 10, 20)) == "T";
+		else if (key == "ZCMPTYPE") cmptype = card_string(card);
+		else if (key == "TFORM1")   tform   = card_string(card);
+		else if (key.compare(0, 5, "ZNAME") == 0) znames[key.substr(5)] = card_string(card);
+		else if (key.compare(0, 4, "ZVAL") == 0)  zvals[key.substr(4)]  = atoi(card + 10);
+
+		if (skip.count(key)) continue;
+		bool copy(true);
+		for (size_t i = 0; copy && i < sizeof(prefix) / sizeof(prefix[0]); ++i) {
+			size_t m = strlen(prefix[i]);
+			copy = !(key.compare(0, m, prefix[i]) == 0 && key.find_first_not_of("0123456789", m) == string::npos);
+		}
+		if (copy) cards.append(card, FITS_CARD);
+	}
+	for (std::map<string, string>::iterator it = znames.begin(); it != znames.end(); ++it) {
+		if (!zvals.count(it->first)) continue;
+		if      (it->second == "BLOCKSIZE") blocksize = zvals[it->first];
+		else if (it->second == "BYTEPIX")   bytepix   = zvals[it->first];
+	}
+	if (len < 0 || cmptype != "RICE_1" || zbitpix != 16 || znaxis != 2 || nx <= 0 || ny <= 0 || ztile1 != nx
+			|| ztile2 != 1 || blocksize != RICE_NBLOCK || bytepix != 2 || tform.compare(0, 3, "1PB")
+			|| naxis2 != ny || naxis1 < 8)
+		return false;
+
+	const char *table = ext + len;
+	const char *heap  = table + (theap < 0 ? naxis1 * naxis2 : theap);
+	if (table + naxis1 * naxis2 > data + n || heap + pcount > data + n) return false;
+
+	// 重建主头
+	string primary;
+	card_log(primary, "SIMPLE", true, "file does conform to FITS standard");
+	card_int(primary, "BITPIX", 16, "number of bits per data pixel");
+	card_int(primary, "NAXIS", 2, "number of data axes");
+	card_int(primary, "NAXIS1", nx, "length of data axis 1");
+	card_int(primary, "NAXIS2", ny, "length of data axis 2");
+	if (zextend) card_log(primary, "EXTEND", true, "FITS dataset may contain extensions");
+	primary += cards;
+	primary.append("END");
+	primary.resize(fits_pad(primary.size()), ' ');
+
+	int64_t size = primary.size() + fits_pad(int64_t(nx) * ny * 2);
+	boost::shared_array<char> buff = pool.use_count() ? pool->Alloc(size) : boost::shared_array<char>(new char[size]);
+	char *p = buff.get() + primary.size();
+	std::vector<int16_t> row(nx);
+
+	memcpy(buff.get(), primary.data(), primary.size());
+	for (int i = 0; i < ny; ++i, table += naxis1) {
+		int64_t clen = big_endian32(table), offset = big_endian32(table + 4);
+		if (offset + clen > pcount || !RiceDecodeShort((const unsigned char *) heap + offset, int(clen), &row[0], nx))
+			return false;
+		for (int j = 0; j < nx; ++j, p += 2) {// 大端
+			p[0] = char(uint16_t(row[j]) >> 8);
+			p[1] = char(row[j]);
+		}
+	}
+	memset(p, 0, buff.get() + size - p);
+	out     = buff;
+	outsize = size;
+	return true;
+}
+
+void TileCompressor::thread_work() {
+	mutex_lock lck(mtx_);
+
+	while(1) {
+		while (!job_ || job_->next >= job_->ny) cvjob_.wait(lck);
+		work(lck);
+	}
+}
+
+void TileCompressor::work(mutex_lock &lck) {
+	std::vector<int16_t> row;
+
+	while (job_ && job_->next < job_->ny) {
+		job *x = job_;
+		int first = x->next;
+		int last  = first + COMPRESS_CHUNK < x->ny ? first + COMPRESS_CHUNK : x->ny;
+		x->next = last;
+		lck.unlock();
+
+		double t0 = thread_cpu();
+		row.resize(x->nx);
+		for (int k = first; k < last; ++k) {
+			const unsigned char *src = (const unsigned char *) x->data + int64_t(k) * x->nx * 2;
+			for (int i = 0; i < x->nx; ++i) row[i] = int16_t((src[2 * i] << 8) | src[2 * i + 1]);	// 大端
+			x->sizes[k] = RiceShort(&row[0], x->nx, x->out + int64_t(k) * x->cap, x->cap);
+		}
+		double t1 = thread_cpu();
+
+		lck.lock();
+		x->cpu  += t1 - t0;
+		x->done += last - first;
+		if (x->done >= x->ny) cvdone_.notify_all();
+	}
+}
+
+void TileCompressor::account(const string &cid, int64_t in, int64_t out, double cpu, bool raw) {
+	mutex_lock lck(mtxstat_);
+	camstat &x = stats_[cid];
+
+	x.cid = cid;
+	++x.nfile;
+	if (raw) ++x.nraw;
+	x.bytesin  += in;
+	x.bytesout += out;
+	x.cpu      += cpu;
+}
@@ -0,0 +1,150 @@
+/*!
+ * @file TileCompressor.h FITS分块无损压缩声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 将16位二维主图像按行分块, 以Rice算法无损压缩, 输出与fpack兼容的分块压缩FITS
+ * - 压缩结果为空主HDU与BINTABLE扩展(ZIMAGE = T, ZCMPTYPE = 'RICE_1'), cfitsio、funpack等工具可直接读取
+ * - 各分块由工作线程池并行压缩. 差分与映射为无分支循环, 由编译器向量化
+ * - 图像不符合条件或压缩收益不足时保留原始数据
+ * - 按相机统计压缩比与CPU耗时
+ * - 解压客户端以RICE_1按行分块压缩的16位图像(fpack默认格式), 恢复主图像
+ */
+
+#ifndef TILECOMPRESSOR_H_
+#define TILECOMPRESSOR_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include "BufferPool.h"
+
+using std::string;
+
+class TileCompressor {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param nworker 工作线程数量. 调用线程也参与压缩
+	 */
+	TileCompressor(int nworker);
+	virtual ~TileCompressor();
+
+public:
+	// 数据类型
+	struct camstat {// 相机统计
+		string cid;			//< 相机标志
+		int64_t nfile;		//< 文件数量
+		int64_t nraw;		//< 保留原始数据的文件数量
+		int64_t bytesin;	//< 原始字节数
+		int64_t bytesout;	//< 写盘字节数
+		double cpu;			//< CPU耗时, 量纲: 秒
+	};
+	typedef std::vector<camstat> statVec;
+
+protected:
+	typedef boost::unique_lock<boost::mutex> mutex_lock;
+	typedef std::map<string, camstat> statMap;
+
+	struct job {// 压缩任务
+		const char *data;	//< 图像数据, 大端字节序
+		int nx, ny;			//< 图像尺寸. 每行一个分块
+		int cap;			//< 每个分块的输出容量, 量纲: 字节
+		unsigned char *out;	//< 输出缓冲区, ny个分块
+		std::vector<int> sizes;	//< 各分块的压缩长度. <0: 失败
+		int next;			//< 下一个待压缩分块
+		int done;			//< 已完成分块数量
+		double cpu;			//< CPU耗时, 量纲: 秒
+	};
+
+protected:
+	// 成员变量
+	boost::mutex mtxcall_;	//< 互斥锁: 串行执行压缩调用
+	boost::mutex mtx_;		//< 互斥锁: 任务
+	boost::condition_variable cvjob_;	//< 条件变量: 新任务
+	boost::condition_variable cvdone_;	//< 条件变量: 任务完成
+	job *job_;				//< 当前任务
+	boost::thread_group thrds_;	//< 工作线程
+	boost::mutex mtxstat_;	//< 互斥锁: 统计
+	statMap stats_;			//< 各相机统计
+
+public:
+	// 接口
+	/*!
+	 * @brief 压缩FITS文件
+	 * @param cid     相机标志
+	 * @param data    文件数据
+	 * @param n       文件长度, 量纲: 字节
+	 * @param out     压缩后的文件数据
+	 * @param outsize 压缩后的文件长度, 量纲: 字节
+	 * @return
+	 * 已压缩. 返回false时保留原始数据
+	 */
+	bool Compress(const string &cid, const char *data, int64_t n, boost::shared_array<char> &out, int64_t &outsize);
+	/*!
+	 * @brief 查看并清除各相机统计
+	 */
+	void Stats(statVec &vec);
+	/*!
+	 * @brief 以Rice算法压缩一个分块, 与cfitsio的fits_rcomp_short()格式一致
+	 * @param a     像素
+	 * @param nx    像素数量
+	 * @param out   输出缓冲区
+	 * @param cap   输出缓冲区容量, 量纲: 字节
+	 * @return
+	 * 压缩长度. 缓冲区不足时返回-1
+	 */
+	static int RiceShort(const int16_t *a, int nx, unsigned char *out, int cap);
+	/*!
+	 * @brief 解码一个Rice压缩分块, 与cfitsio的fits_rdecomp_short()格式一致
+	 * @param c    压缩数据
+	 * @param clen 压缩数据长度, 量纲: 字节
+	 * @param a    像素
+	 * @param nx   像素数量
+	 * @return
+	 * 解码成功
+	 */
+	static bool RiceDecodeShort(const unsigned char *c, int clen, int16_t *a, int nx);
+	/*!
+	 * @brief 解压分块压缩FITS, 恢复为主图像
+	 * @param data    压缩文件数据
+	 * @param n       压缩文件长度, 量纲: 字节
+	 * @param pool    缓冲区池. 为空时直接分配
+	 * @param out     解压后的文件数据
+	 * @param outsize 解压后的文件长度, 量纲: 字节
+	 * @return
+	 * 解压成功. 仅支持16位二维图像、按行分块、RICE_1算法
+	 */
+	static bool Decompress(const char *data, int64_t n, BufPoolPtr pool, boost::shared_array<char> &out,
+			int64_t &outsize);
+	/*!
+	 * @brief 查看图像关键字所在的头
+	 * @param data 文件数据
+	 * @param n    文件长度, 量纲: 字节
+	 * @return
+	 * 分块压缩FITS返回压缩图像扩展头, 否则返回主头
+	 */
+	static const char *ImageHeader(const char *data, int64_t n);
+
+protected:
+	// 功能
+	/*!
+	 * @brief 线程: 执行分块压缩
+	 */
+	void thread_work();
+	/*!
+	 * @brief 领取并压缩当前任务的分块, 直至没有待压缩分块
+	 * @param lck 已锁定mtx_. 压缩期间解锁, 返回时仍锁定
+	 */
+	void work(mutex_lock &lck);
+	/*!
+	 * @brief 记录相机统计
+	 */
+	void account(const string &cid, int64_t in, int64_t out, double cpu, bool raw);
+};
+typedef boost::shared_ptr<TileCompressor> CompressorPtr;
+
+#endif /* TILECOMPRESSOR_H_ */
@@ -4,6 +4,7 @@
  * @date 2017-10-29
  */
 #include <algorithm>
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -23,10 +24,67 @@ TransferAgent::~TransferAgent() {
 }
 
 bool TransferAgent::StartService() {
+	/* 创建文件缓冲区池 */
+	if (param_.bBufPool) bufpool_ = make_bufpool(size_t(param_.maxBufPool) << 20, param_.bHugePage);
 	/* 创建文件存储接口 */
 	fwptr_ = make_filewritter();
-	fwptr_->SetDatabase(param_.bDB, param_.urlDB.c_str());
-	fwptr_->UpdateStorage(param_.pathStorage.c_str());
+	fwptr_->SetDatabaseReference(param_.bRefDB, param_.keywordsDB.c_str(), param_.bUploadDB,
+			int64_t(param_.rateUploadDB) << 20);
+	fwptr_->SetDatabase(param_.bDB, param_.urlDB.c_str(), param_.workerDB, param_.queueDB, param_.outboxDB.c_str());
+	fwptr_->SetDatabaseTimeout(param_.tmConnectDB, param_.tmTotalDB, param_.failmaxDB);
+	fwptr_->SetDatabaseBatch(param_.urlBatchDB.c_str(), param_.batchDB, param_.windowDB);
+	boost::split(roots_, param_.pathStorage, boost::is_any_of(","), boost::token_compress_on);
+	for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ) {
+		boost::trim(*it);
+		if (it->empty()) it = roots_.erase(it);
+		else ++it;
+	}
+	if (roots_.empty()) {
+		_gLog.Write(LOG_FAULT, NULL, "no storage defined");
+		return false;
+	}
+	active_ = find_storage();
+	fwptr_->UpdateStorage(active_.c_str());
+	std::vector<string> tiers(roots_);	// 全部盘区, 含着陆盘区
+	if (param_.bLanding) tiers.push_back(param_.pathLanding);
+	index_ = boost::make_shared<FileIndex>(param_.pathIndex);
+	index_->Open(tiers);
+	fwptr_->SetFileIndex(index_);
+	if (param_.bLanding) {
+		migrator_ = boost::make_shared<TierMigrator>(param_.pathLanding, index_, param_.ageLanding,
+				int64_t(param_.freeLanding) << 30);
+		fwptr_->SetMigrator(migrator_);
+	}
+	forecast_ = boost::make_shared<CapacityForecast>(index_, param_.windowForecast * 60,
+			int64_t(param_.minDiskStorage) << 30);
+	fwptr_->SetForecast(forecast_);
+	fwptr_->SetCompressor(param_.bCompress, param_.threadCompress);
+	fwptr_->SetMetadata(param_.bMeta, param_.keywordsMeta.c_str());
+	fwptr_->SetScheduler(int64_t(param_.quantumSched) << 20, param_.prioSched.c_str(), param_.weightSched.c_str());
+	fwptr_->SetSpool(param_.bSpool, param_.pathSpool.c_str(), int64_t(param_.spoolSegment) << 20, param_.bSpoolSync);
+	dppub_ = make_datapub(param_.depthDP, param_.bDisconnectDP, param_.maxlagDP, param_.readerDP);
+	if (param_.bShmDP) {
+		shmpub_ = boost::make_shared<ShmPublisher>(param_.nameShmDP, param_.slotShmDP);
+		if (!shmpub_->Open()) shmpub_.reset();
+	}
+	fwptr_->SetPublisher(dppub_, shmpub_);
+	if (param_.cacheDP > 0) {
+		FrameCachePtr cache = boost::make_shared<FrameCache>(int64_t(param_.cacheDP) << 20);
+		fwptr_->SetFrameCache(cache);
+		dppub_->SetFrameSource(cache, tiers, index_);
+	}
+	else dppub_->SetFrameSource(FrameCachePtr(), tiers, index_);
+	if (param_.bFreeStorage) {
+		delete_ = boost::make_shared<DeleteEngine>(param_.pathDelJournal, param_.threadDelete, param_.iopsDelete);
+		reclaim_ = boost::make_shared<StorageReclaimer>(roots_, index_, delete_,
+				int64_t(param_.minDiskStorage) << 30, int64_t(param_.targetDiskStorage) << 30,
+				param_.retainStorage, int64_t(param_.rateFreeStorage) << 20);
+		fwptr_->SetReclaimer(reclaim_);
+		reclaim_->Start(boost::bind(&FileWritter::ForgetDirectory, fwptr_.get(), _1));
+		delete_->Resume();
+	}
+	// 设置完成后重放预写缓存, 重放文件与新文件同样通知、缓存并累计回收
+	fwptr_->ReplaySpool();
 	/* 启动服务器 */
 	const TCPServer::CBSlot &slot = boost::bind(&TransferAgent::network_accept, this, _1, _2);
 	tcps_fs_ = maketcp_server();
@@ -50,14 +108,24 @@ bool TransferAgent::StartService() {
 	}
 	/* 启动线程 */
 	thrdIdle_.reset(new boost::thread(boost::bind(&TransferAgent::thread_idle, this)));
-	thrdAutoFree_.reset(new boost::thread(boost::bind(&TransferAgent::thread_autofree, this)));
+	if (migrator_.use_count()) migrator_->Start(boost::bind(&FileWritter::ForgetDirectory, fwptr_.get(), _1),
+			boost::bind(&FileWritter::FileMoved, fwptr_.get(), _1, _2, _3));
+	if (param_.bPack) {
+		packer_ = boost::make_shared<NightPacker>(roots_, index_, param_.afterPack);
+		packer_->Start(boost::bind(&FileWritter::ForgetDirectory, fwptr_.get(), _1),
+				boost::bind(&FileWritter::FileMoved, fwptr_.get(), _1, _2, _3));
+	}
+	thrdForecast_.reset(new boost::thread(boost::bind(&TransferAgent::thread_forecast, this)));
 
 	return true;
 }
 
 void TransferAgent::StopService() {
 	interrupt_thread(thrdIdle_);
-	interrupt_thread(thrdAutoFree_);
+	interrupt_thread(thrdForecast_);
+	if (migrator_.use_count()) migrator_->Stop();
+	if (packer_.use_count()) packer_->Stop();
+	if (reclaim_.use_count()) reclaim_->Stop();
 	filercv_.clear();
 }
 
@@ -65,64 +133,82 @@ void TransferAgent::network_accept(const TcpCPtr&client, const long server) {
 	TCPServer *s = (TCPServer*) server;
 	if (s == tcps_fs_.get()) {
 		mutex_lock lck(mtx_filercv_);
-		FileRcvPtr receiver = make_filercv(fwptr_);
+		FileRcvPtr receiver = make_filercv(fwptr_, bufpool_);
+		receiver->SetStream(int64_t(param_.streamThreshold) << 20, param_.streamChunk << 20, param_.streamDepth);
 		if (receiver->CoupleNetwork(client)) filercv_.push_back(receiver);
 	}
 	else {// s == tcps_dp_.get
-		_gLog.Write("accepted connection from data-process");
-		const TCPClient::CBSlot &slot = boost::bind(&TransferAgent::receive_dp, this, _1, _2);
-		client->RegisterRead(slot);
-		client->UseBuffer();
-		tcpc_dp_ = client;
-		fwptr_->CoupleNetwork(client);
+		dppub_->Subscribe(client);
 	}
 }
 
-void TransferAgent::receive_dp(const long client, const long ec) {
-	TCPClient *tcpc = (TCPClient *)client;
-	if (ec && tcpc->IsOpen()) {
-		_gLog.Write(LOG_WARN, NULL, "data-process had broken connection");
-		fwptr_->DecoupleNetowrk();
-		tcpc_dp_->Close();
+const char *TransferAgent::find_storage() {
+	int64_t low = int64_t(param_.minDiskStorage) << 30;
+	int64_t avail, most(-1);
+	const char *best = roots_.front().c_str();
+
+	for (std::vector<string>::iterator it = roots_.begin(); it != roots_.end(); ++it) {
+		if ((avail = CapacityForecast::Available(*it)) >= low) return it->c_str();
+		if (avail > most) {
+			most = avail;
+			best = it->c_str();
+		}
 	}
+	return best;
 }
 
-const char *TransferAgent::find_storage() {
-	return param_.pathStorage.c_str();
-}
+void TransferAgent::thread_forecast() {
+	boost::chrono::minutes period(1);
+	int64_t low = int64_t(param_.minDiskStorage) << 30;
+	double lead = param_.leadForecast * 60.0;
+	CapacityForecast::rootVec roots;
+	CapacityForecast::camVec cams;
+	CapacityForecast::rootVec::iterator it, cur, best;
+	bool warned(false);
+
+	for (int n = 0; ; ++n) {
+		boost::this_thread::sleep_for(period);
 
-void TransferAgent::free_storage() {
-	path filepath(param_.pathStorage);
-	space_info nfspace;
-	nfspace = space(filepath);
-	if ((nfspace.available >> 30) < param_.minDiskStorage) {
-		directory_iterator itend = directory_iterator();
-		ptime now = second_clock::local_time(), tmlast;
-		ptime tmdir;
-		int mjd_now = now.date().modjulian_day();
-		int days4 = 4 * 86400; // 删除4日前所有数据
-		int pos;
-		int year, month, day, ymd;
-		string filename;
-
-		_gLog.Write("Cleaning <%s> for LocalStorage", filepath.c_str());
-		for (directory_iterator x = directory_iterator(filepath); x != itend; ++x) {
-			get_filetime(x->path(), tmlast);
-			filename = x->path().filename().string();
-			if (filename.front() != 'G') continue; // 仅清除G开头文件/目录 -- GWAC
-			pos = filename.rfind('_');
-			if (pos == string::npos) continue;
-			ymd = stoi(filename.substr(pos + 1));
-			day = ymd % 100;
-			year = ymd / 10000;
-			month = (ymd - year * 10000 - day) / 100;
-			tmdir = ptime(ptime::date_type(year + 2000, month, day));
-			if ((mjd_now - tmdir.date().modjulian_day()) > days4) remove_all(x->path());
+		forecast_->Forecast(roots_, roots);
+		forecast_->Cameras(cams);
+		cur = best = roots.end();
+		for (it = roots.begin(); it != roots.end(); ++it) {
+			if (it->root == active_) cur = it;
+			else if (it->avail >= 0 && it->avail - it->expect >= low && (it->eta < 0.0 || it->eta >= lead)
+					&& (best == roots.end() || it->avail > best->avail))
+				best = it;
 		}
 
-		nfspace = space(filepath);
-		_gLog.Write("free capacity of <%s> is %d GB", filepath.c_str(), nfspace.available >> 30);
-		fwptr_->UpdateStorage(filepath.c_str());
+		if (cur != roots.end()) {
+			// 本观测夜的预期写盘量超出余量时, 提前回收至可容纳该写盘量
+			bool shortage = cur->avail >= 0 && cur->avail - cur->expect < low;
+			if (reclaim_.use_count()) reclaim_->Demand(cur->root, shortage ? cur->expect + low : 0);
+			// 预测在提前量内写满或盘区无法访问时, 更换盘区
+			if (cur->avail < 0 || (cur->eta >= 0.0 && cur->eta < lead)) {
+				if (best != roots.end()) {
+					_gLog.Write("storage <%s> is full in %.1f hours, switches to <%s> with %lld GB free",
+							cur->root.c_str(), cur->eta < 0.0 ? 0.0 : cur->eta / 3600.0, best->root.c_str(),
+							(long long) (best->avail >> 30));
+					if (reclaim_.use_count()) reclaim_->Demand(cur->root, 0);
+					active_ = best->root;
+					fwptr_->UpdateStorage(active_.c_str());
+					warned = false;
+				}
+				else if (!warned) {
+					_gLog.Write(LOG_WARN, "TransferAgent", "storage <%s> is full in %.1f hours, no other storage has room",
+							cur->root.c_str(), cur->eta < 0.0 ? 0.0 : cur->eta / 3600.0);
+					warned = true;
+				}
+			}
+			else warned = false;
+		}
+		forecast_->Save(param_.pathForecast, active_, roots, cams);
+		if (n % 60 == 0) {
+			for (it = roots.begin(); it != roots.end(); ++it) {
+				_gLog.Write("storage <%s>: %lld GB free, %.1f MB/s, %lld GB expected tonight", it->root.c_str(),
+						(long long) (it->avail >> 30), it->rate / 1048576.0, (long long) (it->expect >> 30));
+			}
+		}
 	}
 }
 
@@ -141,24 +227,6 @@ void TransferAgent::thread_idle() {
 	}
 }
 
-void TransferAgent::thread_autofree() {
-	// 服务启动5秒后检查一次磁盘空间
-	boost::this_thread::sleep_for(boost::chrono::seconds(5));
-	while(1) {
-		if (param_.bFreeStorage)  free_storage();
-		// 之后每天中午检查一次磁盘空间
-		boost::this_thread::sleep_for(boost::chrono::seconds(next_noon()));
-	}
-}
-
-long TransferAgent::next_noon() {
-	namespace pt = boost::posix_time;
-	pt::ptime now(pt::second_clock::local_time());
-	pt::ptime noon(now.date(), pt::hours(12));
-	long secs = (noon - now).total_seconds();
-	return secs < 10 ? secs + 86400 : secs;
-}
-
 void TransferAgent::interrupt_thread(threadptr& thrd) {
 	if (thrd.unique()) {
 		thrd->interrupt();
@@ -166,7 +234,3 @@ void TransferAgent::interrupt_thread(threadptr& thrd) {
 		thrd.reset();
 	}
 }
-
-void TransferAgent::get_filetime(const boost::filesystem::path &path, boost::posix_time::ptime &tmlast) {
-	tmlast = boost::posix_time::from_time_t(boost::filesystem::last_write_time(path));
-}
@@ -4,7 +4,8 @@
  * @date 2017-10-29
  * @note
  * - 处理网络连接, 为其创建对象TransferClient
- * - 维持线程, 检查、切换与清除原始数据磁盘空间
+ * - 按水位持续回收原始数据磁盘空间
+ * - 预测存储容量, 提前回收或更换盘区
  * - 维持线程, 检查与清除模板数据磁盘空间
  */
 
@@ -20,6 +21,7 @@
 #include "parameter.h"
 #include "tcpasio.h"
 #include "NTPClient.h"
+#include "NightPacker.h"
 
 class TransferAgent {
 public:
@@ -36,12 +38,22 @@ protected:
 	// 成员变量
 	param_config param_;		//< 配置参数
 	FileWritePtr fwptr_;		//< 文件写盘接口
+	BufPoolPtr bufpool_;		//< 文件缓冲区池
 	TcpSPtr tcps_fs_;			//< 网络服务器: 文件服务
 	TcpSPtr tcps_dp_;			//< 网络服务器: 数据处理
-	TcpCPtr tcpc_dp_;			//< 网络连接: 数据处理
+	DataPubPtr dppub_;			//< 新文件通知发布器: 数据处理
+	ShmPubPtr shmpub_;			//< 新文件通知发布器: 同机数据处理, 共享内存
 	NTPPtr ntp_;				//< NTP接口
 	threadptr thrdIdle_;		//< 线程: 空闲检查文件接收器有效性
-	threadptr thrdAutoFree_;	//< 线程: 定时磁盘清除线程
+	FileIndexPtr index_;		//< 已存储文件索引
+	DelEnginePtr delete_;		//< 删除引擎
+	ReclaimerPtr reclaim_;		//< 存储空间回收
+	ForecastPtr forecast_;		//< 存储容量预测
+	threadptr thrdForecast_;	//< 线程: 定时预测存储容量
+	std::vector<string> roots_;	//< 存储盘区
+	string active_;				//< 当前写盘盘区. 启用着陆盘区时为迁移目标盘区
+	MigratorPtr migrator_;		//< 分层存储迁移
+	PackerPtr packer_;			//< 观测夜容器打包
 	boost::mutex mtx_filercv_;	//< 互斥锁, 文件接收器
 	FileRcvVec filercv_;		//< 文件接收接口
 
@@ -66,49 +78,26 @@ protected:
 	 * @param 服务器地址
 	 */
 	void network_accept(const TcpCPtr&, const long);
-	/*!
-	 * @brief 处理数据处理的信息
-	 * @param client 网络资源
-	 * @param ec     错误代码. 0: 正确
-	 * @note
-	 * 仅当数据处理软件断开网络连接时收到消息
-	 */
-	void receive_dp(const long client, const long ec);
 	/*!
 	 * @brief 查找可用的本地存储盘区
 	 * @return
-	 * 可用盘区地址
+	 * 可用盘区地址. 首个可用空间不低于最小容量的盘区, 或可用空间最大的盘区
 	 */
 	const char *find_storage();
 	/*!
-	 * @brief 清除本地存储空间
+	 * @brief 线程, 定时预测存储容量. 预期写盘量超出余量时提前回收,
+	 * 预测在提前量内写满时更换盘区
 	 */
-	void free_storage();
+	void thread_forecast();
 	/*!
 	 * @brief 线程, 检查FileReceiver的有效性
 	 */
 	void thread_idle();
-	/*!
-	 * @brief 线程, 定时检查/清除磁盘空间
-	 */
-	void thread_autofree();
-	/*!
-	 * @brief 计算下一个正午与当前时间之间的秒数
-	 * @return
-	 * 秒数
-	 */
-	long next_noon();
 	/*!
 	 * @brief 中止线程
 	 * @param thrd 线程指针
 	 */
 	void interrupt_thread(threadptr& thrd);
-	/*!
-	 * @brief 查看文件/目录的最后修改时间
-	 * @param path     路径
-	 * @param tmlast   最后修改时间
-	 */
-	void get_filetime(const boost::filesystem::path &path, boost::posix_time::ptime &tmlast);
 };
 
 #endif /* TRANSFERAGENT_H_ */
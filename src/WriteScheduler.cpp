@@ -0,0 +1,192 @@
+/*!
+ * @file WriteScheduler.cpp 写盘调度队列定义文件
+ * @version 0.1
+ * @date 2026-10-19
+ */
+
+#include <stdlib.h>
+#include <strings.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/make_shared.hpp>
+#include "WriteScheduler.h"
+#include "FileWritter.h"
+
+using namespace boost::posix_time;
+
+static const char *imgtype_name[] = {"UNKNOWN", "BIAS", "DARK", "FLAT", "OBJECT", "FOCUS"};
+
+IMAGE_TYPE image_type(const string &imgtype) {
+	string name = boost::trim_copy(imgtype);
+
+	if (name.empty()) return IMGTYPE_ERROR;
+	for (int i = IMGTYPE_BIAS; i <= IMGTYPE_FOCUS; ++i) {
+		if (!strcasecmp(name.c_str(), imgtype_name[i])) return IMAGE_TYPE(i);
+	}
+	if (!strncasecmp(name.c_str(), "FLAT", 4)) return IMGTYPE_FLAT;	// FLATFIELD, FLAT-SKY等
+	if (!strcasecmp(name.c_str(), "OBJT") || !strcasecmp(name.c_str(), "LIGHT")
+			|| !strcasecmp(name.c_str(), "SCIENCE")) return IMGTYPE_OBJECT;
+	if (!strcasecmp(name.c_str(), "FOCS") || !strcasecmp(name.c_str(), "FOCUSING")) return IMGTYPE_FOCUS;
+	return IMGTYPE_ERROR;
+}
+
+/*!
+ * @brief 解析"键=值[,键=值...]"格式的配置
+ */
+static void parse_pairs(const string &text, std::map<string, int> &pairs) {
+	std::vector<string> items;
+
+	boost::split(items, text, boost::is_any_of(",; "), boost::token_compress_on);
+	for (std::vector<string>::iterator it = items.begin(); it != items.end(); ++it) {
+		string::size_type pos = it->rfind('=');
+		if (pos == string::npos || pos == 0) continue;
+		pairs[it->substr(0, pos)] = atoi(it->c_str() + pos + 1);
+	}
+}
+
+WriteScheduler::WriteScheduler(int64_t quantum, const string &priority, const string &weights) {
+	std::map<string, int> pairs;
+	int lowest(0), i;
+
+	quantum_  = quantum > 0 ? quantum : 32 * 1024 * 1024;
+	size_     = 0;
+	curlevel_ = -1;
+
+	parse_pairs(priority, pairs);
+	for (i = IMGTYPE_ERROR; i <= IMGTYPE_FOCUS; ++i) prio_[i] = -1;
+	for (std::map<string, int>::iterator it = pairs.begin(); it != pairs.end(); ++it) {
+		int level = it->second < 0 ? 0 : (it->second > IMGTYPE_FOCUS ? IMGTYPE_FOCUS : it->second);
+		for (i = IMGTYPE_ERROR; i <= IMGTYPE_FOCUS; ++i) {
+			if (!strcasecmp(it->first.c_str(), imgtype_name[i])) {
+				prio_[i] = level;
+				if (level > lowest) lowest = level;
+			}
+		}
+	}
+	for (i = IMGTYPE_ERROR; i <= IMGTYPE_FOCUS; ++i) {
+		if (prio_[i] < 0) prio_[i] = lowest;
+	}
+	levels_.resize(lowest + 1);
+	for (std::vector<level>::iterator it = levels_.begin(); it != levels_.end(); ++it) {
+		it->queued   = 0;
+		it->count    = 0;
+		it->sumdelay = 0.0;
+		it->maxdelay = 0.0;
+	}
+
+	parse_pairs(weights, weights_);
+}
+
+WriteScheduler::~WriteScheduler() {
+}
+
+void WriteScheduler::Push(nfileptr ptr, IMAGE_TYPE imgtype) {
+	level &lvl = levels_[Level(imgtype)];
+	string key = ptr->gid + ":" + ptr->uid + ":" + ptr->cid;
+	flowptr &f = lvl.flows[key];
+
+	if (!f.use_count()) {
+		std::map<string, int>::iterator it = weights_.find(key);
+		f = boost::make_shared<flow>();
+		f->key     = key;
+		f->weight  = it == weights_.end() || it->second < 1 ? 1 : it->second;
+		f->deficit = 0;
+		f->turn    = false;
+	}
+	if (f->queue.empty()) lvl.active.push_back(f);
+
+	item x;
+	x.ptr     = ptr;
+	x.tmqueue = microsec_clock::universal_time();
+	x.cost    = ptr->stored ? 0 : ptr->filesize;	// 已写盘文件仅需注册与通知
+	f->queue.push_back(x);
+	++lvl.queued;
+	++size_;
+}
+
+nfileptr WriteScheduler::Front() {
+	if (curlevel_ >= 0) return curflow_->queue.front().ptr;
+	if (!size_) return nfileptr();
+
+	for (curlevel_ = 0; levels_[curlevel_].active.empty(); ++curlevel_);
+	std::list<flowptr> &active = levels_[curlevel_].active;
+	while (1) {// 差额轮转: 轮到的相机获得一份额度, 额度不足时让位于下一台相机
+		flowptr f = active.front();
+		if (!f->turn) {
+			f->deficit += quantum_ * f->weight;
+			f->turn = true;
+		}
+		if (f->deficit >= f->queue.front().cost) {
+			curflow_ = f;
+			break;
+		}
+		f->turn = false;
+		active.splice(active.end(), active, active.begin());
+	}
+
+	return curflow_->queue.front().ptr;
+}
+
+void WriteScheduler::Pop() {
+	if (curlevel_ < 0 && !Front().use_count()) return;
+
+	level &lvl = levels_[curlevel_];
+	item &x = curflow_->queue.front();
+	double delay = (microsec_clock::universal_time() - x.tmqueue).total_microseconds() * 1E-3;
+
+	curflow_->deficit -= x.cost;
+	curflow_->queue.pop_front();
+	if (curflow_->queue.empty()) {// 相机队列清空后退出轮转, 不保留额度
+		curflow_->deficit = 0;
+		curflow_->turn    = false;
+		lvl.active.remove(curflow_);
+	}
+	--lvl.queued;
+	--size_;
+	++lvl.count;
+	lvl.sumdelay += delay;
+	if (delay > lvl.maxdelay) lvl.maxdelay = delay;
+
+	curflow_.reset();
+	curlevel_ = -1;
+}
+
+int WriteScheduler::Size() {
+	return size_;
+}
+
+bool WriteScheduler::Empty() {
+	return size_ == 0;
+}
+
+void WriteScheduler::Clear() {
+	for (std::vector<level>::iterator it = levels_.begin(); it != levels_.end(); ++it) {
+		it->flows.clear();
+		it->active.clear();
+		it->queued = 0;
+	}
+	size_ = 0;
+	curflow_.reset();
+	curlevel_ = -1;
+}
+
+void WriteScheduler::Stats(statVec &stats) {
+	stats.clear();
+	for (int i = 0; i < int(levels_.size()); ++i) {
+		level &lvl = levels_[i];
+		class_stat x;
+		x.level    = i;
+		x.queued   = lvl.queued;
+		x.count    = lvl.count;
+		x.avgdelay = lvl.count ? lvl.sumdelay / lvl.count : 0.0;
+		x.maxdelay = lvl.maxdelay;
+		stats.push_back(x);
+
+		lvl.count    = 0;
+		lvl.sumdelay = 0.0;
+		lvl.maxdelay = 0.0;
+	}
+}
+
+int WriteScheduler::Level(IMAGE_TYPE imgtype) {
+	return prio_[imgtype >= IMGTYPE_ERROR && imgtype <= IMGTYPE_FOCUS ? imgtype : IMGTYPE_ERROR];
+}
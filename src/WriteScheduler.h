@@ -0,0 +1,132 @@
+/*!
+ * @file WriteScheduler.h 写盘调度队列声明文件
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 替代先进先出队列, 避免单台相机突发(如快速调焦序列)延误其它相机的文件
+ * - 按图像类型划分优先级类别, 类别间严格优先
+ * - 同一类别内, 按相机(gid:uid:cid)以差额轮转(DRR)调度, 份额以字节计并按相机权重放大
+ * - 统计各类别的排队延时
+ * - 非线程安全, 由调用者加锁
+ */
+
+#ifndef WRITESCHEDULER_H_
+#define WRITESCHEDULER_H_
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <boost/container/deque.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "AstroDeviceDef.h"
+
+using std::string;
+
+struct FileInfo;
+typedef boost::shared_ptr<FileInfo> nfileptr;
+
+/*!
+ * @brief 由FITS关键字IMAGETYP的值识别图像类型
+ * @return
+ * 图像类型. 无法识别时返回IMGTYPE_ERROR
+ */
+extern IMAGE_TYPE image_type(const string &imgtype);
+
+class WriteScheduler {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param quantum  每轮份额, 量纲: 字节
+	 * @param priority 图像类型的优先级, 格式: TYPE=级别[,TYPE=级别...]. 级别0最高.
+	 *                 TYPE取值BIAS/DARK/FLAT/OBJECT/FOCUS/UNKNOWN, 未列出的类型使用最低级别
+	 * @param weights  相机权重, 格式: gid:uid:cid=权重[,...]. 未列出的相机权重为1
+	 */
+	WriteScheduler(int64_t quantum, const string &priority, const string &weights);
+	virtual ~WriteScheduler();
+
+public:
+	// 数据类型
+	struct class_stat {// 类别排队统计
+		int level;			//< 优先级
+		int queued;			//< 排队文件数量
+		int64_t count;		//< 统计周期内出队文件数量
+		double avgdelay;	//< 平均排队延时, 量纲: 毫秒
+		double maxdelay;	//< 最大排队延时, 量纲: 毫秒
+	};
+	typedef std::vector<class_stat> statVec;
+
+protected:
+	typedef boost::posix_time::ptime ptime;
+	struct item {// 排队文件
+		nfileptr ptr;		//< 文件
+		ptime tmqueue;		//< 入队时间
+		int64_t cost;		//< 调度代价, 量纲: 字节
+	};
+	struct flow {// 相机队列
+		string key;			//< gid:uid:cid
+		int weight;			//< 权重
+		int64_t deficit;	//< 差额, 量纲: 字节
+		bool turn;			//< 本轮已获得份额
+		boost::container::deque<item> queue;	//< 排队文件
+	};
+	typedef boost::shared_ptr<flow> flowptr;
+	struct level {// 优先级类别
+		std::map<string, flowptr> flows;	//< 相机队列
+		std::list<flowptr> active;			//< 有排队文件的相机, 按轮转次序
+		int queued;			//< 排队文件数量
+		int64_t count;		//< 统计: 出队文件数量
+		double sumdelay;	//< 统计: 累计排队延时, 量纲: 毫秒
+		double maxdelay;	//< 统计: 最大排队延时, 量纲: 毫秒
+	};
+
+protected:
+	// 成员变量
+	int64_t quantum_;	//< 每轮份额, 量纲: 字节
+	int prio_[IMGTYPE_FOCUS + 1];	//< 图像类型的优先级
+	std::vector<level> levels_;		//< 优先级类别
+	std::map<string, int> weights_;	//< 相机权重
+	int size_;			//< 排队文件总数
+	int curlevel_;		//< 已选中文件的类别. <0: 未选中
+	flowptr curflow_;	//< 已选中文件的相机队列
+
+public:
+	// 接口
+	/*!
+	 * @brief 文件入队
+	 * @param ptr     文件
+	 * @param imgtype 图像类型
+	 */
+	void Push(nfileptr ptr, IMAGE_TYPE imgtype);
+	/*!
+	 * @brief 查看下一个待写盘文件
+	 * @note
+	 * 选中的文件在Pop()之前保持不变
+	 */
+	nfileptr Front();
+	/*!
+	 * @brief 移除Front()选中的文件, 并统计其排队延时
+	 */
+	void Pop();
+	/*!
+	 * @brief 查看排队文件数量
+	 */
+	int Size();
+	bool Empty();
+	/*!
+	 * @brief 清空队列
+	 */
+	void Clear();
+	/*!
+	 * @brief 查看各类别的排队统计, 并开始新的统计周期
+	 */
+	void Stats(statVec &stats);
+	/*!
+	 * @brief 查看图像类型的优先级
+	 */
+	int Level(IMAGE_TYPE imgtype);
+};
+typedef boost::shared_ptr<WriteScheduler> WriteSchedPtr;
+
+#endif /* WRITESCHEDULER_H_ */
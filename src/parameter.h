@@ -20,15 +20,74 @@ using std::vector;
 struct param_config {// 软件配置参数
 	uint16_t portFS;	//< 网络服务端口: 文件服务
 	uint16_t portDP;	//< 网络服务端口: 数据处理
+	int depthDP;		//< 数据处理订阅者的通知队列容量
+	bool bDisconnectDP;	//< 队列满或滞后超限时断开订阅者. false: 丢弃最早通知
+	int maxlagDP;		//< 数据处理订阅者的最大滞后时间, 量纲: 秒. 0: 不检查
+	int cacheDP;		//< 帧缓存容量, 量纲: MB. 0: 不缓存
+	int readerDP;		//< 文件读取线程数量
+	bool bShmDP;		//< 启用共享内存通知, 供同机数据处理读取
+	string nameShmDP;	//< 共享内存名称
+	int slotShmDP;		//< 共享内存通知槽位数量
 	bool bNTP;		//< 是否启用NTP
 	string ipNTP;	//< NTP主机地址
 	int diffNTP;	//< 时钟最大偏差
 	bool bDB;		//< 是否启用数据库
 	string urlDB;	//< 数据库链接地址
+	int workerDB;	//< 数据库注册线程数量
+	int queueDB;	//< 数据库注册队列容量
+	string outboxDB;	//< 数据库注册发件箱文件路径
+	int batchDB;		//< 数据库批量注册的最大记录数. 不大于1时逐条注册
+	int windowDB;		//< 数据库批量注册的累积时间, 量纲: 毫秒
+	string urlBatchDB;	//< 数据库批量注册地址. 为空时使用默认地址
+	int tmConnectDB;	//< 数据库连接超时, 量纲: 毫秒
+	int tmTotalDB;		//< 数据库请求总超时, 量纲: 毫秒
+	int failmaxDB;		//< 数据库熔断阈值: 连续失败次数
+	bool bRefDB;		//< 按引用注册: 仅发送路径、大小、校验和及FITS关键字
+	string keywordsDB;	//< 按引用注册时提取的FITS关键字
+	bool bUploadDB;		//< 按引用注册后在后台上传文件
+	int rateUploadDB;	//< 后台上传速率上限, 量纲: MB/s. 0: 不限速
 	/* 原始数据存储路径 */
 	bool bFreeStorage;	//< 自动清除磁盘空间
 	int minDiskStorage;	//< 最小磁盘容量, 量纲: GB. 当小于该值时更换盘区或删除历史数据
-	string pathStorage;	//< 文件存储盘区名称列表
+	int targetDiskStorage;	//< 回收目标容量, 量纲: GB. 删除历史数据直至可用空间不小于该值
+	int retainStorage;	//< 保留天数. 不删除该天数内的观测夜目录
+	int rateFreeStorage;	//< 删除速率上限, 量纲: MB/s. 0: 不限速
+	string pathStorage;	//< 文件存储盘区名称列表, 以逗号分隔
+	string pathIndex;	//< 已存储文件索引路径. 丢失时扫描盘区重建
+	int threadDelete;	//< 删除引擎工作线程数量
+	int iopsDelete;		//< 删除操作速率上限, 量纲: 次/秒. 0: 不限速
+	string pathDelJournal;	//< 删除任务日志路径, 重启后继续未完成的任务
+	int windowForecast;	//< 容量预测的写盘速率统计窗口, 量纲: 分钟
+	int leadForecast;	//< 预测可用空间在该时间内降至低水位时更换盘区, 量纲: 分钟
+	string pathForecast;	//< 容量预测状态文件路径
+	bool bLanding;		//< 启用着陆盘区: 先写入高速盘区, 后台迁移至存储盘区
+	string pathLanding;	//< 着陆盘区根路径
+	int ageLanding;		//< 文件在着陆盘区的最短驻留时间, 量纲: 秒
+	int freeLanding;	//< 着陆盘区可用空间低于该值时不等待驻留时间, 量纲: GB
+	bool bPack;			//< 归档模式: 将已结束观测夜的文件按相机打包为容器
+	int afterPack;		//< 观测夜结束该天数后打包
+	bool bCompress;		//< 写盘前以Rice算法分块无损压缩16位图像
+	int threadCompress;	//< 压缩线程数量
+	/* 文件缓冲区池 */
+	bool bBufPool;		//< 启用缓冲区池
+	int maxBufPool;		//< 缓冲区池最大内存, 量纲: MB
+	bool bHugePage;		//< 缓冲区池使用大页内存
+	/* 大文件流式接收 */
+	int streamThreshold;	//< 流式接收阈值, 量纲: MB. 大于该值的文件以数据块流式写盘
+	int streamChunk;		//< 数据块长度, 量纲: MB
+	int streamDepth;		//< 管道深度, 即每个文件最多缓存的数据块数量
+	/* 预写缓存 */
+	bool bSpool;		//< 启用预写缓存
+	string pathSpool;	//< 缓存目录, 应位于本地快速存储
+	int spoolSegment;	//< 段容量, 量纲: MB
+	bool bSpoolSync;	//< 追加后同步到磁盘
+	/* 写盘调度 */
+	int quantumSched;		//< 每台相机每轮写盘份额, 量纲: MB
+	string prioSched;		//< 图像类型优先级, 格式: TYPE=级别[,...]. 级别0最高, 未列出类型使用最低级别
+	string weightSched;		//< 相机权重, 格式: gid:uid:cid=权重[,...]. 未列出相机权重为1
+	/* 元数据提取 */
+	bool bMeta;				//< 写盘前提取FITS关键字, 记入文件索引、数据库注册与数据处理通知
+	string keywordsMeta;	//< 提取的FITS关键字, 以逗号分隔
 
 private:
 	string pathxml;	//< 配置文件路径
@@ -52,16 +111,71 @@ public:
 
 		pt.add("Server.<xmlattr>.PortFS",    4020);
 		pt.add("Server.<xmlattr>.PortDP",    4021);
+		pt.add("DataProcess.<xmlattr>.QueueDepth", 1000);
+		pt.add("DataProcess.<xmlattr>.Policy",     "drop");
+		pt.add("DataProcess.<xmlattr>.MaxLag",     60);
+		pt.add("DataProcess.<xmlattr>.CacheSize",  512);
+		pt.add("DataProcess.<xmlattr>.Readers",    2);
+		pt.add("DataProcess.SharedMemory.<xmlattr>.Enable", false);
+		pt.add("DataProcess.SharedMemory.<xmlattr>.Name",   "/ftserver_notify");
+		pt.add("DataProcess.SharedMemory.<xmlattr>.Slots",  1024);
 		pt.add("NTP.<xmlattr>.Enable",       true);
 		pt.add("NTP.<xmlattr>.IP",           "192.168.10.111");
 		pt.add("NTP.<xmlattr>.Difference",   1000);
 		pt.add("Database.<xmlattr>.Enable",  false);
 		pt.add("Database.<xmlattr>.URL",     "http://192.168.10.20:8080/gwebend/");
+		pt.add("Database.<xmlattr>.Workers",   2);
+		pt.add("Database.<xmlattr>.QueueSize", 1000);
+		pt.add("Database.<xmlattr>.Outbox",    "/var/spool/ftserver/dboutbox.txt");
+		pt.add("Database.<xmlattr>.BatchSize",   1);
+		pt.add("Database.<xmlattr>.BatchWindow", 1000);
+		pt.add("Database.<xmlattr>.BatchURL",    "");
+		pt.add("Database.<xmlattr>.ConnectTimeout", 3000);
+		pt.add("Database.<xmlattr>.Timeout",        30000);
+		pt.add("Database.<xmlattr>.FailThreshold",  5);
+		pt.add("Database.Reference.<xmlattr>.Enable",   false);
+		pt.add("Database.Reference.<xmlattr>.Keywords", "IMAGETYP,EXPTIME,RA,DEC,CCDTEMP,NAXIS1,NAXIS2,DATE-OBS");
+		pt.add("Database.Reference.<xmlattr>.Upload",   false);
+		pt.add("Database.Reference.<xmlattr>.Rate",     10);
 
 		ptree& node1 = pt.add("LocalStorage", "");
 		node1.add("AutoFree.<xmlattr>.Enable",          true);
 		node1.add("AutoFree.<xmlattr>.MinimumCapacity", 500);
+		node1.add("AutoFree.<xmlattr>.TargetCapacity",  600);
+		node1.add("AutoFree.<xmlattr>.RetainDays",      4);
+		node1.add("AutoFree.<xmlattr>.RateLimit",       200);
 		node1.add("PathRoot.<xmlattr>.Name",            "/data");
+		node1.add("Index.<xmlattr>.Path",               "/var/spool/ftserver/fileindex.txt");
+		node1.add("Delete.<xmlattr>.Threads",           4);
+		node1.add("Delete.<xmlattr>.IOPS",              500);
+		node1.add("Delete.<xmlattr>.Journal",           "/var/spool/ftserver/deljournal.txt");
+		node1.add("Forecast.<xmlattr>.Window",          60);
+		node1.add("Forecast.<xmlattr>.Lead",            120);
+		node1.add("Forecast.<xmlattr>.Path",            "/var/spool/ftserver/forecast.txt");
+		node1.add("Landing.<xmlattr>.Enable",           false);
+		node1.add("Landing.<xmlattr>.Path",             "/landing");
+		node1.add("Landing.<xmlattr>.MinAge",           600);
+		node1.add("Landing.<xmlattr>.MinFree",          20);
+		node1.add("Pack.<xmlattr>.Enable",              false);
+		node1.add("Pack.<xmlattr>.AfterNights",         1);
+		node1.add("Compress.<xmlattr>.Enable",          false);
+		node1.add("Compress.<xmlattr>.Threads",         4);
+
+		pt.add("BufferPool.<xmlattr>.Enable",    true);
+		pt.add("BufferPool.<xmlattr>.MaxMemory", 2048);
+		pt.add("BufferPool.<xmlattr>.HugePage",  false);
+		pt.add("Stream.<xmlattr>.Threshold",     1024);
+		pt.add("Stream.<xmlattr>.ChunkSize",     4);
+		pt.add("Stream.<xmlattr>.Depth",         4);
+		pt.add("Spool.<xmlattr>.Enable",         false);
+		pt.add("Spool.<xmlattr>.Path",           "/var/spool/ftserver");
+		pt.add("Spool.<xmlattr>.SegmentSize",    1024);
+		pt.add("Spool.<xmlattr>.Sync",           true);
+		pt.add("Scheduler.<xmlattr>.Quantum",    32);
+		pt.add("Scheduler.<xmlattr>.Priority",   "OBJECT=0,FOCUS=1,FLAT=1,DARK=1,BIAS=1,UNKNOWN=1");
+		pt.add("Scheduler.<xmlattr>.Weights",    "");
+		pt.add("Metadata.<xmlattr>.Enable",      false);
+		pt.add("Metadata.<xmlattr>.Keywords",    "IMAGETYP,EXPTIME,RA,DEC,CCDTEMP,NAXIS,NAXIS1,NAXIS2,DATE-OBS");
 
 		boost::property_tree::xml_writer_settings<std::string> settings(' ', 4);
 		write_xml(filepath, pt, std::locale(), settings);
@@ -79,6 +193,60 @@ public:
 
 			ptree pt;
 			pathStorage.clear();
+			targetDiskStorage = 600;
+			retainStorage     = 4;
+			rateFreeStorage   = 200;
+			pathIndex         = "/var/spool/ftserver/fileindex.txt";
+			threadDelete      = 4;
+			iopsDelete        = 500;
+			pathDelJournal    = "/var/spool/ftserver/deljournal.txt";
+			windowForecast    = 60;
+			leadForecast      = 120;
+			pathForecast      = "/var/spool/ftserver/forecast.txt";
+			bLanding          = false;
+			pathLanding       = "/landing";
+			ageLanding        = 600;
+			freeLanding       = 20;
+			bPack             = false;
+			afterPack         = 1;
+			bCompress         = false;
+			threadCompress    = 4;
+			bBufPool   = true;
+			maxBufPool = 2048;
+			bHugePage  = false;
+			streamThreshold = 1024;
+			streamChunk     = 4;
+			streamDepth     = 4;
+			workerDB     = 2;
+			queueDB      = 1000;
+			outboxDB     = "/var/spool/ftserver/dboutbox.txt";
+			batchDB      = 1;
+			windowDB     = 1000;
+			urlBatchDB   = "";
+			tmConnectDB  = 3000;
+			tmTotalDB    = 30000;
+			failmaxDB    = 5;
+			bRefDB       = false;
+			keywordsDB   = "IMAGETYP,EXPTIME,RA,DEC,CCDTEMP,NAXIS1,NAXIS2,DATE-OBS";
+			bUploadDB    = false;
+			rateUploadDB = 10;
+			depthDP       = 1000;
+			bDisconnectDP = false;
+			maxlagDP      = 60;
+			cacheDP       = 512;
+			readerDP      = 2;
+			bShmDP        = false;
+			nameShmDP     = "/ftserver_notify";
+			slotShmDP     = 1024;
+			bSpool       = false;
+			pathSpool    = "/var/spool/ftserver";
+			spoolSegment = 1024;
+			bSpoolSync   = true;
+			quantumSched = 32;
+			prioSched    = "OBJECT=0,FOCUS=1,FLAT=1,DARK=1,BIAS=1,UNKNOWN=1";
+			weightSched  = "";
+			bMeta        = false;
+			keywordsMeta = "IMAGETYP,EXPTIME,RA,DEC,CCDTEMP,NAXIS,NAXIS1,NAXIS2,DATE-OBS";
 			read_xml(filepath, pt, boost::property_tree::xml_parser::trim_whitespace);
 
 			BOOST_FOREACH(ptree::value_type const &child, pt.get_child("")) {
@@ -86,6 +254,16 @@ public:
 					portFS = child.second.get("<xmlattr>.PortFS", 4020);
 					portDP = child.second.get("<xmlattr>.PortDP", 4021);
 				}
+				else if (boost::iequals(child.first, "DataProcess")) {
+					depthDP       = child.second.get("<xmlattr>.QueueDepth", 1000);
+					bDisconnectDP = boost::iequals(child.second.get("<xmlattr>.Policy", "drop"), "disconnect");
+					maxlagDP      = child.second.get("<xmlattr>.MaxLag",     60);
+					cacheDP       = child.second.get("<xmlattr>.CacheSize",  512);
+					readerDP      = child.second.get("<xmlattr>.Readers",    2);
+					bShmDP        = child.second.get("SharedMemory.<xmlattr>.Enable", false);
+					nameShmDP     = child.second.get("SharedMemory.<xmlattr>.Name",   "/ftserver_notify");
+					slotShmDP     = child.second.get("SharedMemory.<xmlattr>.Slots",  1024);
+				}
 				else if (boost::iequals(child.first, "NTP")) {
 					bNTP    = child.second.get("<xmlattr>.Enable",     true);
 					ipNTP   = child.second.get("<xmlattr>.IP",         "192.168.10.111");
@@ -94,11 +272,67 @@ public:
 				else if (boost::iequals(child.first, "Database")) {
 					bDB   = child.second.get("<xmlattr>.Enable", false);
 					urlDB = child.second.get("<xmlattr>.URL",    "http://192.168.10.20:8080/gwebend/");
+					workerDB = child.second.get("<xmlattr>.Workers",   2);
+					queueDB  = child.second.get("<xmlattr>.QueueSize", 1000);
+					outboxDB = child.second.get("<xmlattr>.Outbox",    "/var/spool/ftserver/dboutbox.txt");
+					batchDB    = child.second.get("<xmlattr>.BatchSize",   1);
+					windowDB   = child.second.get("<xmlattr>.BatchWindow", 1000);
+					urlBatchDB = child.second.get("<xmlattr>.BatchURL",    "");
+					tmConnectDB = child.second.get("<xmlattr>.ConnectTimeout", 3000);
+					tmTotalDB   = child.second.get("<xmlattr>.Timeout",        30000);
+					failmaxDB   = child.second.get("<xmlattr>.FailThreshold",  5);
+					bRefDB       = child.second.get("Reference.<xmlattr>.Enable",   false);
+					keywordsDB   = child.second.get("Reference.<xmlattr>.Keywords", keywordsDB);
+					bUploadDB    = child.second.get("Reference.<xmlattr>.Upload",   false);
+					rateUploadDB = child.second.get("Reference.<xmlattr>.Rate",     10);
 				}
 				else if (boost::iequals(child.first, "LocalStorage")) {
 					bFreeStorage   = child.second.get("AutoFree.<xmlattr>.Enable", true);
 					minDiskStorage = child.second.get("AutoFree.<xmlattr>.MinimumCapacity", 500);
+					targetDiskStorage = child.second.get("AutoFree.<xmlattr>.TargetCapacity", 600);
+					retainStorage     = child.second.get("AutoFree.<xmlattr>.RetainDays",     4);
+					rateFreeStorage   = child.second.get("AutoFree.<xmlattr>.RateLimit",      200);
 					pathStorage    = child.second.get("PathRoot.<xmlattr>.Name", "/data");
+					pathIndex      = child.second.get("Index.<xmlattr>.Path", "/var/spool/ftserver/fileindex.txt");
+					threadDelete   = child.second.get("Delete.<xmlattr>.Threads", 4);
+					iopsDelete     = child.second.get("Delete.<xmlattr>.IOPS",    500);
+					pathDelJournal = child.second.get("Delete.<xmlattr>.Journal", "/var/spool/ftserver/deljournal.txt");
+					windowForecast = child.second.get("Forecast.<xmlattr>.Window", 60);
+					leadForecast   = child.second.get("Forecast.<xmlattr>.Lead",   120);
+					pathForecast   = child.second.get("Forecast.<xmlattr>.Path",   "/var/spool/ftserver/forecast.txt");
+					bLanding       = child.second.get("Landing.<xmlattr>.Enable",  false);
+					pathLanding    = child.second.get("Landing.<xmlattr>.Path",    "/landing");
+					ageLanding     = child.second.get("Landing.<xmlattr>.MinAge",  600);
+					freeLanding    = child.second.get("Landing.<xmlattr>.MinFree", 20);
+					bPack          = child.second.get("Pack.<xmlattr>.Enable",      false);
+					afterPack      = child.second.get("Pack.<xmlattr>.AfterNights", 1);
+					bCompress      = child.second.get("Compress.<xmlattr>.Enable",  false);
+					threadCompress = child.second.get("Compress.<xmlattr>.Threads", 4);
+				}
+				else if (boost::iequals(child.first, "BufferPool")) {
+					bBufPool   = child.second.get("<xmlattr>.Enable",    true);
+					maxBufPool = child.second.get("<xmlattr>.MaxMemory", 2048);
+					bHugePage  = child.second.get("<xmlattr>.HugePage",  false);
+				}
+				else if (boost::iequals(child.first, "Stream")) {
+					streamThreshold = child.second.get("<xmlattr>.Threshold", 1024);
+					streamChunk     = child.second.get("<xmlattr>.ChunkSize", 4);
+					streamDepth     = child.second.get("<xmlattr>.Depth",     4);
+				}
+				else if (boost::iequals(child.first, "Spool")) {
+					bSpool       = child.second.get("<xmlattr>.Enable",      false);
+					pathSpool    = child.second.get("<xmlattr>.Path",        "/var/spool/ftserver");
+					spoolSegment = child.second.get("<xmlattr>.SegmentSize", 1024);
+					bSpoolSync   = child.second.get("<xmlattr>.Sync",        true);
+				}
+				else if (boost::iequals(child.first, "Scheduler")) {
+					quantumSched = child.second.get("<xmlattr>.Quantum",  32);
+					prioSched    = child.second.get("<xmlattr>.Priority", "OBJECT=0,FOCUS=1,FLAT=1,DARK=1,BIAS=1,UNKNOWN=1");
+					weightSched  = child.second.get("<xmlattr>.Weights",  "");
+				}
+				else if (boost::iequals(child.first, "Metadata")) {
+					bMeta        = child.second.get("<xmlattr>.Enable",   false);
+					keywordsMeta = child.second.get("<xmlattr>.Keywords", keywordsMeta);
 				}
 			}
 		}
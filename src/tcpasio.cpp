@@ -71,8 +71,8 @@ void TCPClient::UseBuffer(bool usebuf) {
 	if (usebuf_ != usebuf) {
 		usebuf_ = usebuf;
 		if (usebuf_) {
-			crcrcv_.set_capacity(TCP_PACK_SIZE * 10);
-			crcsnd_.set_capacity(TCP_PACK_SIZE * 10);
+			crcrcv_.set_capacity(TCP_BUFF_SIZE);
+			crcsnd_.set_capacity(TCP_BUFF_SIZE);
 		}
 		else {
 			crcrcv_.clear();
@@ -170,6 +170,12 @@ int TCPClient::Write(const char* buff, const int len) {
 	return n;
 }
 
+int TCPClient::Writable() {
+	if (!usebuf_) return TCP_PACK_SIZE;
+	mutex_lock lck(mtxsnd_);
+	return crcsnd_.capacity() - crcsnd_.size();
+}
+
 void TCPClient::handle_connect(const boost::system::error_code& ec) {
 	if (!cbconn_.empty()) cbconn_((const long) this, ec.value());
 	if (!ec) {
@@ -25,6 +25,7 @@ using boost::asio::ip::tcp;
 //////////////////////////////////////////////////////////////////////////////
 /*---------------- TCPClient: 客户端 ----------------*/
 #define TCP_PACK_SIZE	1500		//< TCP包容量, 量纲: 字节
+#define TCP_BUFF_SIZE	(TCP_PACK_SIZE * 10)	//< 循环缓冲区容量, 量纲: 字节
 
 class TCPClient {
 public:
@@ -148,6 +149,12 @@ public:
 	 * 实际发送数据长度
 	 */
 	int Write(const char* buff, const int len);
+	/*!
+	 * @brief 查看发送缓冲区剩余容量
+	 * @return
+	 * 可无截断写入的数据长度. 未启用缓冲区时返回TCP_PACK_SIZE
+	 */
+	int Writable();
 
 protected:
 	// 功能
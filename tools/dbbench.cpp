@@ -0,0 +1,134 @@
+/*!
+ * @file dbbench.cpp 数据库注册压力测试
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 经DBCurl向数据库(或tools/dbmock.py)注册n条记录, 统计成功数量与请求速率
+ * - 以-b启用批量注册, 配合dbmock.py --reject-batch验证逐条注册回退
+ * - 以-q逐条调用阻塞的RegImageFile(), 复用连接; 追加-f时每条记录新建连接, 作为对照
+ *
+ * 用法:
+ *   dbbench [-n 2000] [-c 8] [-b 1] [-w 1000] [-s 8192] [-q [-f]] http://127.0.0.1:8080/
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "DBCurl.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::placeholders;
+namespace fs = boost::filesystem;
+
+GLog _gLog(stdout);
+
+struct bench_state {// 异步请求计数
+	boost::mutex mtx;
+	boost::condition_variable cv;
+	int inflight;	//< 未完成请求
+	int nok;		//< 成功数量
+	int nfail;		//< 失败数量
+
+public:
+	bench_state() {
+		inflight = nok = nfail = 0;
+	}
+};
+
+static void on_result(bench_state *st, const curl_result &rslt) {
+	boost::unique_lock<boost::mutex> lck(st->mtx);
+	if (rslt.code == 0 && rslt.httpcode == 200) ++st->nok;
+	else ++st->nfail;
+	--st->inflight;
+	st->cv.notify_all();
+}
+
+static void usage() {
+	printf("Usage: dbbench [-n records] [-c inflight] [-b batchsize] [-w window_ms] [-s filesize] [-q [-f]] url_root\n");
+	exit(1);
+}
+
+/*!
+ * @brief 逐条阻塞注册磁盘文件
+ * @param fresh 每条记录新建DBCurl, 不复用连接
+ * @return
+ * 成功数量
+ */
+static int bench_sequential(const string &url, int n, int size, bool fresh) {
+	string dir = (fs::temp_directory_path() / fs::unique_path("dbbench-%%%%%%")).string();
+	string filename("bench.fit");
+	boost::shared_ptr<DBCurl> db;
+	int nok(0);
+
+	fs::create_directories(dir);
+	FILE *fp = fopen((fs::path(dir) / filename).c_str(), "wb");
+	if (fp) {
+		for (int i = 0; i < size; ++i) fputc(0, fp);
+		fclose(fp);
+	}
+	for (int i = 0; i < n; ++i) {
+		if (fresh || !db.use_count()) db.reset(new DBCurl(url, 1));
+		if (db->RegImageFile("bench", filename, dir, "20261019T000000", i) == 0) ++nok;
+	}
+	fs::remove_all(dir);
+	return nok;
+}
+
+int main(int argc, char **argv) {
+	int n(2000), inflight(8), batch(1), window(1000), size(8192), ch;
+	bool sequential(false), fresh(false);
+
+	while ((ch = getopt(argc, argv, "n:c:b:w:s:qf")) != -1) {
+		switch (ch) {
+		case 'n': n = atoi(optarg); break;
+		case 'c': inflight = atoi(optarg); break;
+		case 'b': batch = atoi(optarg); break;
+		case 'w': window = atoi(optarg); break;
+		case 's': size = atoi(optarg); break;
+		case 'q': sequential = true; break;
+		case 'f': fresh = true; break;
+		default: usage();
+		}
+	}
+	if (optind >= argc || n <= 0 || inflight <= 0 || size <= 0) usage();
+	if (sequential) {
+		ptime start = microsec_clock::universal_time();
+		int nok = bench_sequential(argv[optind], n, size, fresh);
+		double elapsed = (microsec_clock::universal_time() - start).total_microseconds() * 1E-6;
+
+		printf("records=%d sequential%s size=%d: ok=%d failed=%d, %.3f s, %.0f req/s\n",
+				n, fresh ? " new-connection" : "", size, nok, n - nok, elapsed, n / elapsed);
+		return nok == n ? 0 : 2;
+	}
+
+	DBCurl db(argv[optind], inflight);
+	bench_state st;
+	charray data(new char[size]);
+	char filename[40];
+
+	memset(data.get(), 0, size);
+	db.SetBatch("", batch, window);
+	ptime start = microsec_clock::universal_time();
+	for (int i = 0; i < n; ++i) {
+		snprintf(filename, sizeof(filename), "bench_%06d.fit", i);
+		boost::unique_lock<boost::mutex> lck(st.mtx);
+		// 批量注册时放行整批记录, 使批次可以累积
+		while (st.inflight >= inflight * batch) st.cv.wait(lck);
+		++st.inflight;
+		lck.unlock();
+		db.RegImageFileAsync("bench", filename, "/tmp/dbbench", "20261019T000000", i,
+				boost::bind(&on_result, &st, _1), data, size);
+	}
+	boost::unique_lock<boost::mutex> lck(st.mtx);
+	while (st.inflight) st.cv.wait(lck);
+	double elapsed = (microsec_clock::universal_time() - start).total_microseconds() * 1E-6;
+
+	printf("records=%d inflight=%d batch=%d size=%d: ok=%d failed=%d, %.3f s, %.0f records/s\n",
+			n, inflight, batch, size, st.nok, st.nfail, elapsed, n / elapsed);
+	return st.nfail ? 2 : 0;
+}
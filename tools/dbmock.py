@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file dbmock.py 数据库接口模拟服务器
+@version 0.1
+@date 2026-10-19
+@note
+- 以HTTP/1.1长连接应答ftserver的数据库请求(<Database URL>指向本服务器)
+- regOrigImgBatch.action按表单中的records[i].imgName字段统计批量注册的记录数
+- --reject-batch: 批量注册URL应答404, 用于验证逐条注册回退
+- --fail: 按比例应答503, 用于验证重试与熔断
+- --delay: 每个请求的服务延时, 量纲: 毫秒
+- 退出(Ctrl-C)或GET /stats时输出各URL的请求数与记录数
+
+用法:
+    tools/dbmock.py [--port 8080] [--reject-batch] [--fail 0.0] [--delay 0]
+"""
+
+import argparse
+import random
+import re
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+BATCH_URL = "regOrigImgBatch.action"
+
+lock = threading.Lock()
+stats = {}  # URL名称 => [请求数, 记录数, 应答码计数]
+
+
+def account(name, records, status):
+    with lock:
+        x = stats.setdefault(name, [0, 0, {}])
+        x[0] += 1
+        x[1] += records
+        x[2][status] = x[2].get(status, 0) + 1
+
+
+def report():
+    with lock:
+        lines = ["%-36s %8s %8s  %s" % ("url", "requests", "records", "status")]
+        for name in sorted(stats):
+            n, r, codes = stats[name]
+            st = " ".join("%d:%d" % (k, v) for k, v in sorted(codes.items()))
+            lines.append("%-36s %8d %8d  %s" % (name, n, r, st))
+    return "\n".join(lines) + "\n"
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # 保持连接, 与DBCurl的连接复用一致
+    disable_nagle_algorithm = True  # 应答头与内容分两次写入, 避免与延时确认叠加出40ms等待
+    opts = None
+
+    def log_message(self, fmt, *args):
+        if self.opts.verbose:
+            BaseHTTPRequestHandler.log_message(self, fmt, *args)
+
+    def read_body(self):
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            body = b""
+            while True:
+                n = int(self.rfile.readline().split(b";")[0], 16)
+                if n == 0:
+                    self.rfile.readline()
+                    return body
+                body += self.rfile.read(n)
+                self.rfile.readline()
+        return self.rfile.read(int(self.headers.get("Content-Length", 0)))
+
+    def reply(self, status, text):
+        data = text.encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_GET(self):
+        if self.path.rstrip("/").endswith("stats"):
+            self.reply(200, report())
+        else:
+            self.reply(404, "not found\n")
+
+    def do_POST(self):
+        body = self.read_body()
+        name = self.path.split("?")[0].rsplit("/", 1)[-1]
+        records = len(re.findall(rb'name="(?:records\[\d+\]\.)?imgName"', body)) or 1
+        if self.opts.delay > 0:
+            time.sleep(self.opts.delay * 1E-3)
+
+        if name == BATCH_URL and self.opts.reject_batch:
+            status = 404
+        elif self.opts.fail > 0 and random.random() < self.opts.fail:
+            status = 503
+        else:
+            status = 200
+        account(name, records if status == 200 else 0, status)
+        self.reply(status, "success\n" if status == 200 else "error\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="mock database server for ftserver")
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--reject-batch", action="store_true", help="answer 404 on " + BATCH_URL)
+    ap.add_argument("--fail", type=float, default=0.0, help="ratio of requests answered with 503")
+    ap.add_argument("--delay", type=float, default=0.0, help="service delay per request, ms")
+    ap.add_argument("--verbose", action="store_true")
+    Handler.opts = ap.parse_args()
+
+    server = ThreadingHTTPServer((Handler.opts.host, Handler.opts.port), Handler)
+    server.daemon_threads = True
+    print("dbmock listening on http://%s:%d/" % (Handler.opts.host, Handler.opts.port), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(report(), end="")
+
+
+if __name__ == "__main__":
+    main()
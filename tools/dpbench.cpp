@@ -0,0 +1,282 @@
+/*!
+ * @file dpbench.cpp 数据处理端口文件读取压力测试
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 客户端: 以c个连接经fileget反复读取同一文件, 统计各连接与总吞吐量
+ * - -D: 在进程内运行DataPublisher, 以sendfile()应答fileget, 与ftserver的数据处理端口一致
+ * - -S: 以read()+send()应答fileget的对照服务器, 数据经用户空间复制(NFS式复制路径)
+ *
+ * 用法:
+ *   dpbench [-c 1] [-r 10] [-p 4021] host subpath filename   (subpath: 文件所在的绝对目录)
+ *   dpbench -D root [-p 4021] [-n 2]
+ *   dpbench -S root [-p 4031]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "AsciiProtocol.h"
+#include "DataPublisher.h"
+#include "GLog.h"
+
+using namespace boost::posix_time;
+using namespace boost::placeholders;
+
+#define BENCH_QUANTUM	(1 << 20)	//< 对照服务器每次读取的数据长度, 量纲: 字节
+
+GLog _gLog(stdout);
+
+struct client_result {// 单个连接的结果
+	int64_t bytes;		//< 接收的文件字节数
+	double elapsed;		//< 耗时, 量纲: 秒
+	bool ok;			//< 全部读取成功
+
+public:
+	client_result() {
+		bytes   = 0;
+		elapsed = 0.0;
+		ok      = false;
+	}
+};
+
+static bool send_all(int sock, const char *data, int64_t n) {
+	ssize_t len;
+	while (n > 0) {
+		if ((len = send(sock, data, n, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += len;
+		n    -= len;
+	}
+	return true;
+}
+
+/*!
+ * @brief 读取一行, 不含换行符
+ */
+static bool recv_line(int sock, string &line) {
+	char ch;
+	ssize_t len;
+
+	line.clear();
+	while ((len = recv(sock, &ch, 1, 0)) == 1 && ch != '\n') line += ch;
+	return len == 1;
+}
+
+/*!
+ * @brief 从filedata应答中提取整数关键字
+ */
+static int64_t reply_value(const string &line, const char *key) {
+	string pat = string(key) + "=";
+	string::size_type pos = line.find(pat);
+	return pos == string::npos ? -1 : strtoll(line.c_str() + pos + pat.size(), NULL, 10);
+}
+
+static int connect_to(const char *host, int port) {
+	struct addrinfo hints, *res;
+	char service[10];
+	int sock(-1), on(1);
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", port);
+	if (getaddrinfo(host, service, &hints, &res)) return -1;
+	if ((sock = socket(res->ai_family, res->ai_socktype, 0)) >= 0 && connect(sock, res->ai_addr, res->ai_addrlen)) {
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(res);
+	if (sock >= 0) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	return sock;
+}
+
+/*!
+ * @brief 客户端线程: 逐次请求并接收完整文件
+ */
+static void thread_client(const char *host, int port, const string &request, int repeat, client_result *rslt) {
+	boost::shared_array<char> buff(new char[BENCH_QUANTUM]);
+	string line;
+	int sock;
+
+	if ((sock = connect_to(host, port)) < 0) return;
+	ptime start = microsec_clock::universal_time();
+	rslt->ok = true;
+	for (int i = 0; rslt->ok && i < repeat; ++i) {
+		if (!send_all(sock, request.data(), request.size())) rslt->ok = false;
+		// 跳过新文件通知等其它信息
+		while (rslt->ok && (rslt->ok = recv_line(sock, line)) && line.compare(0, 8, "filedata"));
+		if (!rslt->ok || reply_value(line, "filesize") < 0) {
+			rslt->ok = false;
+			break;
+		}
+		for (int64_t remain = reply_value(line, "length"), len; remain > 0; remain -= len) {
+			if ((len = recv(sock, buff.get(), remain < BENCH_QUANTUM ? remain : BENCH_QUANTUM, 0)) <= 0) {
+				rslt->ok = false;
+				break;
+			}
+			rslt->bytes += len;
+		}
+	}
+	rslt->elapsed = (microsec_clock::universal_time() - start).total_microseconds() * 1E-6;
+	close(sock);
+}
+
+/*!
+ * @brief 对照服务器: 以read()+send()应答一个连接的fileget请求
+ */
+static void thread_serve(int sock, const string &root) {
+	boost::shared_array<char> buff(new char[BENCH_QUANTUM]);
+	AsciiProtocol ascproto;
+	string line;
+	apbase base;
+	struct stat st;
+	int fd, n;
+
+	while (recv_line(sock, line)) {
+		try {
+			base = ascproto.Resolve(line.c_str());
+		}
+		catch(std::exception &ex) {
+			base.reset();
+		}
+		if (!base.use_count() || base->type != APTYPE_FILEGET) continue;
+
+		// 与数据处理端口一致: subpath为文件所在的绝对目录, 须位于root之下
+		apfileget proto = from_apbase<ascii_proto_fileget>(base);
+		string path = proto->subpath + "/" + proto->filename;
+		int64_t size(-1);
+		fd = -1;
+		if (proto->subpath.compare(0, root.size(), root) == 0 && proto->subpath.find("..") == string::npos
+				&& proto->filename.find('/') == string::npos
+				&& (fd = open(path.c_str(), O_RDONLY)) >= 0 && fstat(fd, &st) == 0)
+			size = st.st_size;
+		proto->filesize = size;
+		if (size < 0) proto->offset = proto->length = 0;
+		else {
+			if (proto->offset < 0 || proto->offset > size) proto->offset = size;
+			if (proto->length < 0 || proto->length > size - proto->offset) proto->length = size - proto->offset;
+		}
+		const char *s = ascproto.CompactFileData(proto, n);
+		bool ok = send_all(sock, s, n);
+		for (int64_t offset = proto->offset, end = offset + proto->length, len; ok && offset < end; offset += len) {
+			len = end - offset < BENCH_QUANTUM ? end - offset : BENCH_QUANTUM;
+			ok = (len = pread(fd, buff.get(), len, offset)) > 0 && send_all(sock, buff.get(), len);
+		}
+		if (fd >= 0) close(fd);
+		if (!ok) break;
+	}
+	close(sock);
+}
+
+static int serve(const string &root, int port) {
+	struct sockaddr_in addr;
+	int sock, on(1);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0
+			|| setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))
+			|| bind(sock, (struct sockaddr*) &addr, sizeof(addr))
+			|| listen(sock, 16)) {
+		perror("dpbench");
+		return 1;
+	}
+	printf("dpbench serves <%s> with read()+send() on port %d\n", root.c_str(), port);
+	for (int client; (client = accept(sock, NULL, NULL)) >= 0; ) {
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		boost::thread(boost::bind(&thread_serve, client, root)).detach();
+	}
+	return 0;
+}
+
+static void dp_accept(DataPubPtr dppub, const TcpCPtr &client, const long server) {
+	dppub->Subscribe(client);
+}
+
+/*!
+ * @brief 在进程内运行数据处理端口
+ * @param nreader DataPublisher读取线程数量
+ */
+static int serve_dp(const string &root, int port, int nreader) {
+	DataPubPtr dppub = make_datapub(1000, false, 0, nreader);
+	TcpSPtr server = maketcp_server();
+	std::vector<string> roots(1, root);
+
+	dppub->SetFrameSource(FrameCachePtr(), roots);
+	server->RegisterAccespt(boost::bind(&dp_accept, dppub, _1, _2));
+	if (server->CreateServer(port)) {
+		printf("dpbench failed to create server on port %d\n", port);
+		return 1;
+	}
+	printf("dpbench serves <%s> with DataPublisher on port %d\n", root.c_str(), port);
+	while (1) boost::this_thread::sleep_for(boost::chrono::seconds(3600));
+	return 0;
+}
+
+static void usage() {
+	printf("Usage: dpbench [-c clients] [-r repeat] [-p port] host subpath filename\n");
+	printf("       dpbench -D root [-p port] [-n readers]\n");
+	printf("       dpbench -S root [-p port]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	int nclient(1), repeat(10), port(-1), nreader(2), ch;
+	string root, dproot;
+
+	while ((ch = getopt(argc, argv, "c:r:p:n:D:S:")) != -1) {
+		switch (ch) {
+		case 'c': nclient = atoi(optarg); break;
+		case 'r': repeat = atoi(optarg); break;
+		case 'p': port = atoi(optarg); break;
+		case 'n': nreader = atoi(optarg); break;
+		case 'D': dproot = optarg; break;
+		case 'S': root = optarg; break;
+		default: usage();
+		}
+	}
+	if (!dproot.empty()) return serve_dp(dproot, port > 0 ? port : 4021, nreader);
+	if (!root.empty()) return serve(root, port > 0 ? port : 4031);
+	if (argc - optind != 3 || nclient <= 0 || repeat <= 0) usage();
+
+	char request[512];
+	snprintf(request, sizeof(request), "fileget subpath=%s,filename=%s\n", argv[optind + 1], argv[optind + 2]);
+	std::vector<client_result> rslts(nclient);
+	boost::thread_group thrds;
+	for (int i = 0; i < nclient; ++i) {
+		thrds.create_thread(boost::bind(&thread_client, argv[optind], port > 0 ? port : 4021,
+				string(request), repeat, &rslts[i]));
+	}
+	thrds.join_all();
+
+	double total(0.0), lo(-1.0), hi(0.0);
+	bool ok(true);
+	for (int i = 0; i < nclient; ++i) {
+		double rate = rslts[i].elapsed > 0.0 ? rslts[i].bytes / rslts[i].elapsed * 1E-6 : 0.0;
+		printf("client %d: %lld bytes, %.3f s, %.0f MB/s%s\n", i + 1, (long long) rslts[i].bytes,
+				rslts[i].elapsed, rate, rslts[i].ok ? "" : ", FAILED");
+		total += rate;
+		if (lo < 0.0 || rate < lo) lo = rate;
+		if (rate > hi) hi = rate;
+		ok = ok && rslts[i].ok;
+	}
+	printf("clients=%d: %.0f-%.0f MB/s each, %.0f MB/s total\n", nclient, lo, hi, total);
+	return ok ? 0 : 2;
+}
@@ -0,0 +1,185 @@
+/*!
+ * @file ricebench.cpp Rice分块压缩测试
+ * @version 0.1
+ * @date 2026-10-19
+ * @note
+ * - 以TileCompressor压缩FITS文件或合成的天空图像, 解压并逐字节比对主图像数据
+ * - 输出压缩比、压缩与解压耗时, 及给定链路带宽下原始与压缩数据的传输时间
+ * - 合成图像: 本底1000 ADU, 高斯读出与泊松噪声, 随机星像. 固定随机种子, 结果可复现
+ *
+ * 用法:
+ *   ricebench [-t 1] [-x 4096] [-y 4096] [-l 10,100] [file.fits]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <boost/random.hpp>
+#include "TileCompressor.h"
+#include "GLog.h"
+
+GLog _gLog(stdout);
+
+#define FITS_BLOCK	2880
+#define FITS_CARD	80
+
+static double thread_cpu() {
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static double wall() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static void card(std::string &h, const char *text) {
+	char buff[FITS_CARD + 1];
+	snprintf(buff, sizeof(buff), "%-80s", text);
+	h.append(buff, FITS_CARD);
+}
+
+/*!
+ * @brief 合成16位天空图像
+ */
+static std::vector<char> make_sky(int nx, int ny) {
+	std::string h;
+	char text[FITS_CARD + 1];
+
+	card(h, "SIMPLE  =                    T");
+	card(h, "BITPIX  =                   16");
+	card(h, "NAXIS   =                    2");
+	snprintf(text, sizeof(text), "NAXIS1  = %20d", nx);
+	card(h, text);
+	snprintf(text, sizeof(text), "NAXIS2  = %20d", ny);
+	card(h, text);
+	card(h, "BZERO   =                32768");
+	card(h, "BSCALE  =                    1");
+	card(h, "END");
+	h.resize((h.size() + FITS_BLOCK - 1) / FITS_BLOCK * FITS_BLOCK, ' ');
+
+	int64_t npix = int64_t(nx) * ny;
+	int64_t size = (npix * 2 + FITS_BLOCK - 1) / FITS_BLOCK * FITS_BLOCK;
+	std::vector<double> img(npix, 1000.0);
+	boost::random::mt19937 rng(20261019);
+	boost::random::uniform_real_distribution<> uni(0.0, 1.0);
+	boost::random::normal_distribution<> gauss(0.0, 1.0);
+
+	// 星像: 高斯轮廓, 流量按幂律分布
+	for (int i = 0, nstar = int(npix / 4000); i < nstar; ++i) {
+		double xc = uni(rng) * nx, yc = uni(rng) * ny;
+		double peak = 200.0 * pow(uni(rng) + 1E-3, -1.5);
+		if (peak > 60000.0) peak = 60000.0;
+		for (int y = int(yc) - 6; y <= int(yc) + 6; ++y) {
+			for (int x = int(xc) - 6; x <= int(xc) + 6; ++x) {
+				if (x < 0 || y < 0 || x >= nx || y >= ny) continue;
+				double r2 = (x - xc) * (x - xc) + (y - yc) * (y - yc);
+				img[int64_t(y) * nx + x] += peak * exp(-r2 / (2 * 1.5 * 1.5));
+			}
+		}
+	}
+
+	std::vector<char> data(h.size() + size, 0);
+	memcpy(&data[0], h.data(), h.size());
+	unsigned char *p = (unsigned char*) &data[h.size()];
+	for (int64_t i = 0; i < npix; ++i, p += 2) {
+		double v = img[i] + gauss(rng) * sqrt(img[i] + 25.0);
+		int u = v < 0 ? 0 : (v > 65535 ? 65535 : int(v + 0.5));
+		u -= 32768;		// BZERO
+		p[0] = (u >> 8) & 0xFF;
+		p[1] = u & 0xFF;
+	}
+	return data;
+}
+
+static bool load_file(const char *path, std::vector<char> &data) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp) return false;
+	fseek(fp, 0, SEEK_END);
+	data.resize(ftell(fp));
+	fseek(fp, 0, SEEK_SET);
+	bool ok = fread(&data[0], 1, data.size(), fp) == data.size();
+	fclose(fp);
+	return ok;
+}
+
+/*!
+ * @brief 查看主图像数据的起始位置
+ */
+static int64_t data_offset(const char *data, int64_t n) {
+	for (int64_t pos = 0; pos + FITS_CARD <= n; pos += FITS_CARD) {
+		if (!strncmp(data + pos, "END     ", 8))
+			return (pos + FITS_CARD + FITS_BLOCK - 1) / FITS_BLOCK * FITS_BLOCK;
+	}
+	return -1;
+}
+
+static void usage() {
+	printf("Usage: ricebench [-t threads] [-x nx] [-y ny] [-l mbps,...] [file.fits]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	int nworker(1), nx(4096), ny(4096), ch;
+	std::vector<double> links;
+	std::vector<char> raw;
+
+	while ((ch = getopt(argc, argv, "t:x:y:l:")) != -1) {
+		switch (ch) {
+		case 't': nworker = atoi(optarg); break;
+		case 'x': nx = atoi(optarg); break;
+		case 'y': ny = atoi(optarg); break;
+		case 'l':
+			for (char *s = strtok(optarg, ","); s; s = strtok(NULL, ",")) links.push_back(atof(s));
+			break;
+		default: usage();
+		}
+	}
+	if (nworker <= 0 || nx <= 0 || ny <= 0) usage();
+	if (links.empty()) {
+		links.push_back(10.0);
+		links.push_back(100.0);
+	}
+	if (optind < argc) {
+		if (!load_file(argv[optind], raw)) {
+			printf("failed to read <%s>\n", argv[optind]);
+			return 1;
+		}
+	}
+	else raw = make_sky(nx, ny);
+
+	TileCompressor compressor(nworker);
+	boost::shared_array<char> zdata, unz;
+	int64_t zsize, unzsize;
+
+	double t0 = wall();
+	if (!compressor.Compress("bench", &raw[0], raw.size(), zdata, zsize)) {
+		printf("image is not compressible: 16-bit 2-D primary image only\n");
+		return 1;
+	}
+	double tcomp = wall() - t0;
+	double cpu = thread_cpu();
+	t0 = wall();
+	bool ok = TileCompressor::Decompress(zdata.get(), zsize, BufPoolPtr(), unz, unzsize);
+	double tdec = wall() - t0;
+	cpu = thread_cpu() - cpu;
+
+	int64_t off = data_offset(&raw[0], raw.size()), offz = ok ? data_offset(unz.get(), unzsize) : -1;
+	int64_t nimg = raw.size() - off;
+	ok = ok && off >= 0 && offz >= 0 && unzsize - offz >= nimg && !memcmp(&raw[off], unz.get() + offz, nimg);
+
+	printf("%.1f MB -> %.1f MB (%.2fx), compress %.3f s on %d thread(s), decode %.3f s (cpu %.3f s) on one core, %s\n",
+			raw.size() * 1E-6, zsize * 1E-6, double(raw.size()) / zsize, tcomp, nworker, tdec, cpu,
+			ok ? "lossless" : "MISMATCH");
+	for (size_t i = 0; i < links.size(); ++i) {
+		double bps = links[i] * 1E6 / 8;
+		printf("%g Mbit/s link: %.1f s raw vs %.1f s compressed\n", links[i], raw.size() / bps, zsize / bps + tdec);
+	}
+	return ok ? 0 : 2;
+}